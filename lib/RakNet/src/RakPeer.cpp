@@ -22,6 +22,7 @@
 #ifdef __USE_IO_COMPLETION_PORTS
 #include "AsynchronousFileIO.h"
 #endif
+#include "SharedUpdateLoop.h"
 
 #ifdef _WIN32
 //#include <Shlwapi.h>
@@ -180,6 +181,7 @@ RakPeer::RakPeer()
 	bytesSentPerSecond = bytesReceivedPerSecond = 0;
 	endThreads = true;
 	isMainLoopThreadActive = false;
+	sharedUpdateWorker = -1;
 	// isRecvfromThreadActive=false;
 	occasionalPing = false;
 	connectionSocket = INVALID_SOCKET;
@@ -208,6 +210,16 @@ void RakPeer::AddRPCHandler(t_RPCHandler func) {
 	handler_rpc = std::move(func);
 }
 
+void RakPeer::AddPacketArrivalHandler(t_PacketArrivalHandler func) {
+	handler_packet_arrival = std::move(func);
+}
+
+void RakPeer::WakeUpdateLoop( void )
+{
+	if ( sharedUpdateWorker >= 0 )
+		SharedUpdateLoop::Instance()->Wake( this );
+}
+
 
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // Destructor
@@ -337,6 +349,11 @@ bool RakPeer::Initialize( unsigned short maxConnections, unsigned short localPor
 #else
 		myPlayerId=UNASSIGNED_PLAYER_ID;
 #endif
+		if ( isMainLoopThreadActive == false && SharedUpdateLoop::Instance()->Attach( this ) )
+		{
+			// Driven by the shared network threads instead of a thread of our own
+		}
+		else
 		{
 #ifdef _WIN32
 
@@ -684,6 +701,7 @@ void RakPeer::Disconnect( unsigned int blockDuration, unsigned char orderingChan
 	{
 		// Stop the threads
 		endThreads = true;
+		WakeUpdateLoop();
 
 		// Normally the thread will call DecreaseUserCount on termination but if we aren't using threads just do it
 		// manually
@@ -2093,6 +2111,7 @@ void RakPeer::AdvertiseSystem( const char *host, unsigned short remotePort, cons
 #ifdef _RAKNET_THREADSAFE
 	rakPeerMutexes[requestedConnectionList_Mutex].Unlock();
 #endif
+	WakeUpdateLoop();
 	*/
 }
 
@@ -2500,6 +2519,7 @@ bool RakPeer::SendConnectionRequest( const char* host, unsigned short remotePort
 #ifdef _RAKNET_THREADSAFE
 	rakPeerMutexes[requestedConnectionList_Mutex].Unlock();
 #endif
+	WakeUpdateLoop();
 
 	return true;
 }
@@ -3296,6 +3316,7 @@ void RakPeer::CloseConnectionInternal( const PlayerID target, bool sendDisconnec
 #ifdef _RAKNET_THREADSAFE
 			rakPeerMutexes[bufferedCommands_Mutex].Unlock();
 #endif
+			WakeUpdateLoop();
 		}
 	}
 }
@@ -3350,6 +3371,7 @@ void RakPeer::SendBuffered( const char *data, int numberOfBitsToSend, PacketPrio
 #ifdef _RAKNET_THREADSAFE
 	rakPeerMutexes[bufferedCommands_Mutex].Unlock();
 #endif
+	WakeUpdateLoop();
 }
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 bool RakPeer::SendImmediate( char *data, int numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, char orderingChannel, PlayerID playerId, bool broadcast, bool useCallerDataAllocation, RakNetTimeNS currentTime )
@@ -3612,6 +3634,9 @@ inline void RakPeer::AddPacketToProducer(Packet *p)
 	Packet **packetPtr=packetSingleProducerConsumer.WriteLock();
 	*packetPtr=p;
 	packetSingleProducerConsumer.WriteUnlock();
+
+	if (handler_packet_arrival)
+		handler_packet_arrival();
 }
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 /*
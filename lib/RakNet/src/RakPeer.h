@@ -40,6 +40,7 @@ struct PlayerIDAndIndex{PlayerID playerId;unsigned index;};
 int RAK_DLL_EXPORT PlayerIDAndIndexComp( const PlayerID &key, const PlayerIDAndIndex &data ); // GCC requires RakPeer::PlayerIDAndIndex or it won't compile
 
 using t_RPCHandler = std::function<void(int id, RakNet::BitStream*)>;
+using t_PacketArrivalHandler = std::function<void()>;
 /// The primary interface for RakNet, RakPeer contains all major functions for the library.
 /// See the individual functions for what the class can do.
 /// \brief The main interface for network communications
@@ -48,6 +49,7 @@ class RAK_DLL_EXPORT RakPeer : public RakPeerInterface
 {
 private:
 	t_RPCHandler handler_rpc;
+	t_PacketArrivalHandler handler_packet_arrival;
 public:
 	///Constructor
 	RakPeer();
@@ -57,6 +59,10 @@ public:
 
 	void AddRPCHandler(t_RPCHandler func);
 
+	/// Called from the network thread whenever a packet is queued for Receive().
+	/// Set it before Initialize(); the handler must be thread safe.
+	void AddPacketArrivalHandler(t_PacketArrivalHandler func);
+
 	// --------------------------------------------------------------------------------------------Major Low Level Functions - Functions needed by most users--------------------------------------------------------------------------------------------
 	/// \brief Starts the network threads, opens the listen port.
 	/// You must call this before calling Connect().
@@ -524,6 +530,7 @@ protected:
 	friend void ProcessNetworkPacket( const unsigned int binaryAddress, const unsigned short port, const char *data, const int length, RakPeer *rakPeer );
 	friend void* UpdateNetworkLoop( void* arguments );
 #endif
+	friend class SharedUpdateLoop;
 
 	// This is done to provide custom RPC handling when in a blocking RPC
 	Packet* ReceiveIgnoreRPC( void );
@@ -573,6 +580,10 @@ protected:
 	volatile bool endThreads;
 	///true if the peer thread is active. 
 	volatile bool isMainLoopThreadActive;
+	///Index of the SharedUpdateLoop thread driving this peer, -1 if it runs its own thread
+	volatile int sharedUpdateWorker;
+	///Requests an update cycle from the shared loop after user thread commands were buffered
+	void WakeUpdateLoop( void );
 	bool occasionalPing;  /// Do we occasionally ping the other systems?*/
 	///Store the maximum number of peers allowed to connect
 	unsigned short maximumNumberOfPeers;
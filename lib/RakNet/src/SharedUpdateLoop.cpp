@@ -0,0 +1,297 @@
+/// \file
+/// \brief Drives many RakPeer instances from a small pool of shared network threads.
+
+#include "SharedUpdateLoop.h"
+#include "RakPeer.h"
+#include "GetTime.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#define SHARED_UPDATE_LOOP_SUPPORTED
+#endif
+
+SharedUpdateLoop* SharedUpdateLoop::Instance( void )
+{
+	static SharedUpdateLoop instance;
+	return &instance;
+}
+
+SharedUpdateLoop::SharedUpdateLoop() : running( false )
+{
+}
+
+SharedUpdateLoop::~SharedUpdateLoop()
+{
+	Stop();
+#ifdef SHARED_UPDATE_LOOP_SUPPORTED
+	for ( auto &worker : workers )
+	{
+		close( worker->epollFd );
+		close( worker->wakeFd );
+	}
+#endif
+}
+
+bool SharedUpdateLoop::Start( int numberOfThreads )
+{
+#ifdef SHARED_UPDATE_LOOP_SUPPORTED
+	std::lock_guard<std::mutex> lock( lifecycleMutex );
+	if ( running )
+		return true;
+
+	if ( workers.empty() )
+	{
+		if ( numberOfThreads <= 0 )
+			numberOfThreads = ( int ) std::thread::hardware_concurrency();
+		if ( numberOfThreads <= 0 )
+			numberOfThreads = 1;
+
+		for ( int i = 0; i < numberOfThreads; i++ )
+		{
+			std::unique_ptr<Worker> worker( new Worker );
+			worker->index = i;
+			worker->numberOfPeers = 0;
+			worker->signaled = false;
+			worker->epollFd = epoll_create1( EPOLL_CLOEXEC );
+			worker->wakeFd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+			if ( worker->epollFd < 0 || worker->wakeFd < 0 )
+			{
+				if ( worker->epollFd >= 0 ) close( worker->epollFd );
+				if ( worker->wakeFd >= 0 ) close( worker->wakeFd );
+				break;
+			}
+
+			// The wake descriptor is tagged with a null pointer, peers with themselves
+			epoll_event event;
+			event.events = EPOLLIN;
+			event.data.ptr = 0;
+			epoll_ctl( worker->epollFd, EPOLL_CTL_ADD, worker->wakeFd, &event );
+
+			workers.push_back( std::move( worker ) );
+		}
+
+		if ( workers.empty() )
+			return false;
+	}
+
+	running = true;
+	for ( auto &worker : workers )
+		worker->thread = std::thread( &SharedUpdateLoop::WorkerLoop, this, worker.get() );
+	return true;
+#else
+	( void ) numberOfThreads;
+	return false;
+#endif
+}
+
+void SharedUpdateLoop::Stop( void )
+{
+	std::lock_guard<std::mutex> lock( lifecycleMutex );
+	if ( running == false )
+		return;
+
+	running = false;
+	for ( auto &worker : workers )
+	{
+		Signal( worker.get() );
+		if ( worker->thread.joinable() )
+			worker->thread.join();
+	}
+
+	// Peers still attached are left without a network thread. Their Disconnect() no longer waits for one.
+	for ( auto &worker : workers )
+	{
+		std::lock_guard<std::mutex> workerLock( worker->mutex );
+		for ( auto peer : worker->incoming )
+			worker->peers[ peer ] = 0;
+		for ( auto &entry : worker->peers )
+		{
+#ifdef SHARED_UPDATE_LOOP_SUPPORTED
+			if ( entry.first->connectionSocket != INVALID_SOCKET )
+				epoll_ctl( worker->epollFd, EPOLL_CTL_DEL, entry.first->connectionSocket, 0 );
+#endif
+			entry.first->sharedUpdateWorker = -1;
+			entry.first->isMainLoopThreadActive = false;
+		}
+		worker->peers.clear();
+		worker->incoming.clear();
+		worker->pending.clear();
+		worker->signaled = false;
+		worker->numberOfPeers = 0;
+	}
+}
+
+bool SharedUpdateLoop::IsRunning( void ) const
+{
+	return running;
+}
+
+int SharedUpdateLoop::GetNumberOfThreads( void ) const
+{
+	std::lock_guard<std::mutex> lock( lifecycleMutex );
+	return running ? ( int ) workers.size() : 0;
+}
+
+unsigned SharedUpdateLoop::GetNumberOfPeers( void ) const
+{
+	std::lock_guard<std::mutex> lock( lifecycleMutex );
+	unsigned count = 0;
+	for ( auto &worker : workers )
+		count += worker->numberOfPeers;
+	return count;
+}
+
+bool SharedUpdateLoop::Attach( RakPeer *peer )
+{
+	std::lock_guard<std::mutex> lock( lifecycleMutex );
+	if ( running == false )
+		return false;
+
+	Worker *target = 0;
+	for ( auto &worker : workers )
+	{
+		if ( target == 0 || worker->numberOfPeers < target->numberOfPeers )
+			target = worker.get();
+	}
+
+	target->numberOfPeers++;
+	peer->sharedUpdateWorker = target->index;
+	peer->isMainLoopThreadActive = true;
+	{
+		std::lock_guard<std::mutex> workerLock( target->mutex );
+		target->incoming.push_back( peer );
+	}
+	Signal( target );
+	return true;
+}
+
+void SharedUpdateLoop::Wake( RakPeer *peer )
+{
+	int index = peer->sharedUpdateWorker;
+	if ( index < 0 || running == false )
+		return;
+
+	Worker *worker = workers[ index ].get();
+	{
+		std::lock_guard<std::mutex> lock( worker->mutex );
+		worker->pending.push_back( peer );
+		if ( worker->signaled )
+			return;
+		worker->signaled = true;
+	}
+#ifdef SHARED_UPDATE_LOOP_SUPPORTED
+	uint64_t value = 1;
+	( void ) write( worker->wakeFd, &value, sizeof( value ) );
+#endif
+}
+
+void SharedUpdateLoop::Signal( Worker *worker )
+{
+	{
+		std::lock_guard<std::mutex> lock( worker->mutex );
+		worker->signaled = true;
+	}
+#ifdef SHARED_UPDATE_LOOP_SUPPORTED
+	uint64_t value = 1;
+	( void ) write( worker->wakeFd, &value, sizeof( value ) );
+#endif
+}
+
+void SharedUpdateLoop::UpdatePeer( Worker *worker, RakPeer *peer, unsigned pass, std::vector<RakPeer*> &ended )
+{
+	auto it = worker->peers.find( peer );
+	// Pending wakes may still name a peer that already left, and a peer runs at most once per pass
+	if ( it == worker->peers.end() || it->second == pass )
+		return;
+	it->second = pass;
+
+	if ( peer->endThreads )
+	{
+		ended.push_back( peer );
+		return;
+	}
+	peer->RunUpdateCycle();
+}
+
+void SharedUpdateLoop::WorkerLoop( Worker *worker )
+{
+#ifdef SHARED_UPDATE_LOOP_SUPPORTED
+	epoll_event events[ MAX_EVENTS ];
+	std::vector<RakPeer*> ready, incoming, ended, all;
+	unsigned pass = 0;
+	RakNetTime nextUpdate = RakNet::GetTime();
+
+	while ( running )
+	{
+		RakNetTime time = RakNet::GetTime();
+		int timeout = nextUpdate > time ? ( int ) ( nextUpdate - time ) : 0;
+		int count = epoll_wait( worker->epollFd, events, MAX_EVENTS, timeout );
+
+		ready.clear();
+		for ( int i = 0; i < count; i++ )
+		{
+			if ( events[ i ].data.ptr == 0 )
+			{
+				uint64_t value;
+				( void ) read( worker->wakeFd, &value, sizeof( value ) );
+			}
+			else
+				ready.push_back( ( RakPeer* ) events[ i ].data.ptr );
+		}
+
+		{
+			std::lock_guard<std::mutex> lock( worker->mutex );
+			incoming.swap( worker->incoming );
+			ready.insert( ready.end(), worker->pending.begin(), worker->pending.end() );
+			worker->pending.clear();
+			worker->signaled = false;
+		}
+		if ( running == false )
+			break;
+
+		for ( auto peer : incoming )
+		{
+			epoll_event event;
+			event.events = EPOLLIN;
+			event.data.ptr = peer;
+			epoll_ctl( worker->epollFd, EPOLL_CTL_ADD, peer->connectionSocket, &event );
+			worker->peers[ peer ] = pass;
+			ready.push_back( peer );
+		}
+		incoming.clear();
+
+		// Pass 0 is never used so new peers always get their first cycle
+		if ( ++pass == 0 )
+			++pass;
+		ended.clear();
+
+		for ( auto peer : ready )
+			UpdatePeer( worker, peer, pass, ended );
+
+		time = RakNet::GetTime();
+		if ( time >= nextUpdate )
+		{
+			all.clear();
+			for ( auto &entry : worker->peers )
+				all.push_back( entry.first );
+			for ( auto peer : all )
+				UpdatePeer( worker, peer, pass, ended );
+			nextUpdate = time + UPDATE_INTERVAL;
+		}
+
+		for ( auto peer : ended )
+		{
+			// The socket is still open, Disconnect() closes it only after isMainLoopThreadActive is cleared
+			epoll_ctl( worker->epollFd, EPOLL_CTL_DEL, peer->connectionSocket, 0 );
+			worker->peers.erase( peer );
+			worker->numberOfPeers--;
+			peer->sharedUpdateWorker = -1;
+			peer->isMainLoopThreadActive = false;
+		}
+	}
+#else
+	( void ) worker;
+#endif
+}
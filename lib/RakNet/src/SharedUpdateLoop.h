@@ -0,0 +1,86 @@
+/// \file
+/// \brief Drives many RakPeer instances from a small pool of shared network threads.
+///
+/// By default every RakPeer spawns its own UpdateNetworkLoop thread. Once the
+/// shared loop is started, RakPeer::Initialize attaches the peer to one of the
+/// shared threads instead. Each thread waits on an epoll set holding the
+/// sockets of its peers and runs RakPeer::RunUpdateCycle when a socket becomes
+/// readable, when the user thread buffers a send or connect, and every
+/// UPDATE_INTERVAL milliseconds for resends, acks and timeouts.
+///
+/// Every peer keeps its own UDP socket: servers tell clients apart by their
+/// source address, so datagrams cannot be demultiplexed off a single socket.
+
+#ifndef __SHARED_UPDATE_LOOP_H
+#define __SHARED_UPDATE_LOOP_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Export.h"
+
+class RakPeer;
+
+class RAK_DLL_EXPORT SharedUpdateLoop
+{
+public:
+	static SharedUpdateLoop* Instance( void );
+
+	/// Starts the shared network threads. Only supported on Linux (epoll).
+	/// \param[in] numberOfThreads Number of threads, 0 for one per CPU core
+	/// \return False if the shared loop is not available on this platform
+	bool Start( int numberOfThreads );
+
+	/// Stops the threads. Peers should be disconnected before.
+	void Stop( void );
+
+	bool IsRunning( void ) const;
+	int GetNumberOfThreads( void ) const;
+	unsigned GetNumberOfPeers( void ) const;
+
+	/// Called by RakPeer::Initialize. Returns false if the peer has to run its own thread.
+	bool Attach( RakPeer *peer );
+
+	/// Requests an update cycle of the peer as soon as possible. Thread safe.
+	void Wake( RakPeer *peer );
+
+private:
+	struct Worker
+	{
+		int index;
+		int epollFd;
+		int wakeFd;
+		std::thread thread;
+		std::atomic<unsigned> numberOfPeers;
+
+		// Guarded by mutex, filled by other threads
+		std::mutex mutex;
+		std::vector<RakPeer*> incoming;
+		std::vector<RakPeer*> pending;
+		bool signaled;
+
+		// Only touched by the worker thread. Maps a peer to the last pass it was updated in.
+		std::unordered_map<RakPeer*, unsigned> peers;
+	};
+
+	SharedUpdateLoop();
+	~SharedUpdateLoop();
+
+	void WorkerLoop( Worker *worker );
+	void Signal( Worker *worker );
+	void UpdatePeer( Worker *worker, RakPeer *peer, unsigned pass, std::vector<RakPeer*> &ended );
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<bool> running;
+	mutable std::mutex lifecycleMutex;
+
+	/// Interval of the update cycles run for every peer regardless of input
+	static const unsigned UPDATE_INTERVAL = 10;
+	static const int MAX_EVENTS = 128;
+};
+
+#endif
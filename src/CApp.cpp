@@ -17,6 +17,16 @@
 #include "tools/BotLLMTools.h"
 #include "core/CConsole.h"
 #include "core/CConsoleCommands.h"
+#include "core/CBenchCommands.h"
+#include "core/CBotScheduler.h"
+#include "core/CServerRegistry.h"
+#include "core/CStreamableCache.h"
+#include "physics/CNavGrid.h"
+#include "physics/CPathWorkerPool.h"
+#include "physics/CNavFile.h"
+#include "SharedUpdateLoop.h"
+
+#include <algorithm>
 
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
@@ -81,6 +91,26 @@ CConsole* CApp::getConsole() {
     return pConsole.get();
 }
 
+CBotScheduler* CApp::getBotScheduler() {
+    return pBotScheduler.get();
+}
+
+CServerRegistry* CApp::getServerRegistry() {
+    return pServerRegistry.get();
+}
+
+CStreamableCache* CApp::getStreamableCache() {
+    return pStreamableCache.get();
+}
+
+CNavGrid* CApp::getNavGrid() {
+    return pNavGrid.get();
+}
+
+CPathWorkerPool* CApp::getPathWorkerPool() {
+    return pPathWorkerPool.get();
+}
+
 ColAndreasWorld * CApp::getColAndreas() {
     return pColAndreasWorld;
 }
@@ -97,6 +127,10 @@ void CApp::init() {
     // Record start time
     startTime = std::chrono::steady_clock::now();
 
+    // Bots intern their server address while the database loads
+    pServerRegistry = std::make_unique<CServerRegistry>();
+    pStreamableCache = std::make_unique<CStreamableCache>();
+
     CLogger::getInstance()->system->info("[CONFIG]: Initializing configuration system");
     pConfig = std::make_unique<CConfig>();
     if (pConfig->loadConfigFile("data/config.json") && pConfig->loadBaseInternalPrompt("data/prompt.md"))  {
@@ -122,6 +156,21 @@ void CApp::init() {
         CLogger::getInstance()->system->error("[DATABASE]: Database could not be loaded");
     }
 
+    if (pConfig->network_threads >= 0 && SharedUpdateLoop::Instance()->Start(pConfig->network_threads)) {
+        CLogger::getInstance()->system->info("[NETWORK]: Shared network loop started with {} thread(s)",
+                                             SharedUpdateLoop::Instance()->GetNumberOfThreads());
+    } else {
+        CLogger::getInstance()->system->info("[NETWORK]: Using one network thread per bot");
+    }
+
+    CLogger::getInstance()->system->info("[SCHEDULER]: Initializing bot scheduler");
+    pBotScheduler = std::make_unique<CBotScheduler>(pConfig->tick_shards, pConfig->connection_policy);
+    for (auto& bot : pDataStorage->vBots) {
+        pBotScheduler->addBot(bot);
+    }
+    CLogger::getInstance()->system->info("[SCHEDULER]: {} bot(s) assigned to {} shard(s)",
+                                         pDataStorage->vBots.size(), pBotScheduler->getShardCount());
+
     CLogger::getInstance()->system->info("[QUERIER]: Initializing server querier");
     pServerQuerier = std::make_unique<CServerQuerier>();
     pServerQuerier->initialize(pDataStorage.get());
@@ -152,29 +201,71 @@ void CApp::init() {
     CConsoleCommands::registerBotCommands(pConsole.get());
     CConsoleCommands::registerSystemCommands(pConsole.get());
     CConsoleCommands::registerLLMCommands(pConsole.get());
+    CBenchCommands::registerBenchCommands(pConsole.get());
     pConsole->start();
     CLogger::getInstance()->system->info("[CONSOLE]: Debug console started successfully");
 
+    // With a baked nav file navigation does not depend on the collision world
+    pNavGrid = std::make_unique<CNavGrid>(static_cast<size_t>(std::max(pConfig->nav_cache_tiles, 0)));
+    if (pConfig->nav_file.empty() || !pNavGrid->loadBakedFile(pConfig->nav_file)) {
+        CLogger::getInstance()->system->info("[NAV]: No baked nav file, ground is sampled from ColAndreas on demand");
+    }
+    pPathWorkerPool = std::make_unique<CPathWorkerPool>(pConfig->nav_worker_threads,
+                                                        static_cast<size_t>(std::max(pConfig->nav_queue_size, 1)));
+
     pColAndreasWorld = new ColAndreasWorld;
     collisionWorld = pColAndreasWorld;
 
     if (pConfig->enable_colandreas) {
-        CLogger::getInstance()->system->info("[PHYSICS] Loading collision data.");
-        if (collisionWorld->loadCollisionData()) {
-            CLogger::getInstance()->system->info("[PHYSICS] Initializing collision map...");
-            collisionWorld->colandreasInitMap();
-            CLogger::getInstance()->system->info("[PHYSICS] Collision map initialized successfully");
-            colDataLoaded = true;
-        } else {
-            CLogger::getInstance()->system->info("[PHYSICS] No collision data found!");
-        }
+        loadCollisionWorld();
     }
 
     if (g_running)
         CLogger::getInstance()->system->info("[INIT]: Application initialization completed successfully");
 }
 
+bool CApp::loadCollisionWorld() {
+    CLogger::getInstance()->system->info("[PHYSICS] Loading collision data.");
+    if (!collisionWorld->loadCollisionData()) {
+        CLogger::getInstance()->system->info("[PHYSICS] No collision data found!");
+        return false;
+    }
+    CLogger::getInstance()->system->info("[PHYSICS] Initializing collision map...");
+    collisionWorld->colandreasInitMap();
+    CLogger::getInstance()->system->info("[PHYSICS] Collision map initialized successfully");
+    colDataLoaded = true;
+    return true;
+}
+
+bool CApp::bakeNavigation(const std::string& outputPath) {
+    CLogger::getInstance()->init();
+
+    pConfig = std::make_unique<CConfig>();
+    pConfig->loadConfigFile("data/config.json");
+    std::string path = outputPath.empty() ? pConfig->nav_file : outputPath;
+    if (path.empty()) {
+        CLogger::getInstance()->system->error("[NAV]: No output path given and nav_file is not set");
+        return false;
+    }
+
+    pColAndreasWorld = new ColAndreasWorld;
+    collisionWorld = pColAndreasWorld;
+    if (!loadCollisionWorld()) {
+        return false;
+    }
+
+    CLogger::getInstance()->system->info("[NAV]: Baking navigation grid to {}", path);
+    return CNavFile::bake(pColAndreasWorld, path, 0);
+}
+
 CApp::~CApp() {
+    if (pBotScheduler) {
+        pBotScheduler->stop();
+    }
+    // Searches may still be sampling the collision world
+    if (pPathWorkerPool) {
+        pPathWorkerPool->stop();
+    }
     if (pColAndreasWorld)
         delete pColAndreasWorld;
     if (pConsole) {
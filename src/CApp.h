@@ -7,6 +7,7 @@
 #include <memory>
 #include <vector>
 #include <chrono>
+#include <string>
 
 #include "models/CServer.h"
 #include "spdlog/spdlog.h"
@@ -21,6 +22,11 @@ class CFunctionDispatcher;
 class CLLMBotSessionManager;
 class ObjectNameUtil;
 class CConsole;
+class CBotScheduler;
+class CServerRegistry;
+class CStreamableCache;
+class CNavGrid;
+class CPathWorkerPool;
 
 class CApp {
 private:
@@ -38,14 +44,23 @@ private:
     std::unique_ptr<CLLMBotSessionManager> pLLMSessionManager;
     std::unique_ptr<ObjectNameUtil> pObjectNameUtil;
     std::unique_ptr<CConsole> pConsole;
+    std::unique_ptr<CBotScheduler> pBotScheduler;
+    std::unique_ptr<CServerRegistry> pServerRegistry;
+    std::unique_ptr<CStreamableCache> pStreamableCache;
+    std::unique_ptr<CNavGrid> pNavGrid;
+    std::unique_ptr<CPathWorkerPool> pPathWorkerPool;
     ColAndreasWorld* pColAndreasWorld;
 
     // Runtime tracking
     std::chrono::steady_clock::time_point startTime;
 
+    bool loadCollisionWorld();
+
 public:
     static CApp* getInstance();
     void init();
+    // --bake-nav mode: loads only the config and ColAndreas, then writes the nav file
+    bool bakeNavigation(const std::string& outputPath);
 
     CConfig* getConfig();
     CAPIServer* getAPIServer();
@@ -56,6 +71,11 @@ public:
     CLLMBotSessionManager* getLLMSessionManager();
     ObjectNameUtil* getObjectNameUtil();
     CConsole* getConsole();
+    CBotScheduler* getBotScheduler();
+    CServerRegistry* getServerRegistry();
+    CStreamableCache* getStreamableCache();
+    CNavGrid* getNavGrid();
+    CPathWorkerPool* getPathWorkerPool();
     ColAndreasWorld* getColAndreas();
 
     // Runtime tracking
@@ -0,0 +1,474 @@
+#include "CBenchCommands.h"
+#include "../CApp.h"
+#include "../models/CRakBot.h"
+#include "../utils/PacketReader.h"
+#include "../core/CSharedResourcePool.h"
+#include "../core/CServerRegistry.h"
+#include "../utils/TextCodec.h"
+#include "../utils/map_zones.h"
+#include "BitStream.h"
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+void CBenchCommands::registerBenchCommands(CConsole* console) {
+    console->registerCommand("bench_packets", {
+        "Measure sync packet decode and pool update throughput on the current thread",
+        [](const std::vector<std::string>& args) {
+            auto console = CApp::getInstance()->getConsole();
+
+            int count = 1000000;
+            int players = 500;
+            try {
+                if (args.size() > 1) count = std::max(1, std::stoi(args[1]));
+                if (args.size() > 2) players = std::min(std::max(1, std::stoi(args[2])), (int) stServerResources::MAX_IDS);
+            } catch (...) {
+                console->println("Usage: bench_packets [count] [players]");
+                return;
+            }
+
+            // Hostnames longer than the SSO buffer are the common case for real servers
+            const std::string benchHost = "packet-benchmark.invalid";
+            const int benchPort = 7777;
+
+            // Full ID_PLAYER_SYNC packets so both paths decode the whole struct
+            const size_t packetSize = 1 + sizeof(unsigned short) + sizeof(stOnFootData);
+            const int packetCount = 256;
+            std::vector<std::vector<unsigned char>> packets;
+            std::mt19937 rng(7777);
+            for (int i = 0; i < packetCount; i++) {
+                std::vector<unsigned char> packet(packetSize);
+                for (auto &byte : packet) {
+                    byte = static_cast<unsigned char>(rng());
+                }
+                unsigned short senderID = static_cast<unsigned short>(rng() % players);
+                packet[0] = ID_PLAYER_SYNC;
+                std::memcpy(&packet[1], &senderID, sizeof(senderID));
+                packets.push_back(std::move(packet));
+            }
+
+            auto measure = [&](const std::function<void(const std::vector<unsigned char>&)>& fn) {
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < count; i++) {
+                    fn(packets[i % packetCount]);
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                return count / std::max(seconds, 1e-9);
+            };
+
+            // Previous receive path: BitStream decode, then the pool keyed by a
+            // host:port string pair with a linear scan for the player id
+            struct stLegacyResources {
+                std::vector<stPlayer> players;
+            };
+            std::map<std::pair<std::string, int>, stLegacyResources> legacyPool;
+            // Measured on a private pool so live bots are neither slowed down nor shown the fake players
+            auto pool = std::make_unique<CSharedResourcePool>();
+            CServerRegistry registry;
+            ServerHandle server = registry.intern(benchHost, benchPort);
+            pool->addServer(server);
+            for (int i = 0; i < players; i++) {
+                stPlayer player{};
+                player.id = i;
+                player.name = "bench_" + std::to_string(i);
+                legacyPool[{benchHost, benchPort}].players.push_back(player);
+                pool->addPlayer(server, player);
+            }
+
+            double legacyRate = measure([&](const std::vector<unsigned char>& packet) {
+                RakNet::BitStream bs((unsigned char *) packet.data(), packet.size(), false);
+                unsigned short senderID;
+                bs.IgnoreBits(8);
+                bs.Read(senderID);
+                stOnFootData onFootData{};
+                bs.Read((char *) &onFootData, sizeof(stOnFootData));
+
+                auto &resources = legacyPool[{benchHost, benchPort}];
+                for (auto &player : resources.players) {
+                    if (player.id == senderID) {
+                        player.position = glm::vec3{onFootData.fPosition[0], onFootData.fPosition[1], onFootData.fPosition[2]};
+                        player.velocity = glm::vec3{onFootData.fMoveSpeed[0], onFootData.fMoveSpeed[1], onFootData.fMoveSpeed[2]};
+                        player.health = onFootData.byteHealth;
+                        player.armor = onFootData.byteArmor;
+                        player.weapon = onFootData.byteCurrentWeapon;
+                        player.specialAction = onFootData.byteSpecialAction;
+                        break;
+                    }
+                }
+            });
+
+            // Current path, as CRakBot::handlePlayerSync runs it: PacketReader and the interned server handle
+            double readerRate = measure([&](const std::vector<unsigned char>& packet) {
+                PacketReader reader(packet.data(), packet.size());
+                unsigned short senderID;
+                stOnFootData onFootData;
+                if (!reader.skip(1) || !reader.read(senderID)) {
+                    return;
+                }
+                reader.readOrZero(onFootData);
+                pool->updatePlayer(server, senderID, onFootData);
+            });
+
+            pool->removeServer(server);
+
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(0)
+                << "\n=== Packet Receive (" << count << " ID_PLAYER_SYNC packets of " << packetSize
+                << " bytes, " << players << " players) ===\n"
+                << "BitStream + address lookup:     " << legacyRate << " packets/s\n"
+                << "PacketReader + server handle:   " << readerRate << " packets/s\n";
+            console->println(out.str());
+        },
+        "bench_packets [count] [players]"
+    });
+
+    console->registerCommand("bench_pool", {
+        "Replay player sync updates against the shared resource pool",
+        [](const std::vector<std::string>& args) {
+            auto console = CApp::getInstance()->getConsole();
+
+            int players = 1000;
+            int seconds = 10;
+            try {
+                if (args.size() > 1) players = std::min(std::max(1, std::stoi(args[1])), (int) stServerResources::MAX_IDS);
+                if (args.size() > 2) seconds = std::max(1, std::stoi(args[2]));
+            } catch (...) {
+                console->println("Usage: bench_pool [players] [seconds]");
+                return;
+            }
+
+            // Every streamed player sends on foot sync at roughly 30 Hz
+            const int syncRate = 30;
+            // Measured on a private pool so live bots are neither slowed down nor shown the fake players
+            auto pool = std::make_unique<CSharedResourcePool>();
+            CServerRegistry registry;
+            ServerHandle server = registry.intern("pool-benchmark.invalid", 7777);
+            pool->addServer(server);
+            for (int i = 0; i < players; i++) {
+                stPlayer player{};
+                player.id = i;
+                player.name = "bench_" + std::to_string(i);
+                pool->addPlayer(server, player);
+            }
+
+            stOnFootData onFootData{};
+            long long updates = static_cast<long long>(players) * syncRate * seconds;
+            // Replay in sync order (every player once per frame) so ids are not visited sequentially
+            auto start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < syncRate * seconds; frame++) {
+                for (int i = 0; i < players; i++) {
+                    unsigned short id = static_cast<unsigned short>((i * 7919 + frame) % players);
+                    onFootData.fPosition[0] = static_cast<float>(frame);
+                    pool->updatePlayer(server, id, onFootData);
+                }
+            }
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            elapsed = std::max(elapsed, 1e-9);
+
+            pool->removeServer(server);
+
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(0)
+                << "\n=== Resource Pool (" << players << " players x " << syncRate << " Hz x " << seconds << " s) ===\n"
+                << "Updates:        " << updates << "\n"
+                << "Throughput:     " << updates / elapsed << " updates/s\n"
+                << std::setprecision(1)
+                << "Replay time:    " << elapsed * 1000.0 << " ms (" << seconds / elapsed << "x realtime)\n";
+            console->println(out.str());
+        },
+        "bench_pool [players] [seconds]"
+    });
+
+    console->registerCommand("bench_codec", {
+        "Round-trip check and throughput of the built-in GBK / CP1251 codecs",
+        [](const std::vector<std::string>& args) {
+            auto console = CApp::getInstance()->getConsole();
+
+            int iterations = 20000;
+            try {
+                if (args.size() > 1) iterations = std::max(1, std::stoi(args[1]));
+            } catch (...) {
+                console->println("Usage: bench_codec [iterations]");
+                return;
+            }
+
+            struct Case {
+                const char* name;
+                TextCodec::Encoding encoding;
+                const char* sample;
+            };
+            const Case cases[] = {
+                {"GBK", TextCodec::Encoding::GBK, "好的，我现在去洛圣都银行，然后买一辆车。 /goto bank, then /buycar Infernus 价格 $95000\n"},
+                {"CP1251", TextCodec::Encoding::CP1251, "Хорошо, я иду в банк Лос-Сантоса. /goto bank, then /buycar Infernus цена $95000\n"},
+            };
+
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(1) << "\n=== Text Codec ===\n";
+            for (const auto& c : cases) {
+                // Every byte sequence that decodes to a character must encode back to itself
+                size_t characters = 0, mismatches = 0;
+                std::string decoded, encoded;
+                auto roundTrip = [&](const std::string& bytes) {
+                    TextCodec::decode(c.encoding, bytes.data(), bytes.size(), decoded);
+                    if (decoded == "\xEF\xBF\xBD") return; // U+FFFD, not assigned
+                    characters++;
+                    TextCodec::encode(c.encoding, decoded.data(), decoded.size(), encoded);
+                    if (encoded != bytes) mismatches++;
+                };
+                for (int lead = 0x80; lead <= 0xFF; lead++) {
+                    roundTrip(std::string(1, static_cast<char>(lead)));
+                    if (c.encoding != TextCodec::Encoding::GBK) continue;
+                    for (int trail = 0x40; trail <= 0xFE; trail++) {
+                        roundTrip({static_cast<char>(lead), static_cast<char>(trail)});
+                    }
+                }
+
+                // An LLM reply of about 1 KB
+                std::string utf8;
+                while (utf8.size() < 1024) utf8 += c.sample;
+                std::string native;
+                TextCodec::encode(c.encoding, utf8.data(), utf8.size(), native);
+
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < iterations; i++) {
+                    TextCodec::encode(c.encoding, utf8.data(), utf8.size(), encoded);
+                }
+                auto middle = std::chrono::steady_clock::now();
+                for (int i = 0; i < iterations; i++) {
+                    TextCodec::decode(c.encoding, native.data(), native.size(), decoded);
+                }
+                auto end = std::chrono::steady_clock::now();
+                double encodeSeconds = std::max(std::chrono::duration<double>(middle - start).count(), 1e-9);
+                double decodeSeconds = std::max(std::chrono::duration<double>(end - middle).count(), 1e-9);
+                double megabytes = static_cast<double>(utf8.size()) * iterations / (1024.0 * 1024.0);
+
+                out << c.name << ": " << characters << " characters, " << mismatches << " round-trip mismatches"
+                    << (decoded == utf8 ? "" : ", SAMPLE DOES NOT ROUND-TRIP") << "\n"
+                    << "  encode " << megabytes / encodeSeconds << " MB/s, decode " << megabytes / decodeSeconds
+                    << " MB/s (UTF-8 side, " << utf8.size() << " byte text)\n";
+            }
+            console->println(out.str());
+        },
+        "bench_codec [iterations]"
+    });
+
+    console->registerCommand("bench_zones", {
+        "Compare the zone grid against the linear area walk",
+        [](const std::vector<std::string>& args) {
+            auto console = CApp::getInstance()->getConsole();
+
+            int points = 1000000;
+            try {
+                if (args.size() > 1) points = std::max(1, std::stoi(args[1]));
+            } catch (...) {
+                console->println("Usage: bench_zones [points]");
+                return;
+            }
+
+            auto buildStart = std::chrono::steady_clock::now();
+            size_t cells = MapZones::GetMapZoneGridCellCount();
+            double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+            // Half of the points anywhere on (and a little off) the map, half
+            // right on area edges where the grid falls back to candidate lists
+            std::vector<glm::vec3> positions;
+            positions.reserve(points);
+            uint32_t seed = 0x2545F491u;
+            auto next = [&seed]() {
+                seed = seed * 1664525u + 1013904223u;
+                return static_cast<float>(seed >> 8) / static_cast<float>(1u << 24);
+            };
+            struct Rect { float minX, minY, maxX, maxY; };
+            std::vector<Rect> edges;
+            for (int zone = 0; zone < MapZones::GetMapZoneCount(); zone++) {
+                float minX, minY, minZ, maxX, maxY, maxZ;
+                int index = 0;
+                while ((index = MapZones::GetMapZoneAreaPos(static_cast<MapZone>(zone), minX, minY, minZ, maxX, maxY, maxZ, index)) >= 0) {
+                    edges.push_back({minX, minY, maxX, maxY});
+                    index++;
+                }
+            }
+            for (int i = 0; i < points; i++) {
+                if (i % 2 == 0 || edges.empty()) {
+                    positions.emplace_back(-3100.0f + next() * 6200.0f, -3000.0f + next() * 6100.0f, 0.0f);
+                    continue;
+                }
+                const Rect& area = edges[static_cast<size_t>(next() * edges.size()) % edges.size()];
+                float x = area.minX + next() * (area.maxX - area.minX);
+                float y = area.minY + next() * (area.maxY - area.minY);
+                switch (i % 8) {
+                    case 1: x = area.minX; break;
+                    case 3: x = area.maxX; break;
+                    case 5: y = area.minY; break;
+                    default: y = area.maxY; break;
+                }
+                positions.emplace_back(x, y, 0.0f);
+            }
+
+            std::vector<MapZone> linear(positions.size()), grid(positions.size()), batch(positions.size());
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < positions.size(); i++) {
+                linear[i] = MapZones::GetMapZoneAtPoint2DLinear(positions[i].x, positions[i].y);
+            }
+            auto afterLinear = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < positions.size(); i++) {
+                grid[i] = MapZones::GetMapZoneAtPoint2D(positions[i].x, positions[i].y);
+            }
+            auto afterGrid = std::chrono::steady_clock::now();
+            MapZones::GetMapZonesAtPoints2D(positions.data(), positions.size(), batch.data());
+            auto end = std::chrono::steady_clock::now();
+
+            size_t mismatches = 0;
+            for (size_t i = 0; i < positions.size(); i++) {
+                if (grid[i] != linear[i] || batch[i] != linear[i]) mismatches++;
+            }
+
+            auto perPoint = [&](std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+                return std::chrono::duration<double, std::nano>(to - from).count() / positions.size();
+            };
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(1) << "\n=== Map Zones ===\n"
+                << "Grid: " << cells << " cells of " << MAP_ZONE_GRID_CELL_SIZE << " m, "
+                << MapZones::GetMapZoneGridBoundaryCellCount() << " boundary, "
+                << MapZones::GetMapZoneGridMemoryUsage() / 1024 << " KB, first use " << buildMs << " ms\n"
+                << "Points: " << positions.size() << ", mismatches against linear walk: " << mismatches << "\n"
+                << "Linear: " << perPoint(start, afterLinear) << " ns/point\n"
+                << "Grid:   " << perPoint(afterLinear, afterGrid) << " ns/point\n"
+                << "Batch:  " << perPoint(afterGrid, end) << " ns/point\n";
+            console->println(out.str());
+        },
+        "bench_zones [points]"
+    });
+
+    console->registerCommand("stress_pool", {
+        "Run sync writers and query readers against the resource pool in parallel",
+        [](const std::vector<std::string>& args) {
+            auto console = CApp::getInstance()->getConsole();
+
+            int seconds = 5;
+            int writers = 4;
+            int readers = 4;
+            try {
+                if (args.size() > 1) seconds = std::max(1, std::stoi(args[1]));
+                if (args.size() > 2) writers = std::min(std::max(1, std::stoi(args[2])), 16);
+                if (args.size() > 3) readers = std::min(std::max(1, std::stoi(args[3])), 16);
+            } catch (...) {
+                console->println("Usage: stress_pool [seconds] [writers] [readers]");
+                return;
+            }
+
+            // A private pool and registry, live bots keep their locks and no stress servers are left behind
+            auto pool = std::make_unique<CSharedResourcePool>();
+            CServerRegistry registry;
+            ServerHandle server = registry.intern("pool-stress.invalid", 7777);
+            ServerHandle churnServer = registry.intern("pool-stress.invalid", 7778);
+            pool->addServer(server);
+
+            std::atomic<bool> stop{false};
+            std::atomic<long long> writes{0}, reads{0}, violations{0};
+            std::vector<std::thread> threads;
+
+            // Every writer owns a disjoint id range and joins, moves and drops its players
+            const int idsPerWriter = static_cast<int>(stServerResources::MAX_IDS) / writers;
+            for (int w = 0; w < writers; w++) {
+                threads.emplace_back([&, w]() {
+                    uint32_t seed = 0x9E3779B9u * (w + 1);
+                    long long local = 0;
+                    stOnFootData onFootData{};
+                    while (!stop.load(std::memory_order_relaxed)) {
+                        seed = seed * 1664525u + 1013904223u;
+                        int id = w * idsPerWriter + static_cast<int>((seed >> 8) % idsPerWriter);
+                        float x = static_cast<float>(static_cast<int>(seed >> 4) % 6000 - 3000);
+                        switch (seed % 8) {
+                            case 0: {
+                                stPlayer player{};
+                                player.id = id;
+                                player.name = "stress_" + std::to_string(id);
+                                player.position = glm::vec3(x, -x, 10.0f);
+                                pool->addPlayer(server, player);
+                                break;
+                            }
+                            case 1:
+                                pool->removePlayer(server, id);
+                                break;
+                            default:
+                                onFootData.fPosition[0] = x;
+                                onFootData.fPosition[1] = -x;
+                                onFootData.fPosition[2] = 10.0f;
+                                pool->updatePlayer(server, static_cast<unsigned short>(id), onFootData);
+                                break;
+                        }
+                        local++;
+                    }
+                    writes += local;
+                });
+            }
+
+            // Readers check that every visible record is internally consistent
+            for (int r = 0; r < readers; r++) {
+                threads.emplace_back([&, r]() {
+                    long long local = 0;
+                    float x = static_cast<float>(r * 500 - 1500);
+                    while (!stop.load(std::memory_order_relaxed)) {
+                        glm::vec3 center(x, -x, 10.0f);
+                        size_t visited = 0;
+                        pool->forEachPlayerInRange(server, center, 300.0f, true, [&](const stPlayer& player) {
+                            if (player.name != "stress_" + std::to_string(player.id) ||
+                                player.position.y != -player.position.x) {
+                                violations++;
+                            }
+                            visited++;
+                        });
+                        int id = static_cast<int>((local * 7919 + visited) % stServerResources::MAX_IDS);
+                        std::string name = pool->getPlayerName(server, id);
+                        if (!name.empty() && name != "stress_" + std::to_string(id)) {
+                            violations++;
+                        }
+                        pool->countPlayersInRange(server, center, 300.0f, false);
+                        x = x >= 3000.0f ? -3000.0f : x + 25.0f;
+                        local++;
+                    }
+                    reads += local;
+                });
+            }
+
+            // Servers coming and going while the others are busy
+            threads.emplace_back([&]() {
+                while (!stop.load(std::memory_order_relaxed)) {
+                    pool->addServer(churnServer);
+                    stPlayer player{};
+                    player.id = 0;
+                    player.name = "stress_0";
+                    pool->addPlayer(churnServer, player);
+                    pool->getAllPlayer(churnServer, true);
+                    pool->removeServer(churnServer);
+                }
+            });
+
+            std::this_thread::sleep_for(std::chrono::seconds(seconds));
+            stop = true;
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            size_t remaining = pool->getAllPlayer(server, true).size();
+            pool->removeServer(server);
+
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(0)
+                << "\n=== Resource Pool Stress (" << seconds << " s, " << writers << " writers, " << readers << " readers) ===\n"
+                << "Writes:          " << writes.load() << " (" << writes.load() / seconds << "/s)\n"
+                << "Range queries:   " << reads.load() << " (" << reads.load() / seconds << "/s)\n"
+                << "Players left:    " << remaining << "\n"
+                << "Violations:      " << violations.load() << "\n";
+            console->println(out.str());
+        },
+        "stress_pool [seconds] [writers] [readers]"
+    });
+}
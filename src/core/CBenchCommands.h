@@ -0,0 +1,13 @@
+#ifndef CBENCHCOMMANDS_H
+#define CBENCHCOMMANDS_H
+
+#include "CConsole.h"
+
+// bench_* and stress_* console commands that measure hot paths, kept apart
+// from the operational commands in CConsoleCommands
+class CBenchCommands {
+public:
+    static void registerBenchCommands(CConsole* console);
+};
+
+#endif // CBENCHCOMMANDS_H
@@ -0,0 +1,240 @@
+//
+// CBotScheduler - Sharded tick loop for RakNet bots
+//
+
+#include "CBotScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "CLogger.h"
+#include "CSharedResourcePool.h"
+#include "../CApp.h"
+#include "../models/CBot.h"
+#include "../utils/ds/TimerWheel.h"
+
+namespace {
+    uint64_t steadyNowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+void CBotScheduler::stWaker::notify() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = true;
+    }
+    cv.notify_one();
+}
+
+CBotScheduler::CBotScheduler(int shardCount, eConnectionPolicy policy) {
+    if (shardCount <= 0) {
+        shardCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    for (int i = 0; i < shardCount; i++) {
+        shards.emplace_back(std::make_unique<Shard>(i, policy));
+    }
+}
+
+CBotScheduler::~CBotScheduler() {
+    stop();
+}
+
+void CBotScheduler::start() {
+    if (running.load()) {
+        return;
+    }
+    running.store(true);
+    for (auto& shard : shards) {
+        shard->thread = std::thread(&CBotScheduler::shardLoop, this, shard.get());
+    }
+    CLogger::getInstance()->system->info("[SCHEDULER]: Started {} bot shard(s)", shards.size());
+}
+
+void CBotScheduler::stop() {
+    if (!running.load()) {
+        return;
+    }
+    running.store(false);
+    for (auto& shard : shards) {
+        shard->waker->notify();
+    }
+    for (auto& shard : shards) {
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+    CLogger::getInstance()->system->info("[SCHEDULER]: All bot shards stopped");
+}
+
+bool CBotScheduler::isRunning() const {
+    return running.load();
+}
+
+void CBotScheduler::addBot(const std::shared_ptr<CBot>& bot) {
+    if (!bot) return;
+
+    Shard* target = nullptr;
+    size_t minBots = SIZE_MAX;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->botsMutex);
+        if (shard->bots.size() < minBots) {
+            minBots = shard->bots.size();
+            target = shard.get();
+        }
+    }
+
+    std::shared_ptr<stWaker> waker = target->waker;
+    bot->setPacketArrivalNotifier([waker]() { waker->notify(); });
+    {
+        std::lock_guard<std::mutex> lock(target->botsMutex);
+        target->bots.push_back(bot);
+        target->botsDirty.store(true);
+    }
+    waker->notify();
+}
+
+void CBotScheduler::removeBot(const std::string& uuid) {
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->botsMutex);
+        auto it = std::remove_if(shard->bots.begin(), shard->bots.end(),
+            [&uuid](const std::shared_ptr<CBot>& bot) {
+                return bot->getUuid() == uuid;
+            });
+        if (it != shard->bots.end()) {
+            shard->bots.erase(it, shard->bots.end());
+            shard->botsDirty.store(true);
+            shard->waker->notify();
+            return;
+        }
+    }
+}
+
+size_t CBotScheduler::getShardCount() const {
+    return shards.size();
+}
+
+std::vector<stShardStats> CBotScheduler::getStats() const {
+    std::vector<stShardStats> result;
+    result.reserve(shards.size());
+    for (const auto& shard : shards) {
+        stShardStats stats{};
+        stats.shard = shard->index;
+        {
+            std::lock_guard<std::mutex> lock(shard->botsMutex);
+            stats.bots = shard->bots.size();
+        }
+        {
+            std::lock_guard<std::mutex> lock(shard->statsMutex);
+            stats.ticks = shard->ticks;
+            stats.last_tick_us = shard->lastTickUs;
+            stats.avg_tick_us = shard->avgTickUs;
+            stats.max_tick_us = shard->maxTickUs;
+        }
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void CBotScheduler::shardLoop(Shard* shard) {
+    // Local copy keeps the bots alive while they are processed, even if they
+    // are removed from the shard in the meantime
+    std::vector<std::shared_ptr<CBot>> bots;
+
+    // Timer ids are indices into the local copy of bots
+    TimerWheel timers(steadyNowMs());
+    std::vector<TimerWheel::TimerId> due;
+    std::vector<char> isDue;
+
+    while (running.load()) {
+        if (shard->botsDirty.exchange(false)) {
+            std::lock_guard<std::mutex> lock(shard->botsMutex);
+            bots = shard->bots;
+            timers.clear();
+            uint64_t now = steadyNowMs();
+            for (size_t i = 0; i < bots.size(); i++) {
+                timers.schedule(i, now);
+            }
+        }
+
+        {
+            uint64_t deadline = std::min(timers.nextDeadline(), steadyNowMs() + MAX_IDLE_MS);
+            if (snapshotPending.load()) {
+                deadline = std::min(deadline, nextSnapshotMs.load());
+            }
+            std::chrono::steady_clock::time_point wakeAt{std::chrono::milliseconds(deadline)};
+
+            std::unique_lock<std::mutex> lock(shard->waker->mutex);
+            shard->waker->cv.wait_until(lock, wakeAt, [&]() {
+                return shard->waker->pending || !running.load();
+            });
+            shard->waker->pending = false;
+        }
+        if (!running.load()) {
+            break;
+        }
+
+        auto tickStart = std::chrono::steady_clock::now();
+
+        due.clear();
+        timers.advance(steadyNowMs(), due);
+        isDue.assign(bots.size(), 0);
+        for (auto id : due) {
+            isDue[id] = 1;
+        }
+        for (size_t i = 0; i < bots.size(); i++) {
+            if (bots[i]->consumePacketArrival() && !isDue[i]) {
+                isDue[i] = 1;
+                due.push_back(i);
+            }
+        }
+        if (due.empty()) {
+            if (snapshotPending.load()) {
+                publishSnapshots();
+            }
+            continue;
+        }
+
+        // Disconnected bots only become due once their reconnect delay is over
+        bool connectDue = std::any_of(due.begin(), due.end(), [&bots](TimerWheel::TimerId id) {
+            return bots[id]->getStatus() == CRakBot::DISCONNECTED;
+        });
+        if (connectDue) {
+            shard->queue.try_connect(bots);
+        }
+
+        for (auto id : due) {
+            if (!running.load()) {
+                break;
+            }
+            auto& bot = bots[id];
+            bot->process();
+            timers.schedule(id, steadyNowMs() + bot->getProcessDelay());
+        }
+        publishSnapshots();
+
+        double tickUs = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - tickStart).count();
+        {
+            std::lock_guard<std::mutex> lock(shard->statsMutex);
+            shard->ticks++;
+            shard->lastTickUs = tickUs;
+            shard->avgTickUs = shard->ticks == 1
+                ? tickUs
+                : shard->avgTickUs + TICK_AVG_ALPHA * (tickUs - shard->avgTickUs);
+            shard->maxTickUs = std::max(shard->maxTickUs, tickUs);
+        }
+    }
+}
+
+void CBotScheduler::publishSnapshots() {
+    uint64_t now = steadyNowMs();
+    uint64_t next = nextSnapshotMs.load();
+    if (now < next || !nextSnapshotMs.compare_exchange_strong(next, now + SNAPSHOT_INTERVAL_MS)) {
+        snapshotPending.store(true);
+        return;
+    }
+    snapshotPending.store(false);
+    CApp::getInstance()->getResourceManager()->publishSnapshots();
+}
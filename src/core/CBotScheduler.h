@@ -0,0 +1,109 @@
+//
+// CBotScheduler - Sharded tick loop for RakNet bots
+//
+
+#ifndef CBOTSCHEDULER_H
+#define CBOTSCHEDULER_H
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+#include "../models/CConnectionQueue.h"
+
+class CBot;
+
+// Snapshot of a shard's tick statistics (durations in microseconds)
+struct stShardStats {
+    int shard;
+    size_t bots;
+    uint64_t ticks;
+    double last_tick_us;
+    double avg_tick_us;
+    double max_tick_us;
+};
+
+// Every bot belongs to exactly one shard. Each shard runs its own thread with
+// its own tick loop and its own connection queue, so a slow process() call only
+// delays the bots of the same shard.
+//
+// Shards do not poll. Every bot has a timer on the shard's timer wheel set to
+// its next deadline (onfoot sync, respawn, waypoint, reconnect) and the shard
+// thread sleeps until the earliest one, or until RakNet queues a packet for
+// one of its bots.
+class CBotScheduler {
+public:
+    CBotScheduler(int shardCount, eConnectionPolicy policy);
+    ~CBotScheduler();
+
+    void start();
+    void stop();
+    bool isRunning() const;
+
+    // Bots are placed on the least loaded shard
+    void addBot(const std::shared_ptr<CBot>& bot);
+    void removeBot(const std::string& uuid);
+
+    size_t getShardCount() const;
+    std::vector<stShardStats> getStats() const;
+
+private:
+    // Shared with the packet arrival handlers of the shard's bots, which run
+    // on RakNet threads and may outlive the scheduler
+    struct stWaker {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool pending = false;
+
+        void notify();
+    };
+
+    struct Shard {
+        int index;
+        std::thread thread;
+        CConnectionQueue queue;
+        std::shared_ptr<stWaker> waker = std::make_shared<stWaker>();
+
+        // Bots owned by this shard, guarded by botsMutex. The tick loop works on
+        // its own copy which is refreshed whenever botsDirty is set.
+        mutable std::mutex botsMutex;
+        std::vector<std::shared_ptr<CBot>> bots;
+        std::atomic<bool> botsDirty{false};
+
+        mutable std::mutex statsMutex;
+        uint64_t ticks = 0;
+        double lastTickUs = 0.0;
+        double avgTickUs = 0.0;
+        double maxTickUs = 0.0;
+
+        Shard(int idx, eConnectionPolicy policy) : index(idx), queue(policy) {}
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<bool> running{false};
+
+    // World snapshots are published by whichever shard finishes a pass first
+    // once the interval is over. A pass that changed the pool too early leaves
+    // snapshotPending set so a shard wakes up to publish it.
+    std::atomic<uint64_t> nextSnapshotMs{0};
+    std::atomic<bool> snapshotPending{false};
+
+    void shardLoop(Shard* shard);
+    void publishSnapshots();
+
+    // Weight of the newest sample in the moving average of tick latency
+    static constexpr double TICK_AVG_ALPHA = 0.05;
+
+    // Longest a shard sleeps without any due timer or network input
+    static constexpr uint64_t MAX_IDLE_MS = 1000;
+
+    // Minimum time between two world snapshots
+    static constexpr uint64_t SNAPSHOT_INTERVAL_MS = 50;
+};
+
+#endif //CBOTSCHEDULER_H
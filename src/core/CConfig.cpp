@@ -10,7 +10,21 @@ CConfig::CConfig() :
     api_port(7070),
     connection_policy(eConnectionPolicy::QUEUED),
     message_encoding("GBK"),
-    enable_colandreas(true) {
+    enable_colandreas(true),
+    tick_shards(1),
+    network_threads(0),
+    nav_max_path_distance(6000.0f),
+    nav_max_search_nodes(1000000),
+    nav_cache_tiles(16384),
+    nav_file("data/navmesh.bin"),
+    nav_worker_threads(2),
+    nav_queue_size(256),
+    llm_max_in_flight(16),
+    llm_request_timeout(30),
+    llm_requests_per_minute(0),
+    llm_tokens_per_minute(0),
+    llm_state_keyframe_interval(6),
+    llm_history_tokens(6000) {
 }
 
 bool CConfig::loadConfigFile(const std::string &filename) {
@@ -79,6 +93,24 @@ nlohmann::json CConfig::toJson() const {
     j["connection_policy"] = connection_policy;
     j["message_encoding"] = message_encoding;
     j["enable_colandreas"] = enable_colandreas;
+    j["tick_shards"] = tick_shards;
+    j["network_threads"] = network_threads;
+    j["nav_max_path_distance"] = nav_max_path_distance;
+    j["nav_max_search_nodes"] = nav_max_search_nodes;
+    j["nav_cache_tiles"] = nav_cache_tiles;
+    j["nav_file"] = nav_file;
+    j["nav_worker_threads"] = nav_worker_threads;
+    j["nav_queue_size"] = nav_queue_size;
+    j["llm_max_in_flight"] = llm_max_in_flight;
+    j["llm_request_timeout"] = llm_request_timeout;
+    j["llm_requests_per_minute"] = llm_requests_per_minute;
+    j["llm_tokens_per_minute"] = llm_tokens_per_minute;
+    j["llm_provider_requests_per_minute"] = llm_provider_requests_per_minute;
+    j["llm_provider_tokens_per_minute"] = llm_provider_tokens_per_minute;
+    j["llm_state_keyframe_interval"] = llm_state_keyframe_interval;
+    j["llm_history_tokens"] = llm_history_tokens;
+    j["llm_model_history_tokens"] = llm_model_history_tokens;
+    j["llm_summary_provider"] = llm_summary_provider;
     return j;
 }
 
@@ -87,4 +119,22 @@ void CConfig::fromJson(const nlohmann::json &j) {
     connection_policy = j["connection_policy"];
     message_encoding =  j["message_encoding"];
     enable_colandreas = j["enable_colandreas"];
+    tick_shards = j.value("tick_shards", tick_shards);
+    network_threads = j.value("network_threads", network_threads);
+    nav_max_path_distance = j.value("nav_max_path_distance", nav_max_path_distance);
+    nav_max_search_nodes = j.value("nav_max_search_nodes", nav_max_search_nodes);
+    nav_cache_tiles = j.value("nav_cache_tiles", nav_cache_tiles);
+    nav_file = j.value("nav_file", nav_file);
+    nav_worker_threads = j.value("nav_worker_threads", nav_worker_threads);
+    nav_queue_size = j.value("nav_queue_size", nav_queue_size);
+    llm_max_in_flight = j.value("llm_max_in_flight", llm_max_in_flight);
+    llm_request_timeout = j.value("llm_request_timeout", llm_request_timeout);
+    llm_requests_per_minute = j.value("llm_requests_per_minute", llm_requests_per_minute);
+    llm_tokens_per_minute = j.value("llm_tokens_per_minute", llm_tokens_per_minute);
+    llm_provider_requests_per_minute = j.value("llm_provider_requests_per_minute", llm_provider_requests_per_minute);
+    llm_provider_tokens_per_minute = j.value("llm_provider_tokens_per_minute", llm_provider_tokens_per_minute);
+    llm_state_keyframe_interval = j.value("llm_state_keyframe_interval", llm_state_keyframe_interval);
+    llm_history_tokens = j.value("llm_history_tokens", llm_history_tokens);
+    llm_model_history_tokens = j.value("llm_model_history_tokens", llm_model_history_tokens);
+    llm_summary_provider = j.value("llm_summary_provider", llm_summary_provider);
 }
@@ -5,6 +5,7 @@
 #ifndef CCONFIG_H
 #define CCONFIG_H
 
+#include <map>
 #include <string>
 #include <hv/json.hpp>
 #include <fstream>
@@ -27,6 +28,24 @@ public:
     std::string base_internal_prompt;
     std::string message_encoding;
     bool enable_colandreas;
+    int tick_shards; // number of bot tick threads, 0 = one per CPU core
+    int network_threads; // shared RakNet network threads, 0 = one per CPU core, -1 = one thread per bot
+    float nav_max_path_distance; // longest straight distance a path is searched for, in metres
+    int nav_max_search_nodes; // cells a single path search may expand before giving up
+    int nav_cache_tiles; // sampled 32x32 m ground tiles kept in memory, about 5 KB each
+    std::string nav_file; // baked nav grid written by --bake-nav, empty to always sample ColAndreas
+    int nav_worker_threads; // path search threads, 0 = one per two CPU cores
+    int nav_queue_size; // path searches waiting for a worker before new ones are refused
+    int llm_max_in_flight; // LLM requests on the wire per provider URL, the rest wait for a free connection
+    int llm_request_timeout; // seconds before an LLM request is given up
+    int llm_requests_per_minute; // per provider, 0 = unlimited
+    int llm_tokens_per_minute; // per provider, prompt plus completion tokens, 0 = unlimited
+    std::map<std::string, int> llm_provider_requests_per_minute; // per provider name override of llm_requests_per_minute
+    std::map<std::string, int> llm_provider_tokens_per_minute; // per provider name override of llm_tokens_per_minute
+    int llm_state_keyframe_interval; // every n-th state message is a full one, the others only carry changes
+    int llm_history_tokens; // estimated tokens of conversation history kept per session, older turns get summarized
+    std::map<std::string, int> llm_model_history_tokens; // per model override of llm_history_tokens
+    std::string llm_summary_provider; // provider name that summarizes old turns, empty = the session's own provider
 
     nlohmann::json toJson() const;
     void fromJson(const nlohmann::json& j);
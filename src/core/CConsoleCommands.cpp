@@ -5,6 +5,13 @@
 #include "../core/CLLMBotSessionManager.h"
 #include "../core/CPersistentDataStorage.h"
 #include "../core/CConfig.h"
+#include "../core/CBotScheduler.h"
+#include "../core/CStreamableCache.h"
+#include "../utils/CFunctionDispatcher.h"
+#include "../physics/CNavGrid.h"
+#include "../physics/CPathFinder.h"
+#include "../physics/CPathWorkerPool.h"
+#include "SharedUpdateLoop.h"
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
@@ -190,6 +197,31 @@ void CConsoleCommands::registerSystemCommands(CConsole* console) {
             
             console->println("\n=== Configuration ===");
             console->println("Connection Policy: " + std::to_string(static_cast<int>(config->connection_policy)));
+            console->println("Tick Shards: " + std::to_string(config->tick_shards));
+            console->println("Network Threads: " + std::to_string(config->network_threads));
+            console->println("Nav Max Path Distance: " + std::to_string(config->nav_max_path_distance));
+            console->println("Nav Max Search Nodes: " + std::to_string(config->nav_max_search_nodes));
+            console->println("Nav Cache Tiles: " + std::to_string(config->nav_cache_tiles));
+            console->println("Nav Worker Threads: " + std::to_string(config->nav_worker_threads));
+            console->println("Nav Queue Size: " + std::to_string(config->nav_queue_size));
+            console->println("LLM Max In Flight: " + std::to_string(config->llm_max_in_flight));
+            console->println("LLM Request Timeout: " + std::to_string(config->llm_request_timeout) + "s");
+            console->println("LLM Requests Per Minute: " + std::to_string(config->llm_requests_per_minute));
+            console->println("LLM Tokens Per Minute: " + std::to_string(config->llm_tokens_per_minute));
+            for (const auto& [provider, rpm] : config->llm_provider_requests_per_minute) {
+                console->println("  " + provider + " requests: " + std::to_string(rpm));
+            }
+            for (const auto& [provider, tpm] : config->llm_provider_tokens_per_minute) {
+                console->println("  " + provider + " tokens: " + std::to_string(tpm));
+            }
+            console->println("LLM State Keyframe Interval: " + std::to_string(config->llm_state_keyframe_interval));
+            console->println("LLM History Tokens: " + std::to_string(config->llm_history_tokens));
+            for (const auto& [model, tokens] : config->llm_model_history_tokens) {
+                console->println("  " + model + ": " + std::to_string(tokens));
+            }
+            console->println("LLM Summary Provider: " + (config->llm_summary_provider.empty()
+                                                              ? std::string("(session provider)")
+                                                              : config->llm_summary_provider));
             console->println("");
         },
         "config"
@@ -200,14 +232,140 @@ void CConsoleCommands::registerSystemCommands(CConsole* console) {
         [](const std::vector<std::string>&) {
             auto console = CApp::getInstance()->getConsole();
             
+            auto scheduler = CApp::getInstance()->getBotScheduler();
+
             console->println("\n=== Thread Information ===");
-            console->println("Main Thread: Bot processing loop");
+            console->println("Main Thread: Waits for shutdown");
+            console->println("Bot Shard Threads: " + std::to_string(scheduler->getShardCount()));
+            if (SharedUpdateLoop::Instance()->IsRunning()) {
+                console->println("Network Threads: " + std::to_string(SharedUpdateLoop::Instance()->GetNumberOfThreads()) +
+                                 " shared by " + std::to_string(SharedUpdateLoop::Instance()->GetNumberOfPeers()) + " peer(s)");
+            } else {
+                console->println("Network Threads: One RakNet thread per connected bot");
+            }
             console->println("API Server Thread: HTTP API server");
             console->println("Console Thread: Debug console (current)");
             console->println("");
         },
         "threads"
     });
+
+    console->registerCommand("shards", {
+        "Show bot scheduler shards and tick latency",
+        [](const std::vector<std::string>&) {
+            auto console = CApp::getInstance()->getConsole();
+            auto scheduler = CApp::getInstance()->getBotScheduler();
+
+            console->println("\n=== Bot Shards ===");
+            std::ostringstream header;
+            header << std::left << std::setw(8) << "Shard"
+                   << std::setw(8) << "Bots"
+                   << std::setw(14) << "Ticks"
+                   << std::setw(14) << "Last(us)"
+                   << std::setw(14) << "Avg(us)"
+                   << std::setw(14) << "Max(us)";
+            console->println(header.str());
+            console->println(std::string(72, '-'));
+
+            for (const auto& stats : scheduler->getStats()) {
+                std::ostringstream row;
+                row << std::left << std::fixed << std::setprecision(1)
+                    << std::setw(8) << stats.shard
+                    << std::setw(8) << stats.bots
+                    << std::setw(14) << stats.ticks
+                    << std::setw(14) << stats.last_tick_us
+                    << std::setw(14) << stats.avg_tick_us
+                    << std::setw(14) << stats.max_tick_us;
+                console->println(row.str());
+            }
+            console->println("");
+        },
+        "shards"
+    });
+
+    console->registerCommand("streamables", {
+        "Show streamed records held by bots and the distinct ones shared per server",
+        [](const std::vector<std::string>&) {
+            auto console = CApp::getInstance()->getConsole();
+            auto app = CApp::getInstance();
+
+            size_t objects = 0, pickups = 0, labels = 0, ownBytes = 0;
+            for (const auto& bot : app->getDatabase()->vBots) {
+                auto streamables = bot->getStreamableSnapshot();
+                objects += streamables->getObjectCount();
+                pickups += streamables->getPickupCount();
+                labels += streamables->getLabelCount();
+                ownBytes += streamables->getMemoryUsage();
+            }
+            auto stats = app->getStreamableCache()->getStats();
+
+            console->println("\n=== Streamable Records ===");
+            console->println("Servers: " + std::to_string(stats.servers));
+            console->println("Objects: " + std::to_string(objects) + " held by bots, " + std::to_string(stats.objects) + " distinct");
+            console->println("Pickups: " + std::to_string(pickups) + " held by bots, " + std::to_string(stats.pickups) + " distinct");
+            console->println("Labels: " + std::to_string(labels) + " held by bots, " + std::to_string(stats.labels) + " distinct");
+            console->println("Texts: " + std::to_string(stats.texts) + " distinct");
+            console->println("Memory: " + std::to_string(ownBytes) + " bytes in bot indexes, " + std::to_string(stats.bytes) + " bytes shared");
+            console->println("");
+        },
+        "streamables"
+    });
+
+    console->registerCommand("nav_path", {
+        "Search a path on the navigation grid and show search, cache and worker statistics",
+        [](const std::vector<std::string>& args) {
+            auto console = CApp::getInstance()->getConsole();
+            auto grid = CApp::getInstance()->getNavGrid();
+            if (!grid) {
+                console->println("Navigation grid is not initialized");
+                return;
+            }
+
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(1) << "\n=== Navigation ===\n";
+            if (args.size() >= 7) {
+                glm::vec3 from, to;
+                try {
+                    from = glm::vec3(std::stof(args[1]), std::stof(args[2]), std::stof(args[3]));
+                    to = glm::vec3(std::stof(args[4]), std::stof(args[5]), std::stof(args[6]));
+                } catch (...) {
+                    console->println("Usage: nav_path <x1> <y1> <z1> <x2> <y2> <z2>");
+                    return;
+                }
+
+                CPathFinder pathFinder;
+                auto path = pathFinder.findPath(from, to);
+                const auto& stats = pathFinder.getLastSearchStats();
+                out << (stats.found ? "Path found" : stats.differentRegions ? "No path (unconnected regions)" : "No path")
+                    << " in " << stats.milliseconds << " ms, "
+                    << stats.expandedNodes << " cells expanded over " << stats.tiles << " tiles\n";
+                if (stats.found) {
+                    out << "Waypoints: " << stats.waypoints << ", length " << stats.length << " m\n";
+                    for (const auto& waypoint : path) {
+                        out << "  (" << waypoint.x << ", " << waypoint.y << ", " << waypoint.z << ")\n";
+                    }
+                }
+            }
+
+            auto cache = grid->getStats();
+            out << "Source: " << (grid->hasBakedFile() ? "baked nav file" : "ColAndreas rays") << "\n";
+            out << "Cache: " << cache.cachedTiles << " tiles, " << cache.memoryBytes / (1024 * 1024) << " MB, "
+                << cache.hits << " hits, " << cache.misses << " misses, "
+                << cache.tilesSampled << " tiles sampled with " << cache.raysCast << " rays\n";
+            if (auto pool = CApp::getInstance()->getPathWorkerPool()) {
+                auto workers = pool->getStats();
+                out << "Workers: " << workers.workers << ", queue " << workers.queueDepth << "/" << workers.queueCapacity
+                    << " (peak " << workers.maxQueueDepth << ")\n";
+                out << "Requests: " << workers.submitted << " submitted, " << workers.deduplicated << " deduplicated, "
+                    << workers.rejected << " rejected, " << workers.cancelled << " cancelled, "
+                    << workers.completed << " found, " << workers.failed << " failed\n";
+                out << std::setprecision(2) << "Latency: avg " << workers.avgLatencyMs << " ms, max " << workers.maxLatencyMs
+                    << " ms (queued avg " << workers.avgWaitMs << " ms, max " << workers.maxWaitMs << " ms)\n";
+            }
+            console->println(out.str());
+        },
+        "nav_path [<x1> <y1> <z1> <x2> <y2> <z2>]"
+    });
 }
 
 void CConsoleCommands::registerLLMCommands(CConsole* console) {
@@ -221,14 +379,81 @@ void CConsoleCommands::registerLLMCommands(CConsole* console) {
                 console->println("\n=== LLM Sessions ===");
                 console->println("Active sessions: " + std::to_string(sessionMgr->getActiveSessionCount()));
                 console->println("");
+            } else if (args.size() > 1 && args[1] == "limits") {
+                auto providers = sessionMgr->getRateLimiter()->getStats();
+                std::ostringstream out;
+                out << std::fixed << std::setprecision(1) << "\n=== LLM Rate Limits ===\n";
+                if (providers.empty()) {
+                    out << "No requests scheduled yet\n";
+                }
+                auto budget = [](double available) {
+                    return available < 0.0 ? std::string("unlimited") : std::to_string(static_cast<long long>(available));
+                };
+                for (const auto& provider : providers) {
+                    out << provider.provider << "\n"
+                        << "  Available: " << budget(provider.requests_available) << " requests, "
+                        << budget(provider.tokens_available) << " tokens\n"
+                        << "  Granted: " << provider.granted << ", throttled passes " << provider.throttled
+                        << ", 429 responses " << provider.rate_limited << "\n";
+                    if (provider.blocked_seconds > 0.0) {
+                        out << "  Backing off for " << provider.blocked_seconds << " s\n";
+                    }
+                }
+                console->println(out.str());
+            } else if (args.size() > 1 && args[1] == "http") {
+                auto endpoints = CApp::getInstance()->getFunctionDispatcher()->getHttpStats();
+                std::ostringstream out;
+                out << std::fixed << std::setprecision(1) << "\n=== LLM Connection Pools ===\n";
+                if (endpoints.empty()) {
+                    out << "No requests sent yet\n";
+                }
+                for (const auto& endpoint : endpoints) {
+                    out << endpoint.base_url << "\n"
+                        << "  In flight: " << endpoint.in_flight << ", queued " << endpoint.queued
+                        << " (peak " << endpoint.max_queued << ")\n"
+                        << "  Requests: " << endpoint.requests << ", failures " << endpoint.failures << "\n"
+                        << "  Round trip: avg " << endpoint.avg_round_trip_ms << " ms, p50 <= "
+                        << CLLMHttpPool::percentile(endpoint, 0.5) << " ms, p95 <= "
+                        << CLLMHttpPool::percentile(endpoint, 0.95) << " ms, max " << endpoint.max_round_trip_ms << " ms\n"
+                        << "  Queued: avg " << endpoint.avg_queue_ms << " ms\n"
+                        << "  Histogram:";
+                    for (size_t i = 0; i < endpoint.round_trip_buckets.size(); i++) {
+                        if (i < CLLMHttpPool::LATENCY_BUCKETS_MS.size()) {
+                            out << " <=" << CLLMHttpPool::LATENCY_BUCKETS_MS[i] << ":";
+                        } else {
+                            out << " >" << CLLMHttpPool::LATENCY_BUCKETS_MS.back() << ":";
+                        }
+                        out << endpoint.round_trip_buckets[i];
+                    }
+                    out << "\n";
+                }
+                console->println(out.str());
             } else {
                 console->println("\n=== LLM Information ===");
                 console->println("Session Manager: Active");
                 console->println("Total Sessions: " + std::to_string(sessionMgr->getActiveSessionCount()));
+                auto rounds = sessionMgr->getRoundStats();
+                console->println("Rounds: " + std::to_string(rounds["scheduled"].get<uint64_t>()) + " scheduled, " +
+                                 std::to_string(rounds["woken"].get<uint64_t>()) + " woken by bot events, " +
+                                 std::to_string(rounds["skipped_unchanged"].get<uint64_t>()) + " skipped with unchanged state");
+                auto fullBytes = rounds["state_full_bytes"].get<uint64_t>();
+                auto savedBytes = rounds["state_saved_bytes"].get<uint64_t>();
+                console->println("State messages: " + std::to_string(rounds["state_messages"].get<uint64_t>()) + " (" +
+                                 std::to_string(rounds["state_keyframes"].get<uint64_t>()) + " keyframes), " +
+                                 std::to_string(rounds["state_sent_bytes"].get<uint64_t>()) + " of " +
+                                 std::to_string(fullBytes) + " bytes sent, ~" +
+                                 std::to_string(rounds["state_saved_tokens"].get<uint64_t>()) + " tokens saved (" +
+                                 std::to_string(fullBytes ? savedBytes * 100 / fullBytes : 0) + "%)");
+                console->println("History: ~" + std::to_string(rounds["history_tokens"].get<uint64_t>()) +
+                                 " tokens kept, " + std::to_string(rounds["history_dropped"].get<uint64_t>()) +
+                                 " messages trimmed, " + std::to_string(rounds["history_summaries"].get<uint64_t>()) +
+                                 " summaries");
                 console->println("");
                 console->println("Usage: llm sessions - Show detailed session info");
+                console->println("       llm limits   - Show the rate limit budget of each provider");
+                console->println("       llm http     - Show connection pools and round trip times per provider");
             }
         },
-        "llm [sessions]"
+        "llm [sessions|limits|http]"
     });
 }
\ No newline at end of file
@@ -4,12 +4,18 @@
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <queue>
 #include <spdlog/spdlog.h>
 
+#include "CConfig.h"
 #include "CLogger.h"
 #include "CPersistentDataStorage.h"
 
-CLLMBotSessionManager::CLLMBotSessionManager() {
+CLLMBotSessionManager::CLLMBotSessionManager()
+    : rate_limiter(CApp::getInstance()->getConfig()->llm_requests_per_minute,
+                   CApp::getInstance()->getConfig()->llm_tokens_per_minute,
+                   CApp::getInstance()->getConfig()->llm_provider_requests_per_minute,
+                   CApp::getInstance()->getConfig()->llm_provider_tokens_per_minute) {
     startAsyncUpdates();
 }
 
@@ -24,6 +30,7 @@ std::string CLLMBotSessionManager::createSession(std::shared_ptr<CBot> bot, std:
     
     std::string session_id = generateSessionId();
     auto session = std::make_unique<CLLMBotSession>(session_id, bot, llm_provider);
+    session->next_update = nextUpdateTime(std::chrono::steady_clock::now(), 0.0);
     
     sessions[session_id] = std::move(session);
     botSessionMap[bot->getUuid()] = session_id;
@@ -37,6 +44,8 @@ std::string CLLMBotSessionManager::createSession(std::shared_ptr<CBot> bot, std:
 
 void CLLMBotSessionManager::restoreSession(const std::string &session_id, std::unique_ptr<CLLMBotSession> session) {
     if (sessions.find(session_id) == sessions.end() && session && session->bot) {
+        // Restored sessions would otherwise all fire on the first pass after startup
+        session->next_update = nextUpdateTime(std::chrono::steady_clock::now(), 0.0);
         std::string bot_uuid = session->bot->getUuid();
         botSessionMap[bot_uuid] = session_id;
         // Save session info before moving
@@ -180,55 +189,209 @@ void CLLMBotSessionManager::setUpdateInterval(std::chrono::milliseconds interval
 }
 
 void CLLMBotSessionManager::triggerUpdate(const std::string& session_id) {
-    std::lock_guard<std::mutex> sessions_lock(sessions_mutex);
-    auto it = sessions.find(session_id);
-    if (it != sessions.end() && it->second->is_active) {
-        processSessionUpdate(it->second.get());
+    {
+        std::lock_guard<std::mutex> sessions_lock(sessions_mutex);
+        auto it = sessions.find(session_id);
+        if (it == sessions.end() || !it->second->is_active) {
+            return;
+        }
+        // Still goes through the rate limiter, on the next pass
+        it->second->update_requested = true;
+        it->second->next_update = std::chrono::steady_clock::now();
+    }
+    wake();
+}
+
+void CLLMBotSessionManager::wake() {
+    wake_pending.store(true);
+    update_cv.notify_all();
+}
+
+json CLLMBotSessionManager::getRoundStats() const {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    CStateDeltaEncoder::stStats states;
+    uint64_t history_tokens = 0;
+    uint64_t history_dropped = 0;
+    uint64_t summaries = 0;
+    for (const auto& pair : sessions) {
+        history_tokens += pair.second->conversation_history.getTokens();
+        history_dropped += pair.second->conversation_history.getDropped();
+        {
+            std::lock_guard<std::mutex> summary_lock(pair.second->summary_mutex);
+            summaries += pair.second->summaries_made;
+        }
+        const auto& encoder = pair.second->state_encoder.getStats();
+        states.rounds += encoder.rounds;
+        states.keyframes += encoder.keyframes;
+        states.full_bytes += encoder.full_bytes;
+        states.sent_bytes += encoder.sent_bytes;
     }
+    uint64_t saved_bytes = states.full_bytes > states.sent_bytes ? states.full_bytes - states.sent_bytes : 0;
+    return json{
+        {"scheduled", rounds_scheduled},
+        {"woken", rounds_woken},
+        {"skipped_unchanged", rounds_skipped},
+        {"state_messages", states.rounds},
+        {"state_keyframes", states.keyframes},
+        {"state_full_bytes", states.full_bytes},
+        {"state_sent_bytes", states.sent_bytes},
+        {"state_saved_bytes", saved_bytes},
+        {"state_saved_tokens", CStateDeltaEncoder::estimateTokens(saved_bytes)},
+        {"history_tokens", history_tokens},
+        {"history_dropped", history_dropped},
+        {"history_summaries", summaries}
+    };
 }
 
 void CLLMBotSessionManager::asyncUpdateLoop() {
     while (!should_stop) {
         std::unique_lock<std::mutex> lock(update_mutex);
         
-        // Wait for the specified interval or until signaled to stop
-        if (update_cv.wait_for(lock, update_interval, [this] { return should_stop.load(); })) {
-            break; // should_stop was set to true
+        // Wait for the specified interval, a wake signal or until signaled to stop
+        update_cv.wait_for(lock, update_interval, [this] { return should_stop.load() || wake_pending.load(); });
+        if (should_stop) {
+            break;
         }
+        wake_pending.store(false);
         
-        // Process all active sessions
         std::lock_guard<std::mutex> sessions_lock(sessions_mutex);
-        for (const auto& pair : sessions) {
-            if (pair.second->is_active && !should_stop) {
-                processSessionUpdate(pair.second.get());
-            }
-        }
+        scheduleSessionUpdates();
         
         // Cleanup expired sessions
         cleanupExpiredSessions();
     }
 }
 
+// Starts the rounds of every due session, most urgent first. A session whose
+// provider is out of budget stays due and is retried on the next pass.
+void CLLMBotSessionManager::scheduleSessionUpdates() {
+    struct stDueSession {
+        int priority;
+        std::chrono::steady_clock::time_point due;
+        CLLMBotSession* session;
+
+        bool operator<(const stDueSession& other) const {
+            if (priority != other.priority) {
+                return priority < other.priority;
+            }
+            return due > other.due;
+        }
+    };
+
+    auto now = std::chrono::steady_clock::now();
+    std::priority_queue<stDueSession> queue;
+    for (const auto& pair : sessions) {
+        CLLMBotSession* session = pair.second.get();
+        if (!session->is_active || !session->bot) {
+            continue;
+        }
+
+        // Signals raised while a round is in flight are kept for the next one
+        uint32_t signals = session->bot->consumeWakeSignals();
+        if (signals & CBot::WAKE_CHAT) {
+            // Bots answering each other would otherwise keep waking each other every MIN_ROUND_GAP
+            if (now - session->last_chat_wake < autonomous_interval / 2) {
+                signals &= ~static_cast<uint32_t>(CBot::WAKE_CHAT);
+            } else {
+                session->last_chat_wake = now;
+            }
+        }
+        if (signals) {
+            if (session->wake_signals == 0) {
+                session->wake_at = std::max(now + WAKE_DEBOUNCE, session->last_round + MIN_ROUND_GAP);
+            }
+            session->wake_signals |= signals;
+        }
+        if (session->is_idle_waiting_llm) {
+            continue;
+        }
+
+        bool woken = session->wake_signals != 0 && session->wake_at <= now;
+        if (woken) {
+            queue.push({getUpdatePriority(session), session->wake_at, session});
+        } else if (session->next_update <= now) {
+            if (!session->update_requested && isIdleAndUnchanged(session)) {
+                // Nothing happened since the LLM last chose to do nothing
+                session->skipped_rounds++;
+                session->next_update = nextUpdateTime(now, 1.0 - UPDATE_JITTER);
+                rounds_skipped++;
+                continue;
+            }
+            queue.push({getUpdatePriority(session), session->next_update, session});
+        }
+    }
+
+    while (!queue.empty() && !should_stop) {
+        CLLMBotSession* session = queue.top().session;
+        queue.pop();
+
+        int tokens = session->estimated_tokens > 0 ? session->estimated_tokens : DEFAULT_ESTIMATED_TOKENS;
+        if (session->llm_provider && !rate_limiter.tryAcquire(session->llm_provider->getName(), tokens)) {
+            continue;
+        }
+        session->reserved_tokens = tokens;
+        processSessionUpdate(session);
+    }
+}
+
+int CLLMBotSessionManager::getUpdatePriority(CLLMBotSession* session) {
+    if (session->update_requested) {
+        return 2;
+    }
+    if (session->bot->isDialogActive() || !session->bot->getImportantEvents()->empty() ||
+        (session->wake_signals & (CBot::WAKE_DIALOG | CBot::WAKE_HEALTH))) {
+        return 1;
+    }
+    return 0;
+}
+
+bool CLLMBotSessionManager::isIdleAndUnchanged(CLLMBotSession* session) {
+    if (session->last_round_had_tools || session->skipped_rounds >= MAX_SKIPPED_ROUNDS) {
+        return false;
+    }
+    if (!session->bot->getImportantEvents()->empty() || !session->bot->getUnreadChatMessage()->empty()) {
+        return false;
+    }
+    return session->bot->getStateHash() == session->last_state_hash;
+}
+
+std::chrono::steady_clock::time_point CLLMBotSessionManager::nextUpdateTime(
+    std::chrono::steady_clock::time_point from, double min_fraction) {
+    std::uniform_real_distribution<double> fraction(min_fraction, 1.0 + UPDATE_JITTER);
+    auto delay = std::chrono::duration<double, std::milli>(autonomous_interval.count() * fraction(jitter_rng));
+    return from + std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay);
+}
+
 void CLLMBotSessionManager::processSessionUpdate(CLLMBotSession* session) {
     if (!session || !session->bot || !session->is_active) {
+        releaseUnsentRound(session);
         return;
     }
-    
-    // // Skip autonomous updates if session is idle waiting for LLM response
-    // if (session->is_idle_waiting_llm) {
-    //     return;
-    // }
-    //
-    // Check if the bot should perform an LLM API call
-    if (!session->is_idle_waiting_llm) {
-        if (session->checkActionCooldown("llm_update", std::chrono::seconds(10))) {
-            // Delegate autonomous update logic to the session itself
-            session->performAutonomousUpdate();
-
-            // Set cooldown and update activity
-            session->setActionCooldown("llm_update");
-            session->updateActivity();
-        }
+
+    // Delegate autonomous update logic to the session itself
+    auto now = std::chrono::steady_clock::now();
+    rounds_scheduled++;
+    if (session->wake_signals != 0) {
+        rounds_woken++;
+    }
+    session->update_requested = false;
+    session->wake_signals = 0;
+    session->skipped_rounds = 0;
+    session->last_round = now;
+    session->next_update = nextUpdateTime(now, 1.0 - UPDATE_JITTER);
+    if (!session->performAutonomousUpdate()) {
+        releaseUnsentRound(session);
+    }
+    session->updateActivity();
+}
+
+// Gives back what scheduleSessionUpdates() acquired for a round that never went out
+void CLLMBotSessionManager::releaseUnsentRound(CLLMBotSession* session) {
+    if (session && session->reserved_tokens > 0 && session->llm_provider) {
+        rate_limiter.cancel(session->llm_provider->getName(), session->reserved_tokens);
+    }
+    if (session) {
+        session->reserved_tokens = 0;
     }
 }
 
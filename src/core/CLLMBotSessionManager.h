@@ -2,6 +2,7 @@
 
 #include "../models/CLLMBotSession.h"
 #include "../models/CLLMProvider.h"
+#include "../utils/CLLMRateLimiter.h"
 #include <unordered_map>
 #include <memory>
 #include <mutex>
@@ -11,6 +12,7 @@
 #include <thread>
 #include <condition_variable>
 #include <atomic>
+#include <random>
 #include <hv/json.hpp>
 
 using json = nlohmann::json;
@@ -31,7 +33,19 @@ private:
     std::condition_variable update_cv;
     std::mutex update_mutex;
     std::atomic<bool> should_stop{false};
-    std::chrono::milliseconds update_interval{5000}; // 5 seconds default
+    std::atomic<bool> wake_pending{false};
+    std::chrono::milliseconds update_interval{250}; // how often due sessions are looked for
+
+    // Autonomous rounds run every autonomous_interval per session, spread
+    // by jitter so sessions created together do not stay in lockstep
+    std::chrono::milliseconds autonomous_interval{10000};
+    CLLMRateLimiter rate_limiter;
+    std::mt19937 jitter_rng{std::random_device{}()};  // guarded by sessions_mutex
+
+    // Round counters, guarded by sessions_mutex
+    uint64_t rounds_scheduled = 0;
+    uint64_t rounds_woken = 0;
+    uint64_t rounds_skipped = 0;
 
 public:
     CLLMBotSessionManager();
@@ -55,6 +69,8 @@ public:
     void stopAsyncUpdates();
     void setUpdateInterval(std::chrono::milliseconds interval);
     void triggerUpdate(const std::string& session_id);
+    // Called by bots raising a wake signal, from any thread and without locking
+    void wake();
     
     // Configuration
     void setSessionTimeout(std::chrono::minutes timeout);
@@ -64,6 +80,8 @@ public:
     std::vector<json> getAllSessionsInfo() const;
     size_t getActiveSessionCount() const;
     bool hasSession(const std::string& session_id) const;
+    CLLMRateLimiter* getRateLimiter() { return &rate_limiter; }
+    json getRoundStats() const;
 
     CBot* getBotFromLLMSession(const std::string& session_id) const;
     CLLMBotSession* getLLMSessionFromBot(const std::string& bot_uuid) const;
@@ -72,5 +90,21 @@ public:
 private:
     std::string generateSessionId();
     void asyncUpdateLoop();
+    void scheduleSessionUpdates();
     void processSessionUpdate(CLLMBotSession* session);
+    void releaseUnsentRound(CLLMBotSession* session);
+    static int getUpdatePriority(CLLMBotSession* session);
+    static bool isIdleAndUnchanged(CLLMBotSession* session);
+    std::chrono::steady_clock::time_point nextUpdateTime(std::chrono::steady_clock::time_point from, double min_fraction);
+
+    // Token estimate for a session whose request size is not known yet
+    static constexpr int DEFAULT_ESTIMATED_TOKENS = 2000;
+    // Next round lands between 80% and 120% of the interval
+    static constexpr double UPDATE_JITTER = 0.2;
+    // Wake signals are collected this long so a burst of chat lines or damage makes one round
+    static constexpr std::chrono::milliseconds WAKE_DEBOUNCE{500};
+    // Shortest time between the starts of two rounds of one session
+    static constexpr std::chrono::milliseconds MIN_ROUND_GAP{2000};
+    // Scheduled rounds skipped in a row for an unchanged state before one runs anyway
+    static constexpr int MAX_SKIPPED_ROUNDS = 5;
 };
\ No newline at end of file
@@ -233,8 +233,7 @@ bool CPersistentDataStorage::loadObjects() {
                 // Set host and port from server cache
                 if (server_cache.find(server_id) != server_cache.end()) {
                     auto &server_info = server_cache.at(server_id);
-                    bot->setHost(server_info.first);
-                    bot->setPort(server_info.second);
+                    bot->setServer(server_info.first, server_info.second);
                 }
                 // Note: invulnerable property could be added to CBot if needed
 
@@ -0,0 +1,36 @@
+//
+// CServerRegistry - Interns host:port pairs into dense server handles
+//
+
+#include "CServerRegistry.h"
+
+ServerHandle CServerRegistry::intern(const std::string& host, int port) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto it = handles.find({host, port});
+    if (it != handles.end()) {
+        return it->second;
+    }
+    auto handle = static_cast<ServerHandle>(addresses.size());
+    addresses.emplace_back(host, port);
+    handles.emplace(addresses.back(), handle);
+    return handle;
+}
+
+ServerHandle CServerRegistry::find(const std::string& host, int port) const {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto it = handles.find({host, port});
+    return it != handles.end() ? it->second : INVALID_SERVER_HANDLE;
+}
+
+ServerAddress CServerRegistry::getAddress(ServerHandle handle) const {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (handle >= addresses.size()) {
+        return {};
+    }
+    return addresses[handle];
+}
+
+size_t CServerRegistry::size() const {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return addresses.size();
+}
@@ -0,0 +1,39 @@
+//
+// CServerRegistry - Interns host:port pairs into dense server handles
+//
+
+#ifndef CSERVERREGISTRY_H
+#define CSERVERREGISTRY_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using ServerAddress = std::pair<std::string, int>;
+
+// Dense index of a host:port pair, stable for the lifetime of the process
+using ServerHandle = uint32_t;
+constexpr ServerHandle INVALID_SERVER_HANDLE = UINT32_MAX;
+
+// Every server address is resolved to a handle once (bot connect, server
+// load) and hot paths pass the handle around instead of the address, so
+// per-packet code never hashes, compares or copies host strings.
+class CServerRegistry {
+public:
+    // Returns the existing handle of host:port or assigns the next free one
+    ServerHandle intern(const std::string& host, int port);
+    ServerHandle find(const std::string& host, int port) const;
+
+    ServerAddress getAddress(ServerHandle handle) const;
+    size_t size() const;
+
+private:
+    mutable std::mutex registryMutex;
+    std::map<ServerAddress, ServerHandle> handles;
+    std::vector<ServerAddress> addresses;
+};
+
+#endif //CSERVERREGISTRY_H
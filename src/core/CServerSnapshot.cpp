@@ -0,0 +1,43 @@
+//
+// CServerSnapshot - Immutable copy of a server's shared players and vehicles
+//
+
+#include "CServerSnapshot.h"
+
+CServerSnapshot::CServerSnapshot(const stServerResources& resources)
+    : version(resources.version),
+      players(resources.players.begin(), resources.players.begin() + resources.playerCount),
+      vehicles(resources.vehicles.begin(), resources.vehicles.begin() + resources.vehicleCount) {
+    playerX.reserve(players.size());
+    playerY.reserve(players.size());
+    playerZ.reserve(players.size());
+    for (const auto& player : players) {
+        playerX.push_back(player.position.x);
+        playerY.push_back(player.position.y);
+        playerZ.push_back(player.position.z);
+    }
+
+    vehicleX.reserve(vehicles.size());
+    vehicleY.reserve(vehicles.size());
+    vehicleZ.reserve(vehicles.size());
+    for (const auto& vehicle : vehicles) {
+        vehicleX.push_back(vehicle.position.x);
+        vehicleY.push_back(vehicle.position.y);
+        vehicleZ.push_back(vehicle.position.z);
+    }
+}
+
+size_t CServerSnapshot::countPlayersInRange(const glm::vec3& position, float range, bool npc_included) const {
+    if (npc_included) {
+        return RangeFilter::countInRange(playerX.data(), playerY.data(), playerZ.data(), players.size(),
+                                         position.x, position.y, position.z, range * range);
+    }
+    size_t count = 0;
+    forEachPlayerInRange(position, range, false, [&count](const stPlayer&) { count++; });
+    return count;
+}
+
+size_t CServerSnapshot::countVehiclesInRange(const glm::vec3& position, float range) const {
+    return RangeFilter::countInRange(vehicleX.data(), vehicleY.data(), vehicleZ.data(), vehicles.size(),
+                                     position.x, position.y, position.z, range * range);
+}
@@ -0,0 +1,66 @@
+//
+// CServerSnapshot - Immutable copy of a server's shared players and vehicles
+//
+
+#ifndef CSERVERSNAPSHOT_H
+#define CSERVERSNAPSHOT_H
+
+#include <cstdint>
+#include <vector>
+
+#include "CSharedResourcePool.h"
+#include "../utils/RangeFilter.h"
+
+// Published by CSharedResourcePool::publishSnapshots() and handed out as
+// shared_ptr<const CServerSnapshot>. Nothing changes after construction, so
+// any number of threads can query one without locking. Positions are kept
+// column-wise next to the records for RangeFilter.
+class CServerSnapshot {
+public:
+    CServerSnapshot() = default;
+    explicit CServerSnapshot(const stServerResources& resources);
+
+    // Pool version the snapshot was taken at
+    uint64_t getVersion() const { return version; }
+
+    const std::vector<stPlayer>& getPlayers() const { return players; }
+    const std::vector<stVehicle>& getVehicles() const { return vehicles; }
+
+    template <typename Fn>
+    void forEachPlayerInRange(const glm::vec3& position, float range, bool npc_included, Fn&& fn) const;
+    template <typename Fn>
+    void forEachVehicleInRange(const glm::vec3& position, float range, Fn&& fn) const;
+    size_t countPlayersInRange(const glm::vec3& position, float range, bool npc_included) const;
+    size_t countVehiclesInRange(const glm::vec3& position, float range) const;
+
+private:
+    uint64_t version = 0;
+    std::vector<stPlayer> players;
+    std::vector<stVehicle> vehicles;
+    std::vector<float> playerX, playerY, playerZ;
+    std::vector<float> vehicleX, vehicleY, vehicleZ;
+};
+
+template <typename Fn>
+void CServerSnapshot::forEachPlayerInRange(const glm::vec3& position, float range, bool npc_included, Fn&& fn) const {
+    uint16_t indices[stServerResources::MAX_IDS];
+    size_t found = RangeFilter::inRange(playerX.data(), playerY.data(), playerZ.data(), players.size(),
+                                        position.x, position.y, position.z, range * range, indices);
+    for (size_t i = 0; i < found; i++) {
+        const auto& player = players[indices[i]];
+        if (!npc_included && player.is_npc) continue;
+        fn(player);
+    }
+}
+
+template <typename Fn>
+void CServerSnapshot::forEachVehicleInRange(const glm::vec3& position, float range, Fn&& fn) const {
+    uint16_t indices[stServerResources::MAX_IDS];
+    size_t found = RangeFilter::inRange(vehicleX.data(), vehicleY.data(), vehicleZ.data(), vehicles.size(),
+                                        position.x, position.y, position.z, range * range, indices);
+    for (size_t i = 0; i < found; i++) {
+        fn(vehicles[indices[i]]);
+    }
+}
+
+#endif //CSERVERSNAPSHOT_H
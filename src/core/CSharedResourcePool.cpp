@@ -3,8 +3,10 @@
 //
 
 #include "CSharedResourcePool.h"
+#include "CServerSnapshot.h"
 #include <algorithm>
 
+
 #include "glm/detail/func_geometric.inl"
 #include "spdlog/spdlog.h"
 
@@ -14,317 +16,339 @@ CSharedResourcePool::CSharedResourcePool() {
 CSharedResourcePool::~CSharedResourcePool() {
 }
 
-void CSharedResourcePool::addServer(CServer *server) {
-    ServerAddress addr = std::make_pair(server->getHost(), server->getPort());
-    serverResources[addr] = stServerResources{};
+CSharedResourcePool::WriteView CSharedResourcePool::writeResources(ServerHandle server) {
+    while (true) {
+        {
+            std::shared_lock<SharedMutex> table(tableMutex);
+            if (server < serverResources.size() && serverResources[server]) {
+                stServerResources *resources = serverResources[server].get();
+                std::unique_lock<SharedMutex> lock(resources->mutex);
+                resources->version++;
+                return WriteView{std::move(table), std::move(lock), resources};
+            }
+        }
+        // First write for this server, allocate under the exclusive table lock and retry
+        std::unique_lock<SharedMutex> table(tableMutex);
+        if (server >= serverResources.size()) {
+            serverResources.resize(server + 1);
+        }
+        if (!serverResources[server]) {
+            serverResources[server] = std::make_unique<stServerResources>();
+        }
+    }
+}
+
+CSharedResourcePool::ReadView CSharedResourcePool::readResources(ServerHandle server) const {
+    std::shared_lock<SharedMutex> table(tableMutex);
+    if (server >= serverResources.size() || !serverResources[server]) {
+        return ReadView{std::move(table), {}, nullptr};
+    }
+    const stServerResources *resources = serverResources[server].get();
+    return ReadView{std::move(table), std::shared_lock<SharedMutex>(resources->mutex), resources};
+}
+
+void CSharedResourcePool::addServer(ServerHandle server) {
+    std::unique_lock<SharedMutex> table(tableMutex);
+    if (server >= serverResources.size()) {
+        serverResources.resize(server + 1);
+    }
+    // Too large for a temporary on the stack, start from a fresh allocation
+    serverResources[server] = std::make_unique<stServerResources>();
+}
+
+stPlayer* CSharedResourcePool::findPlayer(stServerResources &resources, int playerID) {
+    if (playerID < 0 || playerID >= static_cast<int>(stServerResources::MAX_IDS)) {
+        return nullptr;
+    }
+    uint16_t slot = resources.playerSlots[playerID];
+    return slot == stServerResources::NO_SLOT ? nullptr : &resources.players[slot];
+}
+
+stVehicle* CSharedResourcePool::findVehicle(stServerResources &resources, int vehicleID) {
+    if (vehicleID < 0 || vehicleID >= static_cast<int>(stServerResources::MAX_IDS)) {
+        return nullptr;
+    }
+    uint16_t slot = resources.vehicleSlots[vehicleID];
+    return slot == stServerResources::NO_SLOT ? nullptr : &resources.vehicles[slot];
+}
+
+void CSharedResourcePool::removePlayerAt(stServerResources &resources, size_t index) {
+    resources.playerGrid.remove(resources.players[index].id);
+    resources.playerSlots[resources.players[index].id] = stServerResources::NO_SLOT;
+    size_t last = resources.playerCount - 1;
+    if (index != last) {
+        resources.players[index] = std::move(resources.players[last]);
+        resources.playerSlots[resources.players[index].id] = static_cast<uint16_t>(index);
+    }
+    resources.playerCount--;
+}
+
+void CSharedResourcePool::removeVehicleAt(stServerResources &resources, size_t index) {
+    resources.vehicleGrid.remove(resources.vehicles[index].id);
+    resources.vehicleSlots[resources.vehicles[index].id] = stServerResources::NO_SLOT;
+    size_t last = resources.vehicleCount - 1;
+    if (index != last) {
+        resources.vehicles[index] = resources.vehicles[last];
+        resources.vehicleSlots[resources.vehicles[index].id] = static_cast<uint16_t>(index);
+    }
+    resources.vehicleCount--;
+}
+
+void CSharedResourcePool::setPlayerPosition(stServerResources &resources, stPlayer &player, const glm::vec3 &position) {
+    player.position = position;
+    resources.playerGrid.set(player.id, position);
 }
 
-void CSharedResourcePool::addPlayer(ServerAddress addr, const stPlayer &player) {
-    auto &resources = serverResources[addr];
-    std::size_t hash = calHashPlayer(player);
+void CSharedResourcePool::setVehiclePosition(stServerResources &resources, stVehicle &vehicle, const glm::vec3 &position) {
+    vehicle.position = position;
+    resources.vehicleGrid.set(vehicle.id, position);
+}
 
-    // Check if player already exists
-    if (resources.player_hashes.find(hash) != resources.player_hashes.end()) {
-        return; // Already exists, don't add duplicate
+void CSharedResourcePool::addPlayer(ServerHandle server, const stPlayer &player) {
+    auto view = writeResources(server);
+    auto &resources = *view.resources;
+    if (player.id < 0 || player.id >= static_cast<int>(stServerResources::MAX_IDS)) {
+        return;
     }
 
-    // Check if we have space
-    if (resources.playerCount >= resources.players.size()) {
-        return; // No more space
+    if (auto *existing = findPlayer(resources, player.id)) {
+        if (existing->name == player.name) {
+            return; // Already exists, don't add duplicate
+        }
+        // The id was reused by another player, replace the stale entry
+        *existing = player;
+        setPlayerPosition(resources, *existing, player.position);
+        return;
     }
 
-    // Add player and its hash
+    resources.playerSlots[player.id] = static_cast<uint16_t>(resources.playerCount);
     resources.players[resources.playerCount] = player;
-    resources.player_hashes.insert(hash);
+    setPlayerPosition(resources, resources.players[resources.playerCount], player.position);
     resources.playerCount++;
 }
 
-void CSharedResourcePool::addVehicle(ServerAddress addr, const stVehicle &vehicle) {
-    auto &resources = serverResources[addr];
-    std::size_t hash = calHashVehicle(vehicle);
-
-    // Check if vehicle already exists
-    if (resources.vehicle_hashes.find(hash) != resources.vehicle_hashes.end()) {
-        return; // Already exists, don't add duplicate
+void CSharedResourcePool::addVehicle(ServerHandle server, const stVehicle &vehicle) {
+    auto view = writeResources(server);
+    auto &resources = *view.resources;
+    if (vehicle.id < 0 || vehicle.id >= static_cast<int>(stServerResources::MAX_IDS)) {
+        return;
     }
 
-    // Check if we have space
-    if (resources.vehicleCount >= resources.vehicles.size()) {
-        return; // No more space
+    if (auto *existing = findVehicle(resources, vehicle.id)) {
+        if (existing->model == vehicle.model) {
+            return; // Already exists, don't add duplicate
+        }
+        *existing = vehicle;
+        setVehiclePosition(resources, *existing, vehicle.position);
+        return;
     }
 
-    // Add vehicle and its hash
+    resources.vehicleSlots[vehicle.id] = static_cast<uint16_t>(resources.vehicleCount);
     resources.vehicles[resources.vehicleCount] = vehicle;
-    resources.vehicle_hashes.insert(hash);
+    setVehiclePosition(resources, resources.vehicles[resources.vehicleCount], vehicle.position);
     resources.vehicleCount++;
 }
 
-void CSharedResourcePool::updatePlayer(ServerAddress addr, unsigned short playerID, glm::vec3 position) {
-    auto &resources = serverResources[addr];
-    
-    // Find player by ID and update position
-    for (size_t i = 0; i < resources.playerCount; i++) {
-        if (resources.players[i].id == playerID) {
-            resources.players[i].position = position;
-            break;
-        }
+void CSharedResourcePool::updatePlayer(ServerHandle server, unsigned short playerID, glm::vec3 position) {
+    auto view = writeResources(server);
+    auto &resources = *view.resources;
+    if (auto *player = findPlayer(resources, playerID)) {
+        setPlayerPosition(resources, *player, position);
     }
 }
 
-void CSharedResourcePool::updatePlayer(ServerAddress addr, unsigned short playerID, const stOnFootData &onFootData) {
-    auto &resources = serverResources[addr];
-    
-    // Find player by ID and update with onfoot data
-    for (size_t i = 0; i < resources.playerCount; i++) {
-        if (resources.players[i].id == playerID) {
-            resources.players[i].position = glm::vec3{onFootData.fPosition[0], onFootData.fPosition[1], onFootData.fPosition[2]};
-            resources.players[i].velocity = glm::vec3{onFootData.fMoveSpeed[0], onFootData.fMoveSpeed[1], onFootData.fMoveSpeed[2]};
-            resources.players[i].health = onFootData.byteHealth;
-            resources.players[i].armor = onFootData.byteArmor;
-            resources.players[i].weapon = onFootData.byteCurrentWeapon;
-            resources.players[i].specialAction = onFootData.byteSpecialAction;
-            break;
-        }
+void CSharedResourcePool::updatePlayer(ServerHandle server, unsigned short playerID, const stOnFootData &onFootData) {
+    auto view = writeResources(server);
+    auto &resources = *view.resources;
+    auto *player = findPlayer(resources, playerID);
+    if (!player) {
+        return;
     }
+    setPlayerPosition(resources, *player, glm::vec3{onFootData.fPosition[0], onFootData.fPosition[1], onFootData.fPosition[2]});
+    player->velocity = glm::vec3{onFootData.fMoveSpeed[0], onFootData.fMoveSpeed[1], onFootData.fMoveSpeed[2]};
+    player->health = onFootData.byteHealth;
+    player->armor = onFootData.byteArmor;
+    player->weapon = onFootData.byteCurrentWeapon;
+    player->specialAction = onFootData.byteSpecialAction;
 }
 
-void CSharedResourcePool::updateVehicle(ServerAddress addr, unsigned short vehicleID, const stInCarData &inCarData) {
-    auto &resources = serverResources[addr];
-    
-    // Find vehicle by ID and update with incar data
-    for (size_t i = 0; i < resources.vehicleCount; i++) {
-        if (resources.vehicles[i].id == vehicleID) {
-            resources.vehicles[i].position = glm::vec3{inCarData.fPosition[0], inCarData.fPosition[1], inCarData.fPosition[2]};
-            resources.vehicles[i].velocity = glm::vec3{inCarData.fMoveSpeed[0], inCarData.fMoveSpeed[1], inCarData.fMoveSpeed[2]};
-            resources.vehicles[i].health = inCarData.fVehicleHealth;
-            break;
-        }
+void CSharedResourcePool::updateVehicle(ServerHandle server, unsigned short vehicleID, const stInCarData &inCarData) {
+    auto view = writeResources(server);
+    auto &resources = *view.resources;
+    auto *vehicle = findVehicle(resources, vehicleID);
+    if (!vehicle) {
+        return;
     }
+    setVehiclePosition(resources, *vehicle, glm::vec3{inCarData.fPosition[0], inCarData.fPosition[1], inCarData.fPosition[2]});
+    vehicle->velocity = glm::vec3{inCarData.fMoveSpeed[0], inCarData.fMoveSpeed[1], inCarData.fMoveSpeed[2]};
+    vehicle->health = inCarData.fVehicleHealth;
 }
 
-void CSharedResourcePool::updateVehicle(ServerAddress addr, unsigned short vehicleID, int modelid, glm::vec3 position) {
-    auto &resources = serverResources[addr];
-    
-    // Find vehicle by ID and update
-    for (size_t i = 0; i < resources.vehicleCount; i++) {
-        if (resources.vehicles[i].id == vehicleID) {
-            resources.vehicles[i].model = modelid;
-            resources.vehicles[i].position = position;
-            break;
-        }
+void CSharedResourcePool::updateVehicle(ServerHandle server, unsigned short vehicleID, int modelid, glm::vec3 position) {
+    auto view = writeResources(server);
+    auto &resources = *view.resources;
+    if (auto *vehicle = findVehicle(resources, vehicleID)) {
+        vehicle->model = modelid;
+        setVehiclePosition(resources, *vehicle, position);
     }
 }
 
-void CSharedResourcePool::incrementPlayerStreamCount(ServerAddress addr, int playerID) {
-    auto &resources = serverResources[addr];
-    
-    for (size_t i = 0; i < resources.playerCount; i++) {
-        if (resources.players[i].id == playerID) {
-            resources.players[i].stream_count++;
-            break;
-        }
+void CSharedResourcePool::incrementPlayerStreamCount(ServerHandle server, int playerID) {
+    auto view = writeResources(server);
+    if (auto *player = findPlayer(*view.resources, playerID)) {
+        player->stream_count++;
     }
 }
 
-void CSharedResourcePool::decrementPlayerStreamCount(ServerAddress addr, int playerID) {
-    auto &resources = serverResources[addr];
-    
-    for (size_t i = 0; i < resources.playerCount; i++) {
-        if (resources.players[i].id == playerID) {
-            resources.players[i].stream_count--;
-            if (resources.players[i].stream_count <= 0) {
-                // Remove player if no bots are streaming it
-                std::size_t hash = calHashPlayer(resources.players[i]);
-                resources.player_hashes.erase(hash);
-                
-                if (i < resources.playerCount - 1) {
-                    resources.players[i] = resources.players[resources.playerCount - 1];
-                }
-                resources.playerCount--;
-            }
-            break;
-        }
+void CSharedResourcePool::decrementPlayerStreamCount(ServerHandle server, int playerID) {
+    auto view = writeResources(server);
+    auto &resources = *view.resources;
+    auto *player = findPlayer(resources, playerID);
+    if (player && --player->stream_count <= 0) {
+        // Remove player if no bots are streaming it
+        removePlayerAt(resources, resources.playerSlots[playerID]);
     }
 }
 
-void CSharedResourcePool::incrementVehicleStreamCount(ServerAddress addr, int vehicleID) {
-    auto &resources = serverResources[addr];
-    
-    for (size_t i = 0; i < resources.vehicleCount; i++) {
-        if (resources.vehicles[i].id == vehicleID) {
-            resources.vehicles[i].stream_count++;
-            break;
-        }
+void CSharedResourcePool::incrementVehicleStreamCount(ServerHandle server, int vehicleID) {
+    auto view = writeResources(server);
+    if (auto *vehicle = findVehicle(*view.resources, vehicleID)) {
+        vehicle->stream_count++;
     }
 }
 
-void CSharedResourcePool::decrementVehicleStreamCount(ServerAddress addr, int vehicleID) {
-    auto &resources = serverResources[addr];
-    
-    for (size_t i = 0; i < resources.vehicleCount; i++) {
-        if (resources.vehicles[i].id == vehicleID) {
-            resources.vehicles[i].stream_count--;
-            if (resources.vehicles[i].stream_count <= 0) {
-                // Remove vehicle if no bots are streaming it
-                std::size_t hash = calHashVehicle(resources.vehicles[i]);
-                resources.vehicle_hashes.erase(hash);
-                
-                if (i < resources.vehicleCount - 1) {
-                    resources.vehicles[i] = resources.vehicles[resources.vehicleCount - 1];
-                }
-                resources.vehicleCount--;
-            }
-            break;
-        }
+void CSharedResourcePool::decrementVehicleStreamCount(ServerHandle server, int vehicleID) {
+    auto view = writeResources(server);
+    auto &resources = *view.resources;
+    auto *vehicle = findVehicle(resources, vehicleID);
+    if (vehicle && --vehicle->stream_count <= 0) {
+        // Remove vehicle if no bots are streaming it
+        removeVehicleAt(resources, resources.vehicleSlots[vehicleID]);
     }
 }
 
-void CSharedResourcePool::removeServer(ServerAddress addr) {
-    serverResources.erase(addr);
+void CSharedResourcePool::removeServer(ServerHandle server) {
+    std::unique_lock<SharedMutex> table(tableMutex);
+    if (server < serverResources.size()) {
+        serverResources[server].reset();
+    }
 }
 
-void CSharedResourcePool::removePlayer(ServerAddress addr, const std::string &playerName) {
-    auto &resources = serverResources[addr];
-    
+void CSharedResourcePool::removePlayer(ServerHandle server, const std::string &playerName) {
+    auto view = writeResources(server);
+    auto &resources = *view.resources;
+
     for (size_t i = 0; i < resources.playerCount; i++) {
         if (resources.players[i].name == playerName) {
-            std::size_t hash = calHashPlayer(resources.players[i]);
-            resources.player_hashes.erase(hash);
-            
-            if (i < resources.playerCount - 1) {
-                resources.players[i] = resources.players[resources.playerCount - 1];
-            }
-            resources.playerCount--;
+            removePlayerAt(resources, i);
             break;
         }
     }
 }
 
-void CSharedResourcePool::removePlayer(ServerAddress addr, int id) {
-    auto &resources = serverResources[addr];
-    
-    for (size_t i = 0; i < resources.playerCount; i++) {
-        if (resources.players[i].id == id) {
-            std::size_t hash = calHashPlayer(resources.players[i]);
-            resources.player_hashes.erase(hash);
-            
-            if (i < resources.playerCount - 1) {
-                resources.players[i] = resources.players[resources.playerCount - 1];
-            }
-            resources.playerCount--;
-            break;
-        }
+void CSharedResourcePool::removePlayer(ServerHandle server, int id) {
+    auto view = writeResources(server);
+    auto &resources = *view.resources;
+    if (findPlayer(resources, id)) {
+        removePlayerAt(resources, resources.playerSlots[id]);
     }
 }
 
-void CSharedResourcePool::removeVehicle(ServerAddress addr, int vehicleId) {
-    auto &resources = serverResources[addr];
-    
-    for (size_t i = 0; i < resources.vehicleCount; i++) {
-        if (resources.vehicles[i].id == vehicleId) {
-            std::size_t hash = calHashVehicle(resources.vehicles[i]);
-            resources.vehicle_hashes.erase(hash);
-            
-            if (i < resources.vehicleCount - 1) {
-                resources.vehicles[i] = resources.vehicles[resources.vehicleCount - 1];
-            }
-            resources.vehicleCount--;
-            break;
-        }
+void CSharedResourcePool::removeVehicle(ServerHandle server, int vehicleId) {
+    auto view = writeResources(server);
+    auto &resources = *view.resources;
+    if (findVehicle(resources, vehicleId)) {
+        removeVehicleAt(resources, resources.vehicleSlots[vehicleId]);
     }
 }
 
-void CSharedResourcePool::clearServerResources(ServerAddress addr) {
-    auto &resources = serverResources[addr];
+void CSharedResourcePool::clearServerResources(ServerHandle server) {
+    auto view = writeResources(server);
+    auto &resources = *view.resources;
     resources.playerCount = 0;
     resources.vehicleCount = 0;
-    resources.player_hashes.clear();
-    resources.vehicle_hashes.clear();
-}
-
-std::string CSharedResourcePool::getPlayerName(ServerAddress addr, int playerid) {
-    auto &resources = serverResources[addr];
-    
-    for (size_t i = 0; i < resources.playerCount; i++) {
-        if (resources.players[i].id == playerid) {
-            return resources.players[i].name;
-        }
-    }
-    return "";
+    resources.playerSlots.fill(stServerResources::NO_SLOT);
+    resources.vehicleSlots.fill(stServerResources::NO_SLOT);
+    resources.playerGrid.clear();
+    resources.vehicleGrid.clear();
 }
 
-const stServerResources* CSharedResourcePool::getServerResources(ServerAddress addr) const {
-    auto it = serverResources.find(addr);
-    if (it != serverResources.end()) {
-        return &it->second;
+std::string CSharedResourcePool::getPlayerName(ServerHandle server, int playerid) const {
+    auto view = readResources(server);
+    if (!view.resources || playerid < 0 || playerid >= static_cast<int>(stServerResources::MAX_IDS)) {
+        return "";
     }
-    return nullptr;
+    uint16_t slot = view.resources->playerSlots[playerid];
+    return slot == stServerResources::NO_SLOT ? "" : view.resources->players[slot].name;
 }
 
-std::vector<stPlayer> CSharedResourcePool::getPlayersInRange(ServerAddress addr, const glm::vec3 &position, float range, bool npc_included) const {
+std::vector<stPlayer> CSharedResourcePool::getAllPlayer(ServerHandle server, bool npc_included) const {
     std::vector<stPlayer> result;
-    auto it = serverResources.find(addr);
-    if (it == serverResources.end()) return result;
+    auto view = readResources(server);
+    if (!view.resources) return result;
     
-    const auto &resources = it->second;
-    float rangeSq = range * range;
+    const auto &resources = *view.resources;
     
     for (size_t i = 0; i < resources.playerCount; i++) {
         const auto &player = resources.players[i];
         if (!npc_included && player.is_npc) continue;
-        
-        glm::vec3 diff = player.position - position;
-        if (diff.x * diff.x + diff.y * diff.y + diff.z * diff.z <= rangeSq) {
-            result.push_back(player);
-        }
+        result.push_back(player);
     }
     
     return result;
 }
 
-std::vector<stPlayer> CSharedResourcePool::getAllPlayer(ServerAddress addr, bool npc_included) const {
-    std::vector<stPlayer> result;
-    auto it = serverResources.find(addr);
-    if (it == serverResources.end()) return result;
-    
-    const auto &resources = it->second;
-    
-    for (size_t i = 0; i < resources.playerCount; i++) {
-        const auto &player = resources.players[i];
-        if (!npc_included && player.is_npc) continue;
-        result.push_back(player);
+size_t CSharedResourcePool::countPlayersInRange(ServerHandle server, const glm::vec3 &position, float range, bool npc_included) const {
+    auto view = readResources(server);
+    const auto *resources = view.resources;
+    if (!resources) return 0;
+
+    if (npc_included) {
+        return resources->playerGrid.countInRange(position, range);
     }
-    
-    return result;
+
+    size_t count = 0;
+    resources->playerGrid.forEachInRange(position, range, [&](UniformGrid::Id id) {
+        if (!resources->players[resources->playerSlots[id]].is_npc) count++;
+    });
+    return count;
 }
 
-std::vector<stVehicle> CSharedResourcePool::getVehiclesInRange(ServerAddress addr, const glm::vec3 &position, float range) const {
-    std::vector<stVehicle> result;
-    auto it = serverResources.find(addr);
-    if (it == serverResources.end()) return result;
-    
-    const auto &resources = it->second;
-    float rangeSq = range * range;
-    
-    for (size_t i = 0; i < resources.vehicleCount; i++) {
-        const auto &vehicle = resources.vehicles[i];
-        glm::vec3 diff = vehicle.position - position;
-        if (diff.x * diff.x + diff.y * diff.y + diff.z * diff.z <= rangeSq) {
-            result.push_back(vehicle);
+size_t CSharedResourcePool::countVehiclesInRange(ServerHandle server, const glm::vec3 &position, float range) const {
+    auto view = readResources(server);
+    const auto *resources = view.resources;
+    if (!resources) return 0;
+
+    return resources->vehicleGrid.countInRange(position, range);
+}
+
+void CSharedResourcePool::publishSnapshots() {
+    std::unique_lock<std::mutex> publishing(publishMutex, std::try_to_lock);
+    if (!publishing.owns_lock()) return;
+
+    std::shared_lock<SharedMutex> table(tableMutex);
+    for (auto &resources : serverResources) {
+        if (!resources) continue;
+
+        std::shared_ptr<const CServerSnapshot> snapshot;
+        {
+            std::shared_lock<SharedMutex> lock(resources->mutex);
+            auto current = std::atomic_load(&resources->published);
+            if (current && current->getVersion() == resources->version) continue;
+            snapshot = std::make_shared<const CServerSnapshot>(*resources);
         }
+        // Readers still holding the previous snapshot keep it alive until they are done
+        std::atomic_store(&resources->published, std::move(snapshot));
     }
-    
-    return result;
 }
 
-std::size_t CSharedResourcePool::calHashPlayer(const stPlayer &player) {
-    std::size_t hash = std::hash<int>{}(player.id);
-    hash ^= std::hash<std::string>{}(player.name) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
-    return hash;
-}
+std::shared_ptr<const CServerSnapshot> CSharedResourcePool::getSnapshot(ServerHandle server) const {
+    static const auto empty = std::make_shared<const CServerSnapshot>();
 
-std::size_t CSharedResourcePool::calHashVehicle(const stVehicle &vehicle) {
-    std::size_t hash = std::hash<int>{}(vehicle.id);
-    hash ^= std::hash<int>{}(vehicle.model) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
-    return hash;
-}
\ No newline at end of file
+    std::shared_lock<SharedMutex> table(tableMutex);
+    if (server >= serverResources.size() || !serverResources[server]) {
+        return empty;
+    }
+    auto snapshot = std::atomic_load(&serverResources[server]->published);
+    return snapshot ? snapshot : empty;
+}
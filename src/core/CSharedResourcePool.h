@@ -4,14 +4,18 @@
 
 #ifndef CSHAREDRESOURCEPOOL_H
 #define CSHAREDRESOURCEPOOL_H
-#include <map>
-#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <cstdint>
 #include <vector>
 #include <array>
 
 #include "../samp.h"
 #include "glm/vec3.hpp"
-#include "../models/CServer.h"
+#include "CServerRegistry.h"
+#include "../utils/ds/UniformGrid.h"
+#include "../utils/SharedMutex.h"
 
 struct stPlayer {
     std::string name;
@@ -40,60 +44,179 @@ struct stVehicle {
     int stream_count = 0; // Number of bots streaming this vehicle
 };
 
+class CServerSnapshot;
+
 // dynamic server resources, save them for sharing info despite being out of streaming range
 // as long as there's at least one bot around these resources, the resources persist
 struct stServerResources {
     //std::vector<stTextdraw> textdraws; // global textdraw
     // Note: pickups, objects, and labels are now handled per-bot via CStreamableResourcePool
     // Only players and vehicles are shared across all bots
-    std::array<stPlayer, 2000> players;
-    std::array<stVehicle, 2000> vehicles;
+    static constexpr size_t MAX_IDS = 2000;              // SA-MP player and vehicle ids are below this
+    static constexpr uint16_t NO_SLOT = 0xFFFF;
+
+    // Dense live lists for iteration, removal swaps the last entry into the hole
+    std::array<stPlayer, MAX_IDS> players;
+    std::array<stVehicle, MAX_IDS> vehicles;
     size_t playerCount = 0;
     size_t vehicleCount = 0;
 
-    std::unordered_set<std::size_t> player_hashes;
-    std::unordered_set<std::size_t> vehicle_hashes;
-};
+    // SA-MP id -> index into the dense list, NO_SLOT if not present
+    std::array<uint16_t, MAX_IDS> playerSlots;
+    std::array<uint16_t, MAX_IDS> vehicleSlots;
+
+    // Spatial index keyed by SA-MP id, covers the San Andreas map
+    static constexpr float GRID_CELL_SIZE = 150.0f;
+    static constexpr float WORLD_BOUND = 3000.0f;
+    UniformGrid playerGrid{GRID_CELL_SIZE, -WORLD_BOUND, WORLD_BOUND, MAX_IDS};
+    UniformGrid vehicleGrid{GRID_CELL_SIZE, -WORLD_BOUND, WORLD_BOUND, MAX_IDS};
+
+    // Writers lock exclusively, readers of the same server share the lock
+    mutable SharedMutex mutex;
 
-using ServerAddress = std::pair<std::string, int>;
+    // Bumped by every write access, lets publishSnapshots() skip unchanged servers
+    uint64_t version = 0;
+    // Latest published snapshot, only accessed through std::atomic_load / atomic_store
+    std::shared_ptr<const CServerSnapshot> published;
+
+    stServerResources() {
+        playerSlots.fill(NO_SLOT);
+        vehicleSlots.fill(NO_SLOT);
+    }
+};
 
 class CSharedResourcePool {
 public:
     CSharedResourcePool();
     ~CSharedResourcePool();
-    std::map<ServerAddress, stServerResources> serverResources;
-    void addServer(CServer* server);
+    void addServer(ServerHandle server);
 
-    void addPlayer(ServerAddress addr, const stPlayer& player);
-    void addVehicle(ServerAddress addr, const stVehicle& vehicle);
+    void addPlayer(ServerHandle server, const stPlayer& player);
+    void addVehicle(ServerHandle server, const stVehicle& vehicle);
 
-    void updatePlayer(ServerAddress addr, unsigned short playerID, glm::vec3 position);
-    void updatePlayer(ServerAddress addr, unsigned short playerID, const stOnFootData& onFootData);
-    void updateVehicle(ServerAddress addr, unsigned short vehicleID, const stInCarData& inCarData);
-    void updateVehicle(ServerAddress addr, unsigned short vehicleID, int modelid, glm::vec3 position);
+    void updatePlayer(ServerHandle server, unsigned short playerID, glm::vec3 position);
+    void updatePlayer(ServerHandle server, unsigned short playerID, const stOnFootData& onFootData);
+    void updateVehicle(ServerHandle server, unsigned short vehicleID, const stInCarData& inCarData);
+    void updateVehicle(ServerHandle server, unsigned short vehicleID, int modelid, glm::vec3 position);
 
-    void incrementPlayerStreamCount(ServerAddress addr, int playerID);
-    void decrementPlayerStreamCount(ServerAddress addr, int playerID);
-    void incrementVehicleStreamCount(ServerAddress addr, int vehicleID);
-    void decrementVehicleStreamCount(ServerAddress addr, int vehicleID);
+    void incrementPlayerStreamCount(ServerHandle server, int playerID);
+    void decrementPlayerStreamCount(ServerHandle server, int playerID);
+    void incrementVehicleStreamCount(ServerHandle server, int vehicleID);
+    void decrementVehicleStreamCount(ServerHandle server, int vehicleID);
 
     // Resource removal methods
-    void removeServer(ServerAddress addr);
-    void removePlayer(ServerAddress addr, const std::string& playerName);
-    void removePlayer(ServerAddress addr, int id);
-    void removeVehicle(ServerAddress addr, int vehicleId);
-    void clearServerResources(ServerAddress addr);
+    void removeServer(ServerHandle server);
+    void removePlayer(ServerHandle server, const std::string& playerName);
+    void removePlayer(ServerHandle server, int id);
+    void removeVehicle(ServerHandle server, int vehicleId);
+    void clearServerResources(ServerHandle server);
 
-    std::string getPlayerName(ServerAddress addr, int playerid);
+    std::string getPlayerName(ServerHandle server, int playerid) const;
 
     // Resource query methods
-    const stServerResources* getServerResources(ServerAddress addr) const;
-    std::vector<stPlayer> getPlayersInRange(ServerAddress addr, const glm::vec3& position, float range, bool npc_included) const;
-    std::vector<stPlayer> getAllPlayer(ServerAddress addr, bool npc_included) const; //获取服务器全部玩家
-    std::vector<stVehicle> getVehiclesInRange(ServerAddress addr, const glm::vec3& position, float range) const;
+    std::vector<stPlayer> getAllPlayer(ServerHandle server, bool npc_included) const; //获取服务器全部玩家
+
+    // Range queries visit matches in place while the pool is locked, nothing is copied.
+    // The callback must not call back into the pool.
+    template <typename Fn>
+    void forEachPlayerInRange(ServerHandle server, const glm::vec3& position, float range, bool npc_included, Fn&& fn) const;
+    template <typename Fn>
+    void forEachVehicleInRange(ServerHandle server, const glm::vec3& position, float range, Fn&& fn) const;
+    size_t countPlayersInRange(ServerHandle server, const glm::vec3& position, float range, bool npc_included) const;
+    size_t countVehiclesInRange(ServerHandle server, const glm::vec3& position, float range) const;
+
+    // Replaces the published snapshot of every server that changed since the last call.
+    // Concurrent calls are skipped, the running one covers them.
+    void publishSnapshots();
+    // Latest published snapshot, never null. Readers only touch the shared table lock.
+    std::shared_ptr<const CServerSnapshot> getSnapshot(ServerHandle server) const;
+
+    // Visits up to k players / vehicles within maxRange, nearest first
+    template <typename Fn>
+    void forEachNearestPlayer(ServerHandle server, const glm::vec3& position, size_t k, float maxRange, bool npc_included, Fn&& fn) const;
+    template <typename Fn>
+    void forEachNearestVehicle(ServerHandle server, const glm::vec3& position, size_t k, float maxRange, Fn&& fn) const;
 private:
-    std::size_t calHashPlayer(const stPlayer& player);
-    std::size_t calHashVehicle(const stVehicle& vehicle);
+    // Indexed by ServerHandle, slots are allocated on first use. tableMutex
+    // guards the vector itself, every server block has its own lock so bots on
+    // different servers never contend and readers of one server run in parallel.
+    mutable SharedMutex tableMutex;
+    std::vector<std::unique_ptr<stServerResources>> serverResources;
+    std::mutex publishMutex;
+
+    // A locked server block. The table stays locked shared while the view is
+    // alive so removeServer() cannot free the block underneath it.
+    struct WriteView {
+        std::shared_lock<SharedMutex> table;
+        std::unique_lock<SharedMutex> lock;
+        stServerResources* resources;
+    };
+    struct ReadView {
+        std::shared_lock<SharedMutex> table;
+        std::shared_lock<SharedMutex> lock;
+        const stServerResources* resources; // null if the server has no resources yet
+    };
+    WriteView writeResources(ServerHandle server);  // allocates the block on first use
+    ReadView readResources(ServerHandle server) const;
+
+    static stPlayer* findPlayer(stServerResources& resources, int playerID);
+    static stVehicle* findVehicle(stServerResources& resources, int vehicleID);
+    static void removePlayerAt(stServerResources& resources, size_t index);
+    static void removeVehicleAt(stServerResources& resources, size_t index);
+    static void setPlayerPosition(stServerResources& resources, stPlayer& player, const glm::vec3& position);
+    static void setVehiclePosition(stServerResources& resources, stVehicle& vehicle, const glm::vec3& position);
 };
 
+template <typename Fn>
+void CSharedResourcePool::forEachPlayerInRange(ServerHandle server, const glm::vec3& position, float range, bool npc_included, Fn&& fn) const {
+    auto view = readResources(server);
+    const auto* resources = view.resources;
+    if (!resources) return;
+
+    resources->playerGrid.forEachInRange(position, range, [&](UniformGrid::Id id) {
+        const auto& player = resources->players[resources->playerSlots[id]];
+        if (!npc_included && player.is_npc) return;
+        fn(player);
+    });
+}
+
+template <typename Fn>
+void CSharedResourcePool::forEachVehicleInRange(ServerHandle server, const glm::vec3& position, float range, Fn&& fn) const {
+    auto view = readResources(server);
+    const auto* resources = view.resources;
+    if (!resources) return;
+
+    resources->vehicleGrid.forEachInRange(position, range, [&](UniformGrid::Id id) {
+        fn(resources->vehicles[resources->vehicleSlots[id]]);
+    });
+}
+
+template <typename Fn>
+void CSharedResourcePool::forEachNearestPlayer(ServerHandle server, const glm::vec3& position, size_t k, float maxRange, bool npc_included, Fn&& fn) const {
+    auto view = readResources(server);
+    const auto* resources = view.resources;
+    if (!resources) return;
+
+    std::vector<UniformGrid::Id> nearest;
+    resources->playerGrid.nearest(position, k, maxRange, [&](UniformGrid::Id id) {
+        return npc_included || !resources->players[resources->playerSlots[id]].is_npc;
+    }, nearest);
+    for (auto id : nearest) {
+        fn(resources->players[resources->playerSlots[id]]);
+    }
+}
+
+template <typename Fn>
+void CSharedResourcePool::forEachNearestVehicle(ServerHandle server, const glm::vec3& position, size_t k, float maxRange, Fn&& fn) const {
+    auto view = readResources(server);
+    const auto* resources = view.resources;
+    if (!resources) return;
+
+    std::vector<UniformGrid::Id> nearest;
+    resources->vehicleGrid.nearest(position, k, maxRange, nearest);
+    for (auto id : nearest) {
+        fn(resources->vehicles[resources->vehicleSlots[id]]);
+    }
+}
+
 #endif //CSHAREDRESOURCEPOOL_H
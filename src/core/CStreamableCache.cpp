@@ -0,0 +1,35 @@
+//
+// CStreamableCache - Per-server store of the records streamed in by bots
+//
+
+#include "CStreamableCache.h"
+
+std::shared_ptr<stStreamableCache> CStreamableCache::getServerCache(ServerHandle server) {
+    if (server == INVALID_SERVER_HANDLE) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (server >= caches.size()) {
+        caches.resize(server + 1);
+    }
+    if (!caches[server]) {
+        caches[server] = std::make_shared<stStreamableCache>();
+    }
+    return caches[server];
+}
+
+CStreamableCache::Stats CStreamableCache::getStats() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    Stats stats;
+    for (const auto& cache : caches) {
+        if (!cache) continue;
+        stats.servers++;
+        stats.objects += cache->objects.size();
+        stats.pickups += cache->pickups.size();
+        stats.labels += cache->labels.size();
+        stats.texts += cache->texts.size();
+        stats.bytes += cache->getMemoryUsage();
+    }
+    return stats;
+}
@@ -0,0 +1,38 @@
+//
+// CStreamableCache - Per-server store of the records streamed in by bots
+//
+
+#ifndef CSTREAMABLECACHE_H
+#define CSTREAMABLECACHE_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "CServerRegistry.h"
+#include "CStreamableResourcePool.h"
+
+// Hands every bot the stStreamableCache of its server. Caches live as long as
+// a pool still holds them, the registry keeps them for the process lifetime
+// so bots reconnecting to a server find the records other bots kept alive.
+class CStreamableCache {
+public:
+    std::shared_ptr<stStreamableCache> getServerCache(ServerHandle server);
+
+    struct Stats {
+        size_t servers = 0;
+        size_t objects = 0;
+        size_t pickups = 0;
+        size_t labels = 0;
+        size_t texts = 0;
+        size_t bytes = 0;
+    };
+    // Distinct live records over all servers and the memory they take
+    Stats getStats() const;
+
+private:
+    mutable std::mutex cacheMutex;
+    std::vector<std::shared_ptr<stStreamableCache>> caches; // indexed by ServerHandle
+};
+
+#endif //CSTREAMABLECACHE_H
@@ -3,327 +3,289 @@
 //
 
 #include "CStreamableResourcePool.h"
-#include <cmath>
 #include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace {
+    void hashCombine(size_t& seed, size_t value) {
+        seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    }
+
+    size_t hashFloat(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    size_t hashVec3(const glm::vec3& v) {
+        size_t seed = hashFloat(v.x);
+        hashCombine(seed, hashFloat(v.y));
+        hashCombine(seed, hashFloat(v.z));
+        return seed;
+    }
+
+    // Shares the record through the cache if there is one
+    template <typename T, typename Table>
+    stStreamableRef<T> makeRef(const T& item, Table* table) {
+        return {item.id, item.position, table ? table->intern(item) : std::make_shared<const T>(item)};
+    }
+}
+
+size_t StreamableHash::operator()(const stObject& object) const {
+    size_t seed = std::hash<int>()(object.id);
+    hashCombine(seed, std::hash<int>()(object.model));
+    hashCombine(seed, hashVec3(object.position));
+    hashCombine(seed, hashVec3(object.rotation));
+    hashCombine(seed, hashFloat(object.drawDistance));
+    hashCombine(seed, std::hash<std::string>()(object.materialText.str()));
+    return seed;
+}
+
+size_t StreamableHash::operator()(const stMyPickup& pickup) const {
+    size_t seed = std::hash<int>()(pickup.id);
+    hashCombine(seed, std::hash<int>()(pickup.model));
+    hashCombine(seed, hashVec3(pickup.position));
+    return seed;
+}
+
+size_t StreamableHash::operator()(const st3DTextLabel& label) const {
+    size_t seed = std::hash<int>()(label.id);
+    hashCombine(seed, hashVec3(label.position));
+    hashCombine(seed, std::hash<int>()(label.attachedPlayer));
+    hashCombine(seed, std::hash<int>()(label.attachedVehicle));
+    hashCombine(seed, std::hash<std::string>()(label.text.str()));
+    hashCombine(seed, hashFloat(label.drawDistance));
+    hashCombine(seed, label.testLOS);
+    return seed;
+}
+
+bool StreamableEqual::operator()(const stObject& a, const stObject& b) const {
+    return a.id == b.id && a.model == b.model && a.position == b.position && a.rotation == b.rotation &&
+           a.drawDistance == b.drawDistance && a.materialText == b.materialText;
+}
+
+bool StreamableEqual::operator()(const stMyPickup& a, const stMyPickup& b) const {
+    return a.id == b.id && a.model == b.model && a.position == b.position;
+}
+
+bool StreamableEqual::operator()(const st3DTextLabel& a, const st3DTextLabel& b) const {
+    return a.id == b.id && a.position == b.position && a.attachedPlayer == b.attachedPlayer &&
+           a.attachedVehicle == b.attachedVehicle && a.drawDistance == b.drawDistance &&
+           a.testLOS == b.testLOS && a.text == b.text;
+}
+
+namespace {
+    // Heap bytes of a string beyond its inline buffer
+    size_t stringHeapBytes(const std::string& text) {
+        return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+    }
+
+    template <typename Map>
+    size_t attachmentBytes(const Map& attachments) {
+        size_t bytes = attachments.bucket_count() * sizeof(void*);
+        for (const auto& entry : attachments) {
+            bytes += sizeof(void*) + sizeof(entry) + entry.second.capacity() * sizeof(int);
+        }
+        return bytes;
+    }
+}
+
+size_t stStreamableCache::getMemoryUsage() const {
+    // Record texts are handles into `texts` and counted there
+    return texts.getMemoryUsage(stringHeapBytes) + objects.getMemoryUsage() + pickups.getMemoryUsage() + labels.getMemoryUsage();
+}
 
 CStreamableResourcePool::CStreamableResourcePool() = default;
 
 CStreamableResourcePool::~CStreamableResourcePool() = default;
 
+void CStreamableResourcePool::setCache(std::shared_ptr<stStreamableCache> cache) {
+    this->cache = std::move(cache);
+}
+
 void CStreamableResourcePool::addPickup(const stMyPickup& pickup) {
-    if (pickupCount >= MAX_PICKUPS) return;
-    
-    pickups[pickupCount] = pickup;
-    pickupIdToIndex[pickup.id] = pickupCount;
-    pickupCount++;
+    if (pickups.insert(makeRef(pickup, cache ? &cache->pickups : nullptr))) {
+        version++;
+    }
+}
+
+StreamableText CStreamableResourcePool::shareText(const StreamableText& text) const {
+    if (!cache || text.empty()) {
+        return text;
+    }
+    return StreamableText(cache->texts.intern(text.str()));
 }
 
 void CStreamableResourcePool::addObject(const stObject& object) {
-    if (objectCount >= MAX_OBJECTS) return;
-    
-    objects[objectCount] = object;
-    objectIdToIndex[object.id] = objectCount;
-    objectCount++;
+    stObject shared = object;
+    shared.materialText = shareText(object.materialText);
+    if (objects.insert(makeRef(shared, cache ? &cache->objects : nullptr))) {
+        version++;
+    }
 }
 
 void CStreamableResourcePool::addLabel(const st3DTextLabel& label) {
-    if (labelCount >= MAX_LABELS) return;
-    
-    labels[labelCount] = label;
-    labelIdToIndex[label.id] = labelCount;
-    addLabelToSpatialHash(labelCount);
-    addLabelToAttachmentHashmaps(labelCount);
-    labelCount++;
+    // A label re-created under the same id may be attached elsewhere now
+    if (const auto* existing = labels.find(label.id)) {
+        removeLabelFromAttachmentHashmaps(*existing->record);
+    }
+    st3DTextLabel shared = label;
+    shared.text = shareText(label.text);
+    if (labels.insert(makeRef(shared, cache ? &cache->labels : nullptr))) {
+        addLabelToAttachmentHashmaps(label);
+        version++;
+    }
 }
 
 void CStreamableResourcePool::removePickup(int id) {
-    auto it = pickupIdToIndex.find(id);
-    if (it == pickupIdToIndex.end()) return; // ID not found
-    
-    size_t index = it->second;
-    
-    // Remove from ID mapping
-    pickupIdToIndex.erase(it);
-    
-    // If not the last element, swap with last element
-    if (index < pickupCount - 1) {
-        pickups[index] = pickups[pickupCount - 1];
-        // Update the ID mapping for the moved element
-        pickupIdToIndex[pickups[index].id] = index;
+    if (pickups.remove(id)) {
+        version++;
     }
-    pickupCount--;
 }
 
 void CStreamableResourcePool::removeObject(int id) {
-    auto it = objectIdToIndex.find(id);
-    if (it == objectIdToIndex.end()) return; // ID not found
-    
-    size_t index = it->second;
-    
-    // Remove from ID mapping
-    objectIdToIndex.erase(it);
-    
-    // If not the last element, swap with last element
-    if (index < objectCount - 1) {
-        objects[index] = objects[objectCount - 1];
-        // Update the ID mapping for the moved element
-        objectIdToIndex[objects[index].id] = index;
+    if (objects.remove(id)) {
+        version++;
     }
-    objectCount--;
 }
 
 void CStreamableResourcePool::removeLabel(int id) {
-    auto it = labelIdToIndex.find(id);
-    if (it == labelIdToIndex.end()) return; // ID not found
-    
-    size_t index = it->second;
-    
-    // Remove from spatial hash and attachment hashmaps
-    removeLabelFromSpatialHash(index);
-    removeLabelFromAttachmentHashmaps(index);
-    
-    // Remove from ID mapping
-    labelIdToIndex.erase(it);
-    
-    // If not the last element, swap with last element
-    if (index < labelCount - 1) {
-        // Remove the last element from spatial structures first
-        removeLabelFromSpatialHash(labelCount - 1);
-        removeLabelFromAttachmentHashmaps(labelCount - 1);
-        
-        // Move the last label to fill the gap
-        labels[index] = labels[labelCount - 1];
-        
-        // Update ID mapping for the moved element
-        labelIdToIndex[labels[index].id] = index;
-        
-        // Re-add the moved label to spatial structures at new index
-        addLabelToSpatialHash(index);
-        addLabelToAttachmentHashmaps(index);
-    }
-    labelCount--;
+    const auto* label = labels.find(id);
+    if (!label) return; // ID not found
+
+    removeLabelFromAttachmentHashmaps(*label->record);
+    labels.remove(id);
+    version++;
 }
 
-glm::vec3 CStreamableResourcePool::getPickupPosition(int id) {
-    auto it = pickupIdToIndex.find(id);
-    if (it != pickupIdToIndex.end()) {
-        return pickups[it->second].position;
+glm::vec3 CStreamableResourcePool::getPickupPosition(int id) const {
+    if (const auto* pickup = pickups.find(id)) {
+        return pickup->position;
     }
     return glm::vec3(0.0f); // Default position if not found
 }
 
 void CStreamableResourcePool::clear() {
-    pickupCount = 0;
-    objectCount = 0;
-    labelCount = 0;
-    
-    // Clear ID-to-index mappings
-    pickupIdToIndex.clear();
-    objectIdToIndex.clear();
-    labelIdToIndex.clear();
-    
-    clearLabelSpatialHash();
-    clearLabelAttachmentHashmaps();
+    // Releases the storage too, a disconnected bot holds no streamable memory
+    version++;
+    pickups.clear();
+    objects.clear();
+    labels.clear();
+    std::unordered_map<int, std::vector<int>>().swap(labelsByAttachedPlayer);
+    std::unordered_map<int, std::vector<int>>().swap(labelsByAttachedVehicle);
+}
+
+size_t CStreamableResourcePool::getMemoryUsage() const {
+    return pickups.getMemoryUsage() + objects.getMemoryUsage() + labels.getMemoryUsage()
+         + attachmentBytes(labelsByAttachedPlayer) + attachmentBytes(labelsByAttachedVehicle);
+}
+
+size_t CStreamableResourcePool::getRecordBytes() const {
+    size_t bytes = pickups.size() * sizeof(stMyPickup);
+    for (const auto& object : objects.getItems()) {
+        bytes += sizeof(stObject) - sizeof(StreamableText) + sizeof(std::string) + stringHeapBytes(object.record->materialText.str());
+    }
+    for (const auto& label : labels.getItems()) {
+        bytes += sizeof(st3DTextLabel) - sizeof(StreamableText) + sizeof(std::string) + stringHeapBytes(label.record->text.str());
+    }
+    return bytes;
+}
+
+size_t CStreamableResourcePool::getFixedLayoutBytes() {
+    // The records used to keep their texts inline as std::string
+    return MAX_PICKUPS * sizeof(stMyPickup)
+         + MAX_OBJECTS * (sizeof(stObject) - sizeof(StreamableText) + sizeof(std::string))
+         + MAX_LABELS * (sizeof(st3DTextLabel) - sizeof(StreamableText) + sizeof(std::string));
 }
 
 std::vector<stMyPickup> CStreamableResourcePool::getPickupsInRange(const glm::vec3& position, float range) const {
     std::vector<stMyPickup> result;
-    float rangeSq = range * range;
-    
-    for (size_t i = 0; i < pickupCount; i++) {
-        glm::vec3 diff = pickups[i].position - position;
-        if (diff.x * diff.x + diff.y * diff.y + diff.z * diff.z <= rangeSq) {
-            result.push_back(pickups[i]);
-        }
-    }
-    
+    pickups.forEachInRange(position, range, [&result](const PickupRef& pickup) {
+        result.push_back(*pickup.record);
+    });
     return result;
 }
 
 std::vector<stObject> CStreamableResourcePool::getObjectsInRange(const glm::vec3& position, float range) const {
     std::vector<stObject> result;
-    float rangeSq = range * range;
-    
-    for (size_t i = 0; i < objectCount; i++) {
-        glm::vec3 diff = objects[i].position - position;
-        if (diff.x * diff.x + diff.y * diff.y + diff.z * diff.z <= rangeSq) {
-            result.push_back(objects[i]);
-        }
-    }
-    
+    objects.forEachInRange(position, range, [&result](const ObjectRef& object) {
+        result.push_back(*object.record);
+    });
     return result;
 }
 
-// 3D Space-based label search using spatial hash (optimized for many labels)
 std::vector<st3DTextLabel> CStreamableResourcePool::getLabelsInRange(const glm::vec3& position, float range) const {
     std::vector<st3DTextLabel> result;
-    float rangeSq = range * range;
-    
-    // Calculate grid bounds for the search area
-    GridCoord minGrid = getGridCoord(position - glm::vec3(range));
-    GridCoord maxGrid = getGridCoord(position + glm::vec3(range));
-    
-    // Search through relevant grid cells
-    for (int x = minGrid.x; x <= maxGrid.x; x++) {
-        for (int y = minGrid.y; y <= maxGrid.y; y++) {
-            for (int z = minGrid.z; z <= maxGrid.z; z++) {
-                GridCoord coord = {x, y, z};
-                auto it = labelSpatialHash.find(coord);
-                if (it != labelSpatialHash.end()) {
-                    // Check each label in this grid cell
-                    for (size_t labelIndex : it->second) {
-                        if (labelIndex < labelCount) {
-                            const auto& label = labels[labelIndex];
-                            glm::vec3 diff = label.position - position;
-                            if (diff.x * diff.x + diff.y * diff.y + diff.z * diff.z <= rangeSq) {
-                                result.push_back(label);
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-    
+    labels.forEachInRange(position, range, [&result](const LabelRef& label) {
+        result.push_back(*label.record);
+    });
     return result;
 }
 
-// Container-based label search (linear search through all labels)
-std::vector<st3DTextLabel> CStreamableResourcePool::getLabelsInRangeLinear(const glm::vec3& position, float range) const {
-    std::vector<st3DTextLabel> result;
-    float rangeSq = range * range;
-    
-    // Linear search through all labels in the container
-    for (size_t i = 0; i < labelCount; i++) {
-        const auto& label = labels[i];
-        glm::vec3 diff = label.position - position;
-        if (diff.x * diff.x + diff.y * diff.y + diff.z * diff.z <= rangeSq) {
-            result.push_back(label);
-        }
+std::vector<stObject> CStreamableResourcePool::getNearestObjects(const glm::vec3& position, size_t k, float range) const {
+    std::vector<stObject> result;
+    for (const auto* object : objects.nearest(position, k, range)) {
+        result.push_back(*object->record);
     }
-    
     return result;
 }
 
-// Spatial Hash Helper Functions
-GridCoord CStreamableResourcePool::getGridCoord(const glm::vec3& position) const {
-    return {
-        static_cast<int>(std::floor(position.x / GRID_CELL_SIZE)),
-        static_cast<int>(std::floor(position.y / GRID_CELL_SIZE)),
-        static_cast<int>(std::floor(position.z / GRID_CELL_SIZE))
-    };
-}
-
-void CStreamableResourcePool::addLabelToSpatialHash(size_t labelIndex) {
-    if (labelIndex >= labelCount) return;
-    
-    GridCoord coord = getGridCoord(labels[labelIndex].position);
-    labelSpatialHash[coord].push_back(labelIndex);
-}
+// Label Attachment Query Methods
+std::vector<st3DTextLabel> CStreamableResourcePool::collectLabels(const std::unordered_map<int, std::vector<int>>& attachments, int key) const {
+    std::vector<st3DTextLabel> result;
 
-void CStreamableResourcePool::removeLabelFromSpatialHash(size_t labelIndex) {
-    if (labelIndex >= labelCount) return;
-    
-    GridCoord coord = getGridCoord(labels[labelIndex].position);
-    auto it = labelSpatialHash.find(coord);
-    if (it != labelSpatialHash.end()) {
-        auto& indices = it->second;
-        indices.erase(std::remove(indices.begin(), indices.end(), labelIndex), indices.end());
-        
-        // Remove empty grid cells
-        if (indices.empty()) {
-            labelSpatialHash.erase(it);
+    auto it = attachments.find(key);
+    if (it != attachments.end()) {
+        for (int labelId : it->second) {
+            if (const auto* label = labels.find(labelId)) {
+                result.push_back(*label->record);
+            }
         }
     }
-}
 
-void CStreamableResourcePool::clearLabelSpatialHash() {
-    labelSpatialHash.clear();
+    return result;
 }
 
-// Label Attachment Query Methods
 std::vector<st3DTextLabel> CStreamableResourcePool::getLabelsAttachedToPlayer(int playerId) const {
-    std::vector<st3DTextLabel> result;
-    
-    auto it = labelsByAttachedPlayer.find(playerId);
-    if (it != labelsByAttachedPlayer.end()) {
-        for (size_t labelIndex : it->second) {
-            if (labelIndex < labelCount) {
-                result.push_back(labels[labelIndex]);
-            }
-        }
-    }
-    
-    return result;
+    return collectLabels(labelsByAttachedPlayer, playerId);
 }
 
 std::vector<st3DTextLabel> CStreamableResourcePool::getLabelsAttachedToVehicle(int vehicleId) const {
-    std::vector<st3DTextLabel> result;
-    
-    auto it = labelsByAttachedVehicle.find(vehicleId);
-    if (it != labelsByAttachedVehicle.end()) {
-        for (size_t labelIndex : it->second) {
-            if (labelIndex < labelCount) {
-                result.push_back(labels[labelIndex]);
-            }
-        }
-    }
-    
-    return result;
+    return collectLabels(labelsByAttachedVehicle, vehicleId);
 }
 
 // Attachment Hashmap Helper Functions
-void CStreamableResourcePool::addLabelToAttachmentHashmaps(size_t labelIndex) {
-    if (labelIndex >= labelCount) return;
-    
-    const auto& label = labels[labelIndex];
-    
+void CStreamableResourcePool::addLabelToAttachmentHashmaps(const st3DTextLabel& label) {
     // Add to player attachment hashmap if attached to a player
     if (label.attachedPlayer != -1) {
-        labelsByAttachedPlayer[label.attachedPlayer].push_back(labelIndex);
+        labelsByAttachedPlayer[label.attachedPlayer].push_back(label.id);
     }
-    
+
     // Add to vehicle attachment hashmap if attached to a vehicle
     if (label.attachedVehicle != -1) {
-        labelsByAttachedVehicle[label.attachedVehicle].push_back(labelIndex);
+        labelsByAttachedVehicle[label.attachedVehicle].push_back(label.id);
     }
 }
 
-void CStreamableResourcePool::removeLabelFromAttachmentHashmaps(size_t labelIndex) {
-    if (labelIndex >= labelCount) return;
-    
-    const auto& label = labels[labelIndex];
-    
-    // Remove from player attachment hashmap
-    if (label.attachedPlayer != -1) {
-        auto it = labelsByAttachedPlayer.find(label.attachedPlayer);
-        if (it != labelsByAttachedPlayer.end()) {
-            auto& indices = it->second;
-            indices.erase(std::remove(indices.begin(), indices.end(), labelIndex), indices.end());
-            
-            // Remove empty entries
-            if (indices.empty()) {
-                labelsByAttachedPlayer.erase(it);
-            }
+void CStreamableResourcePool::removeLabelFromAttachmentHashmaps(const st3DTextLabel& label) {
+    auto detach = [&label](std::unordered_map<int, std::vector<int>>& attachments, int key) {
+        auto it = attachments.find(key);
+        if (it == attachments.end()) return;
+
+        auto& ids = it->second;
+        ids.erase(std::remove(ids.begin(), ids.end(), label.id), ids.end());
+
+        // Remove empty entries
+        if (ids.empty()) {
+            attachments.erase(it);
         }
+    };
+
+    if (label.attachedPlayer != -1) {
+        detach(labelsByAttachedPlayer, label.attachedPlayer);
     }
-    
-    // Remove from vehicle attachment hashmap
     if (label.attachedVehicle != -1) {
-        auto it = labelsByAttachedVehicle.find(label.attachedVehicle);
-        if (it != labelsByAttachedVehicle.end()) {
-            auto& indices = it->second;
-            indices.erase(std::remove(indices.begin(), indices.end(), labelIndex), indices.end());
-            
-            // Remove empty entries
-            if (indices.empty()) {
-                labelsByAttachedVehicle.erase(it);
-            }
-        }
+        detach(labelsByAttachedVehicle, label.attachedVehicle);
     }
 }
-
-void CStreamableResourcePool::clearLabelAttachmentHashmaps() {
-    labelsByAttachedPlayer.clear();
-    labelsByAttachedVehicle.clear();
-}
\ No newline at end of file
@@ -5,11 +5,43 @@
 #ifndef CSTREAMABLERESOURCEPOOL_H
 #define CSTREAMABLERESOURCEPOOL_H
 
-#include <array>
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <cstdint>
+#include <memory>
 #include "glm/vec3.hpp"
+#include "../utils/ds/SpatialIndex.h"
+#include "../utils/ds/InternTable.h"
+
+// Text of a streamed record. Pools intern it per server, so a string shown by
+// many labels or objects is stored once; records only carry this handle.
+class StreamableText {
+public:
+    StreamableText() = default;
+    StreamableText(const char* text) : StreamableText(std::string(text)) {}
+    StreamableText(std::string text) {
+        if (!text.empty()) {
+            shared = std::make_shared<const std::string>(std::move(text));
+        }
+    }
+    explicit StreamableText(std::shared_ptr<const std::string> text) : shared(std::move(text)) {}
+
+    const std::string& str() const { return shared ? *shared : emptyString(); }
+    bool empty() const { return !shared || shared->empty(); }
+    const std::shared_ptr<const std::string>& get() const { return shared; }
+
+    bool operator==(const StreamableText& other) const { return shared == other.shared || str() == other.str(); }
+    bool operator!=(const StreamableText& other) const { return !(*this == other); }
+
+private:
+    static const std::string& emptyString() {
+        static const std::string empty;
+        return empty;
+    }
+
+    std::shared_ptr<const std::string> shared;
+};
 
 struct stObject {
     int id;
@@ -17,7 +49,7 @@ struct stObject {
     glm::vec3 position;
     glm::vec3 rotation;
     float drawDistance;
-    std::string materialText;
+    StreamableText materialText;
 };
 
 struct stMyPickup {
@@ -31,25 +63,43 @@ struct st3DTextLabel {
     glm::vec3 position;
     int attachedPlayer;
     int attachedVehicle;
-    std::string text;
+    StreamableText text;
     float drawDistance;
     bool testLOS;
 };
 
-struct GridCoord {
-    int x, y, z;
-    bool operator==(const GridCoord &other) const {
-        return x == other.x && y == other.y && z == other.z;
-    }
+// Content hash and equality of streamed records, equal records are shared between bots
+struct StreamableHash {
+    size_t operator()(const stObject& object) const;
+    size_t operator()(const stMyPickup& pickup) const;
+    size_t operator()(const st3DTextLabel& label) const;
 };
 
-struct GridHash {
-    std::size_t operator()(const GridCoord& coord) const {
-        std::size_t h1 = std::hash<int>{}(coord.x);
-        std::size_t h2 = std::hash<int>{}(coord.y);
-        std::size_t h3 = std::hash<int>{}(coord.z);
-        return h1 ^ (h2 << 1) ^ (h3 << 2);  // 简单组合哈希
-    }
+struct StreamableEqual {
+    bool operator()(const stObject& a, const stObject& b) const;
+    bool operator()(const stMyPickup& a, const stMyPickup& b) const;
+    bool operator()(const st3DTextLabel& a, const st3DTextLabel& b) const;
+};
+
+// Records streamed in by the bots of one server. Bots there receive mostly the
+// same objects, pickups and labels, every distinct record is stored once and
+// freed when the last bot (or snapshot) referencing it drops it.
+struct stStreamableCache {
+    InternTable<std::string, std::hash<std::string>, std::equal_to<std::string>> texts;
+    InternTable<stObject, StreamableHash, StreamableEqual> objects;
+    InternTable<stMyPickup, StreamableHash, StreamableEqual> pickups;
+    InternTable<st3DTextLabel, StreamableHash, StreamableEqual> labels;
+
+    // Heap bytes of every distinct record and text
+    size_t getMemoryUsage() const;
+};
+
+// What a bot keeps per streamed record: enough to index it, the rest is shared
+template <typename T>
+struct stStreamableRef {
+    int id;
+    glm::vec3 position;
+    std::shared_ptr<const T> record;
 };
 
 class CStreamableResourcePool {
@@ -61,6 +111,10 @@ public:
     CStreamableResourcePool();
     ~CStreamableResourcePool();
 
+    // Records added from now on are shared through the server's cache, without
+    // one every pool keeps its own copies. Records already held stay valid.
+    void setCache(std::shared_ptr<stStreamableCache> cache);
+
     void addPickup(const stMyPickup& pickup);
     void addObject(const stObject& object);
     void addLabel(const st3DTextLabel& label);
@@ -69,59 +123,71 @@ public:
     void removeObject(int id);
     void removeLabel(int id);
 
-    glm::vec3 getPickupPosition(int id);
+    glm::vec3 getPickupPosition(int id) const;
 
     void clear();
 
     std::vector<stMyPickup> getPickupsInRange(const glm::vec3& position, float range) const;
     std::vector<stObject> getObjectsInRange(const glm::vec3& position, float range) const;
-    
-    // 3D Space-based label search (using spatial hash)
     std::vector<st3DTextLabel> getLabelsInRange(const glm::vec3& position, float range) const;
-    
-    // Container-based label search (linear search through all labels)
-    std::vector<st3DTextLabel> getLabelsInRangeLinear(const glm::vec3& position, float range) const;
+
+    // Up to k objects within range, nearest first
+    std::vector<stObject> getNearestObjects(const glm::vec3& position, size_t k, float range) const;
+
+    // Calls fn(pickup / object, label) for every label within labelRange of a
+    // pickup / object within range of position, in one pass over the cells
+    template <typename Fn>
+    void forEachLabelNearPickups(const glm::vec3& position, float range, float labelRange, Fn&& fn) const {
+        pickups.joinInRange(position, range, labels, labelRange,
+                            [&fn](const PickupRef& pickup, const LabelRef& label) { fn(*pickup.record, *label.record); });
+    }
+    template <typename Fn>
+    void forEachLabelNearObjects(const glm::vec3& position, float range, float labelRange, Fn&& fn) const {
+        objects.joinInRange(position, range, labels, labelRange,
+                            [&fn](const ObjectRef& object, const LabelRef& label) { fn(*object.record, *label.record); });
+    }
 
     // Label attachment queries
     std::vector<st3DTextLabel> getLabelsAttachedToPlayer(int playerId) const;
     std::vector<st3DTextLabel> getLabelsAttachedToVehicle(int vehicleId) const;
 
-    size_t getPickupCount() const { return pickupCount; }
-    size_t getObjectCount() const { return objectCount; }
-    size_t getLabelCount() const { return labelCount; }
+    size_t getPickupCount() const { return pickups.size(); }
+    size_t getObjectCount() const { return objects.size(); }
+    size_t getLabelCount() const { return labels.size(); }
+
+    // Bumped by every modification, tells the owning bot when to publish a new snapshot
+    uint64_t getVersion() const { return version; }
+
+    // Heap bytes of the pool's own indexes, the shared records are not included
+    size_t getMemoryUsage() const;
+    // Bytes the records held would take as private copies with their own texts
+    size_t getRecordBytes() const;
+    // What the fixed per-bot arrays (one full record per possible id) used to take
+    static size_t getFixedLayoutBytes();
 
 private:
-    std::array<stMyPickup, MAX_PICKUPS> pickups;
-    std::array<stObject, MAX_OBJECTS> objects;
-    std::array<st3DTextLabel, MAX_LABELS> labels;
-
-    size_t pickupCount = 0;
-    size_t objectCount = 0;
-    size_t labelCount = 0;
-
-    // ID-to-index mappings for O(1) lookups
-    std::unordered_map<int, size_t> pickupIdToIndex;
-    std::unordered_map<int, size_t> objectIdToIndex;
-    std::unordered_map<int, size_t> labelIdToIndex;
-
-    // 3D Spatial Hash for Labels
-    static constexpr float GRID_CELL_SIZE = 2.0f; // 2 units per cell
-    std::unordered_map<GridCoord, std::vector<size_t>, GridHash> labelSpatialHash;
-
-    // Attachment hashmaps for Labels
-    std::unordered_map<int, std::vector<size_t>> labelsByAttachedPlayer;
-    std::unordered_map<int, std::vector<size_t>> labelsByAttachedVehicle;
-
-    // Helper methods for spatial hashing
-    GridCoord getGridCoord(const glm::vec3& position) const;
-    void addLabelToSpatialHash(size_t labelIndex);
-    void removeLabelFromSpatialHash(size_t labelIndex);
-    void clearLabelSpatialHash();
-    
-    // Helper methods for attachment hashmaps
-    void addLabelToAttachmentHashmaps(size_t labelIndex);
-    void removeLabelFromAttachmentHashmaps(size_t labelIndex);
-    void clearLabelAttachmentHashmaps();
+    // Streamed items sit within a few hundred meters of the bot, most queries
+    // cover 300 m and touch a handful of cells
+    static constexpr float GRID_CELL_SIZE = 100.0f;
+
+    using PickupRef = stStreamableRef<stMyPickup>;
+    using ObjectRef = stStreamableRef<stObject>;
+    using LabelRef = stStreamableRef<st3DTextLabel>;
+
+    SpatialIndex<PickupRef> pickups{MAX_PICKUPS, GRID_CELL_SIZE};
+    SpatialIndex<ObjectRef> objects{MAX_OBJECTS, GRID_CELL_SIZE};
+    SpatialIndex<LabelRef> labels{MAX_LABELS, GRID_CELL_SIZE};
+    std::shared_ptr<stStreamableCache> cache;
+    uint64_t version = 0;
+
+    // Attached player / vehicle id -> ids of the labels attached to it
+    std::unordered_map<int, std::vector<int>> labelsByAttachedPlayer;
+    std::unordered_map<int, std::vector<int>> labelsByAttachedVehicle;
+
+    StreamableText shareText(const StreamableText& text) const;
+    void addLabelToAttachmentHashmaps(const st3DTextLabel& label);
+    void removeLabelFromAttachmentHashmaps(const st3DTextLabel& label);
+    std::vector<st3DTextLabel> collectLabels(const std::unordered_map<int, std::vector<int>>& attachments, int key) const;
 };
 
 #endif //CSTREAMABLERESOURCEPOOL_H
\ No newline at end of file
@@ -7,11 +7,12 @@
 
 #include "CApp.h"
 #include "models/CBot.h"
+#include "core/CBotScheduler.h"
 #include "core/CConfig.h"
 #include "core/CLLMBotSessionManager.h"
 #include "core/CPersistentDataStorage.h"
-#include "models/CConnectionQueue.h"
 #include "models/CServer.h"
+#include "SharedUpdateLoop.h"
 #include "spdlog/spdlog.h"
 
 // Global flag for graceful shutdown
@@ -24,31 +25,32 @@ void signalHandler(int signal) {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     using namespace std;
     using namespace hv;
+
+    // BotMasterXL --bake-nav [output]: write the nav file and exit
+    if (argc > 1 && std::string(argv[1]) == "--bake-nav") {
+        return CApp::getInstance()->bakeNavigation(argc > 2 ? argv[2] : "") ? 0 : 1;
+    }
+
     // Setup signal handler for Ctrl+C
     std::signal(SIGINT, signalHandler);
 
     CApp::getInstance()->init();
 
-    // main thread is for raknet bots..
+    // raknet bots are ticked by the scheduler shards, main thread only waits for shutdown
     auto& bots = CApp::getInstance()->getDatabase()->vBots;
-    CConnectionQueue queue(CApp::getInstance()->getConfig()->connection_policy);
+    auto scheduler = CApp::getInstance()->getBotScheduler();
+    scheduler->start();
 
     while (g_running.load()) {
-        queue.try_connect();
-        for (auto& bot : bots) {
-            if (!g_running.load()) {
-                break;
-            }
-            bot->process();
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
     // Graceful shutdown
     spdlog::info("Shutting down...");
+    scheduler->stop();
     
     // Disconnect all bots
     for (auto& bot : bots) {
@@ -56,6 +58,7 @@ int main() {
             bot->disconnect();
         }
     }
+    SharedUpdateLoop::Instance()->Stop();
     
     spdlog::info("BotMasterXL shutdown complete.");
     return 0;
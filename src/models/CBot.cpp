@@ -4,6 +4,7 @@
 #include <spdlog/fmt/fmt.h>
 #include <cstring>
 #include <random>
+#include <algorithm>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/geometric.hpp>
 #include <glm/trigonometric.hpp>
@@ -16,9 +17,12 @@
 #include "../utils/weapon_config.h"
 #include "../utils/TextConverter.h"
 #include "core/CSharedResourcePool.h"
+#include "core/CServerSnapshot.h"
 #include "utils/map_zones.h"
+#include "../physics/CNavGrid.h"
 #include "../physics/CPathFinder.h"
 #include "core/CConfig.h"
+#include "core/CLLMBotSessionManager.h"
 #include "physics/Raycast.h"
 
 CBot::CBot(std::string identifier) : CRakBot(identifier) {
@@ -30,6 +34,9 @@ CBot::CBot(std::string identifier, std::string uuid) : CRakBot(identifier, uuid)
 }
 
 CBot::~CBot() {
+    if (pathRequest) {
+        pathRequest->cancel();
+    }
 }
 
 void CBot::init() {
@@ -44,9 +51,6 @@ void CBot::init() {
     flag = 0;
     deathTick = 0;
 
-    // Initialize pathfinder
-    pathFinder = std::make_shared<CPathFinder>();
-
     // Initialize dialog system
     dialogActive = false;
     dialogID = 0;
@@ -169,8 +173,8 @@ float CBot::getAngle() const {
 void CBot::updateMovingData(glm::vec3 vecDestination, float fRadius, bool bSetAngle, float fSpeed, float fDistOffset) {
     // Add random radius offset if specified
     if (fRadius > 0.0f) {
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
+        // bots on different scheduler shards may call this concurrently
+        thread_local std::mt19937 gen(std::random_device{}());
         std::uniform_real_distribution<float> dis(-fRadius, fRadius);
 
         vecDestination.x += dis(gen);
@@ -378,9 +382,33 @@ void CBot::updateOnfoot() {
     sendOnfootSync(&data_onfoot);
 }
 
+// Only posts the order, process() starts it on the tick thread
 void CBot::go_with_path(const glm::vec3& destination, int iType, float fSpeed) {
-    // if colandreas is disabled manually, just go with no pathfinding
-    if (CApp::getInstance()->getConfig()->enable_colandreas == false) {
+    {
+        std::lock_guard<std::mutex> lock(pathMutex);
+        pathGeneration++;
+        if (pathRequest) {
+            pathRequest->cancel();
+            pathRequest.reset();
+        }
+        pathResultReady = false;
+        pathResult.clear();
+        pathOrderPending = true;
+        pathDestination = destination;
+        pathMoveType = iType;
+        pathMoveSpeed = fSpeed;
+    }
+    requestProcess();
+}
+
+// Runs on the tick thread
+void CBot::startPathOrder(uint64_t generation, const glm::vec3& destination, int iType, float fSpeed) {
+    // A baked nav file finds paths on its own, ColAndreas is only needed without one
+    CNavGrid* navGrid = CApp::getInstance()->getNavGrid();
+    bool bakedNav = navGrid && navGrid->hasBakedFile();
+
+    // if colandreas is disabled manually and nothing is baked, just go with no pathfinding
+    if (CApp::getInstance()->getConfig()->enable_colandreas == false && !bakedNav) {
         go(destination, iType, 0.0, true, fSpeed, 0, 0);
         return;
     }
@@ -388,8 +416,9 @@ void CBot::go_with_path(const glm::vec3& destination, int iType, float fSpeed) {
     // Clear any existing movepath first
     clearMovepath();
 
+    // The line of sight shortcut is a ColAndreas raycast, skipped when the baked grid is in use
     glm::vec3 raycastResult;
-    if (!raycast(position, destination, &raycastResult)) {
+    if (!bakedNav && !raycast(position, destination, &raycastResult)) {
         if (abs(position.z - destination.z) < 3.0) {
             go(destination, iType, 0.0, true, fSpeed, 0, 0);
             return;
@@ -398,34 +427,100 @@ void CBot::go_with_path(const glm::vec3& destination, int iType, float fSpeed) {
 
     // Get current position
     glm::vec3 currentPos = getPosition();
-    
-    // Use pathfinder to calculate optimal route
-    try {
-        spdlog::info("CBot: Finding path from ({}, {}, {}) to ({}, {}, {})", 
-                    currentPos.x, currentPos.y, currentPos.z,
-                    destination.x, destination.y, destination.z);
-        
-        std::vector<glm::vec3> pathWaypoints = pathFinder->findPath(currentPos, destination);
-        
-        if (pathWaypoints.empty()) {
-            importantEvents.emplace_back("Pathfinder failed! Target too far or the goal too complex!");
+
+    spdlog::info("CBot: Finding path from ({}, {}, {}) to ({}, {}, {})",
+                currentPos.x, currentPos.y, currentPos.z,
+                destination.x, destination.y, destination.z);
+
+    // The worker may outlive the bot, it only keeps a weak reference
+    std::weak_ptr<CBot> weakBot = weak_from_this();
+    auto request = CPathFinder::findPathAsync(currentPos, destination,
+        [weakBot, generation](std::vector<glm::vec3> path) {
+            if (auto bot = weakBot.lock()) {
+                bot->onPathFound(generation, std::move(path));
+            }
+        });
+    if (!request) {
+        importantEvents.emplace_back("Pathfinder busy! Try again later.");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(pathMutex);
+    if (generation == pathGeneration) {
+        pathRequest = std::move(request);
+    } else {
+        request->cancel();
+    }
+}
+
+void CBot::cancelPathRequest() {
+    std::lock_guard<std::mutex> lock(pathMutex);
+    pathGeneration++;
+    if (pathRequest) {
+        pathRequest->cancel();
+        pathRequest.reset();
+    }
+    pathResultReady = false;
+    pathResult.clear();
+    pathOrderPending = false;
+}
+
+// Runs on a path worker thread
+void CBot::onPathFound(uint64_t generation, std::vector<glm::vec3> path) {
+    {
+        std::lock_guard<std::mutex> lock(pathMutex);
+        if (generation != pathGeneration) {
             return;
         }
-        
-        spdlog::info("CBot: Pathfinder found route with {} waypoints", pathWaypoints.size());
-        
-        // Create movepath from the calculated waypoints
-        createMovepath(pathWaypoints, false); // No looping for pathfinding
-        
-        // Store movement parameters for consistent behavior
-        m_iMoveType = iType;
-        m_fMoveSpeed = fSpeed;
-        
-        // Start the movepath
-        startMovepath();
-    } catch (const std::exception& e) {
-        importantEvents.emplace_back("Pathfinder failed!");
+        pathRequest.reset();
+        pathResult = std::move(path);
+        pathResultReady = true;
     }
+    requestProcess();
+}
+
+// Runs on the tick thread
+void CBot::applyFoundPath() {
+    std::vector<glm::vec3> path;
+    int moveType;
+    float moveSpeed;
+    {
+        std::unique_lock<std::mutex> lock(pathMutex);
+        if (pathOrderPending) {
+            pathOrderPending = false;
+            uint64_t generation = pathGeneration;
+            glm::vec3 destination = pathDestination;
+            moveType = pathMoveType;
+            moveSpeed = pathMoveSpeed;
+            lock.unlock();
+            startPathOrder(generation, destination, moveType, moveSpeed);
+            return;
+        }
+        if (!pathResultReady) {
+            return;
+        }
+        pathResultReady = false;
+        path.swap(pathResult);
+        moveType = pathMoveType;
+        moveSpeed = pathMoveSpeed;
+    }
+
+    if (path.empty()) {
+        importantEvents.emplace_back("Pathfinder failed! Target too far or the goal too complex!");
+        return;
+    }
+
+    spdlog::info("CBot: Pathfinder found route with {} waypoints", path.size());
+
+    // Create movepath from the calculated waypoints
+    createMovepath(path, false); // No looping for pathfinding
+
+    // Store movement parameters for consistent behavior
+    m_iMoveType = moveType;
+    m_fMoveSpeed = moveSpeed;
+
+    // Start the movepath
+    startMovepath();
 }
 
 void CBot::on_spawned() {
@@ -464,8 +559,12 @@ void CBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
         }
         case RPC_SetPlayerHealth: {
             if (!invulnerable) {
+                float oldHealth = health;
                 bs->Read(health);
                 importantEvents.emplace_back(fmt::format("Your health was set to {}", health));
+                if (health != oldHealth) {
+                    raiseWakeSignal(WAKE_HEALTH);
+                }
             }
             break;
         }
@@ -533,9 +632,10 @@ void CBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
             szMsg[dwStrLen] = 0;
 
             // Convert GB2312 to UTF-8
-            std::string utf8Message = TextConverter::ensureUtf8(std::string(szMsg));
+            std::string utf8Message = TextConverter::ensureUtf8(szMsg, strlen(szMsg));
             addMessageToChatbox(utf8Message);
 
+            // Server messages are mostly broadcasts to everyone, they wait for the next scheduled round
             unreadChatMessage.emplace_back(utf8Message);
             break;
         }
@@ -552,10 +652,14 @@ void CBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
                 break;
 
             // Convert GB2312 to UTF-8
-            std::string utf8ChatText = TextConverter::ensureUtf8(std::string(szText));
+            std::string utf8ChatText = TextConverter::ensureUtf8(szText, strlen(szText));
             addMessageToChatbox(utf8ChatText);
 
             unreadChatMessage.emplace_back(utf8ChatText);
+            // Our own chat echoed back must not wake us
+            if (playerId != playerID) {
+                raiseWakeSignal(WAKE_CHAT);
+            }
             break;
         }
         case RPC_ShowDialog: {
@@ -573,7 +677,7 @@ void CBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
             char titleBuffer[256];
             bs->Read(titleBuffer, titleLength);
             titleBuffer[titleLength] = 0;
-            dialogTitle = TextConverter::ensureUtf8(std::string(titleBuffer));
+            TextConverter::ensureUtf8(titleBuffer, strlen(titleBuffer), dialogTitle);
 
             // Read button 1 (left button)
             uint8_t button1Length;
@@ -581,7 +685,7 @@ void CBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
             char button1Buffer[256];
             bs->Read(button1Buffer, button1Length);
             button1Buffer[button1Length] = 0;
-            dialogButtonLeft = TextConverter::ensureUtf8(std::string(button1Buffer));
+            TextConverter::ensureUtf8(button1Buffer, strlen(button1Buffer), dialogButtonLeft);
 
             // Read button 2 (right button)
             uint8_t button2Length;
@@ -589,15 +693,16 @@ void CBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
             char button2Buffer[256];
             bs->Read(button2Buffer, button2Length);
             button2Buffer[button2Length] = 0;
-            dialogButtonRight = TextConverter::ensureUtf8(std::string(button2Buffer));
+            TextConverter::ensureUtf8(button2Buffer, strlen(button2Buffer), dialogButtonRight);
 
             // Read dialog content (compressed)
             char contentBuffer[4096];
             stringCompressor->DecodeString(contentBuffer, sizeof(contentBuffer), bs);
-            dialogContent = TextConverter::ensureUtf8(std::string(contentBuffer));
+            TextConverter::ensureUtf8(contentBuffer, strlen(contentBuffer), dialogContent);
 
             // Set dialog as active
             dialogActive = true;
+            raiseWakeSignal(WAKE_DIALOG);
             // CLogger::getInstance()->bot->info("Bot {} received dialog: ID={}, Style={}, Title='{}', Content='{}'",
             //                                   name, dialogID, dialogStyle, dialogTitle, dialogContent);
             break;
@@ -644,14 +749,14 @@ void CBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
             bs->Read(PosY);
             bs->Read(PosZ);
             importantEvents.emplace_back(fmt::format("Player {} (ID:{}) has enter your streaming range at {} {} {}",
-                                                     CApp::getInstance()->getResourceManager()->getPlayerName({host, port}, playerID), playerID, PosX, PosY, PosZ));
+                                                     CApp::getInstance()->getResourceManager()->getPlayerName(getServerHandle(), playerID), playerID, PosX, PosY, PosZ));
             break;
         }
         case RPC_WorldPlayerRemove: {
             UINT16 wPlayerID;
             bs->Read(wPlayerID);
             importantEvents.emplace_back(fmt::format("Player {} (ID:{}) has leave your streaming range",
-                                                     CApp::getInstance()->getResourceManager()->getPlayerName({host, port}, playerID), playerID));
+                                                     CApp::getInstance()->getResourceManager()->getPlayerName(getServerHandle(), playerID), playerID));
             break;
         }
     }
@@ -659,6 +764,7 @@ void CBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
 
 void CBot::process() {
     CRakBot::process();
+    applyFoundPath();
     auto dwThisTick = GetTickCount();
     if (getStatus() == SPAWNED) {
         // BOT 是否死了
@@ -700,6 +806,7 @@ void CBot::process() {
                                 // Movepath completed
                                 movepathStatus = MOVEPATH_COMPLETED;
                                 stop();
+                                raiseWakeSignal(WAKE_MOVEPATH_COMPLETED);
                                 return;
                             }
                         }
@@ -727,6 +834,37 @@ void CBot::process() {
     }
 }
 
+unsigned int CBot::getProcessDelay() {
+    unsigned int delay = CRakBot::getProcessDelay();
+    if (getStatus() != SPAWNED) {
+        return delay;
+    }
+
+    auto dwThisTick = GetTickCount();
+    auto untilTick = [dwThisTick](unsigned int startTick, unsigned int interval) -> unsigned int {
+        unsigned int elapsed = dwThisTick - startTick;
+        return elapsed < interval ? interval - elapsed : 1;
+    };
+
+    if (getFlag(IS_DEAD)) {
+        // 复活
+        return std::min(delay, untilTick(deathTick, 4001));
+    }
+
+    // 下一次 onfoot 同步
+    delay = std::min(delay, untilTick(getUpdateTick(), 41));
+    if (getFlag(IS_MOVING)) {
+        unsigned int dwMoveTick = dwThisTick - m_dwMoveStartTime;
+        if (dwMoveTick + 1 < static_cast<unsigned int>(m_dwMoveTime)) {
+            // Last position step right before the move time runs out
+            delay = std::min(delay, static_cast<unsigned int>(m_dwMoveTime) - 1 - dwMoveTick);
+        } else {
+            delay = std::min(delay, untilTick(m_dwMoveStartTime, m_dwMoveTime + m_dwMoveStopDelay + 1));
+        }
+    }
+    return std::max(delay, 1u);
+}
+
 void CBot::on_bullet_data(stBulletData *data) {
     CRakBot::on_bullet_data(data);
     auto damage_amount = WeaponConfig::GetWeaponDamage(data->byteWeaponID);
@@ -828,7 +966,7 @@ void CBot::addMessageToChatbox(const std::string &content) {
 
 
 
-nlohmann::json CBot::generateStateJson() {
+nlohmann::json CBot::generateStateJson(bool consumeEvents) {
     using json = nlohmann::json;
 
     json state;
@@ -842,26 +980,24 @@ nlohmann::json CBot::generateStateJson() {
     state["status"] = getStatusName();
     state["health"] = round_to(health);
     state["armor"] = round_to(armor);
-    auto addr = std::make_pair(host, port);
-    auto P = CApp::getInstance()->getResourceManager()->getPlayersInRange(addr, position, 300.0f, true);
-    if (P.empty()) {
-        state["streamed_players"] = {};
-    } else {
-        for (auto& player : P) {
-            state["streamed_players"].emplace_back(json {
-                {"name", player.name},
-                {"health", round_to(player.health)},
-                {"weapon", WeaponConfig::GetWeaponName(player.weapon)},
-                {"distance", round_to(glm::distance(player.position, position))},
-                {"x", round_to(position.x)},
-                {"y", round_to(position.y)},
-                {"z", round_to(position.z)},
-            });
-        }
-    }
-    state["streamed_vehicles"] =  CApp::getInstance()->getResourceManager()->getVehiclesInRange(addr, position, 300.0f).size();
-    state["streamed_pickups"] = getStreamableResources().getPickupsInRange(position, 300.0f).size();
-    state["streamed_3d_labels"] = getStreamableResources().getLabelsInRange(position, 300.0f).size();
+    // Read from the published snapshots, never from state the network path is writing
+    auto world = CApp::getInstance()->getResourceManager()->getSnapshot(getServerHandle());
+    auto streamables = getStreamableSnapshot();
+    state["streamed_players"] = {};
+    world->forEachPlayerInRange(position, 300.0f, true, [&](const stPlayer& player) {
+        state["streamed_players"].emplace_back(json {
+            {"name", player.name},
+            {"health", round_to(player.health)},
+            {"weapon", WeaponConfig::GetWeaponName(player.weapon)},
+            {"distance", round_to(glm::distance(player.position, position))},
+            {"x", round_to(player.position.x)},
+            {"y", round_to(player.position.y)},
+            {"z", round_to(player.position.z)},
+        });
+    });
+    state["streamed_vehicles"] = world->countVehiclesInRange(position, 300.0f);
+    state["streamed_pickups"] = streamables->getPickupsInRange(position, 300.0f).size();
+    state["streamed_3d_labels"] = streamables->getLabelsInRange(position, 300.0f).size();
 
     state["is_moving"] = getFlag(IS_MOVING);
     for (const auto &it: *getUnreadChatMessage()) {
@@ -871,8 +1007,10 @@ nlohmann::json CBot::generateStateJson() {
         state["important_events"].emplace_back(it);
     }
     // 为下一次清除
-    clearImportantEvents();
-    clearUnreadChatMessage();
+    if (consumeEvents) {
+        clearImportantEvents();
+        clearUnreadChatMessage();
+    }
     if (isDialogActive()) {
         state["dialog"] = getDialogJson();
         state["has_active_dialog"] = true;
@@ -882,6 +1020,28 @@ nlohmann::json CBot::generateStateJson() {
     return state;
 }
 
+size_t CBot::hashState(nlohmann::json state) {
+    // Chat and events are consumed by every round, they wake the session on their own
+    state.erase("new_chat_message");
+    state.erase("important_events");
+    return std::hash<std::string>()(state.dump());
+}
+
+size_t CBot::getStateHash() {
+    return hashState(generateStateJson(false));
+}
+
+void CBot::raiseWakeSignal(eWakeSignal signal) {
+    wakeSignals.fetch_or(signal, std::memory_order_release);
+    if (auto sessionManager = CApp::getInstance()->getLLMSessionManager()) {
+        sessionManager->wake();
+    }
+}
+
+uint32_t CBot::consumeWakeSignals() {
+    return wakeSignals.exchange(0, std::memory_order_acq_rel);
+}
+
 // =================================================================
 // MOVEPATH SYSTEM IMPLEMENTATION
 // =================================================================
@@ -899,6 +1059,7 @@ void CBot::addWaypoint(const glm::vec3& position) {
 }
 
 void CBot::clearMovepath() {
+    cancelPathRequest();
     movepath.clear();
     currentWaypointIndex = 0;
     movepathStatus = MOVEPATH_INACTIVE;
@@ -950,6 +1111,7 @@ void CBot::resumeMovepath() {
 }
 
 void CBot::stopMovepath() {
+    cancelPathRequest();
     movepathStatus = MOVEPATH_INACTIVE;
     waypointReached = false;
     
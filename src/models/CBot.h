@@ -8,16 +8,17 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 
 #include "CRakBot.h"
 #include "glm/vec3.hpp"
 #include "glm/gtc/quaternion.hpp"
 #include "hv/json.hpp"
+#include "../physics/CPathFinder.h"
 
 class CBotManager;
-class CPathFinder;
 
-class CBot : public CRakBot {
+class CBot : public CRakBot, public std::enable_shared_from_this<CBot> {
 public:
     // === Type Definitions ===
     enum eBotFlags {
@@ -82,7 +83,11 @@ public:
     void updateOnfoot();
 
     // Pathfinding integration
+    // Long routes are searched asynchronously, the bot starts walking once the path arrives.
+    // Safe to call from any thread, the order is started on the next tick.
     void go_with_path(const glm::vec3& destination, int iType = 1, float fSpeed = 0.56444f); // MOVE_TYPE_RUN, MOVE_SPEED_RUN
+    // Drops the result of a search still running for an earlier order
+    void cancelPathRequest();
 
     // Movepath system
     void createMovepath(const std::vector<glm::vec3>& waypoints, bool loop = false);
@@ -121,7 +126,22 @@ public:
     nlohmann::json getDialogJson();
 
     // === State Serialization ===
-    nlohmann::json generateStateJson();
+    // consumeEvents clears the chat messages and important events it reports
+    nlohmann::json generateStateJson(bool consumeEvents = true);
+    // Hash of the state without chat messages and events, equal hashes mean the LLM would see the same world
+    static size_t hashState(nlohmann::json state);
+    size_t getStateHash();
+
+    // === LLM Wake Signals ===
+    // Raised on the tick thread, collected by CLLMBotSessionManager which runs
+    // the bot's next LLM round early instead of waiting for the interval
+    enum eWakeSignal : uint32_t {
+        WAKE_CHAT = 1 << 0,
+        WAKE_DIALOG = 1 << 1,
+        WAKE_MOVEPATH_COMPLETED = 1 << 2,
+        WAKE_HEALTH = 1 << 3
+    };
+    uint32_t consumeWakeSignals();
 
     // === Custom Event Callbacks ===
     void on_spawned();
@@ -131,6 +151,7 @@ public:
     void on_receive_rpc(int id, RakNet::BitStream *bs) override;
     void on_bullet_data(stBulletData *data) override;
     void process() override;
+    unsigned int getProcessDelay() override;
 
 private:
     // === Configuration Data ===
@@ -138,7 +159,19 @@ private:
     std::string systemPrompt; // LLM system prompt
     
     // === Pathfinding ===
-    std::shared_ptr<CPathFinder> pathFinder;
+    // go_with_path may be called from any thread and only parks the order
+    // here, process() starts it on the tick thread. The search runs on the
+    // path worker pool, which parks its result here for process() as well.
+    // Every new movement order bumps pathGeneration, older results are dropped.
+    std::mutex pathMutex;
+    uint64_t pathGeneration = 0;
+    CPathFinder::AsyncRequestPtr pathRequest;
+    bool pathOrderPending = false;
+    glm::vec3 pathDestination{0.0f};
+    bool pathResultReady = false;
+    std::vector<glm::vec3> pathResult;
+    int pathMoveType = 0;
+    float pathMoveSpeed = 0.0f;
 
     // === Physical State ===
     glm::vec3 position;
@@ -199,9 +232,14 @@ private:
 
     // === Event System ===
     std::vector<std::string> importantEvents; // 重要事件 用于构建llm 上下文
+    std::atomic<uint32_t> wakeSignals{0};
 
     // === Helper Methods ===
     void addMessageToChatbox(const std::string& content);
+    void onPathFound(uint64_t generation, std::vector<glm::vec3> path);
+    void startPathOrder(uint64_t generation, const glm::vec3& destination, int iType, float fSpeed);
+    void applyFoundPath();
+    void raiseWakeSignal(eWakeSignal signal);
 
     // === Constants ===
     static constexpr int MAX_CHATBOX_SIZE = 64;
@@ -3,8 +3,6 @@
 //
 
 #include "CConnectionQueue.h"
-#include "CApp.h"
-#include "core/CPersistentDataStorage.h"
 
 #include "CBot.h"
 #include <map>
@@ -14,8 +12,7 @@ CConnectionQueue::CConnectionQueue(eConnectionPolicy policy) {
     this->policy = policy;
 }
 
-int CConnectionQueue::try_connect() {
-    auto& bots = CApp::getInstance()->getDatabase()->vBots;
+int CConnectionQueue::try_connect(const std::vector<std::shared_ptr<CBot>>& bots) {
     int ans = 0;
 
     // bot that is connecting or disconnected to the server
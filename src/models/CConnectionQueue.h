@@ -5,7 +5,9 @@
 #ifndef CCONNECTIONQUEUE_H
 #define CCONNECTIONQUEUE_H
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 // Forward declarations
 class CBot;
@@ -18,7 +20,8 @@ enum eConnectionPolicy {
 class CConnectionQueue {
 public:
     CConnectionQueue(eConnectionPolicy policy);
-    int try_connect();
+    // Only the given bots are considered, so every scheduler shard can own a slice
+    int try_connect(const std::vector<std::shared_ptr<CBot>>& bots);
 private:
     eConnectionPolicy policy;
 };
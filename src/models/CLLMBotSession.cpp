@@ -1,15 +1,31 @@
 #include "CLLMBotSession.h"
+#include <algorithm>
 #include "../CApp.h"
 #include "../utils/CFunctionDispatcher.h"
 #include "core/CConfig.h"
+#include "core/CLLMBotSessionManager.h"
 #include "core/CLogger.h"
 #include "core/CPersistentDataStorage.h"
 #include "utils/TextConverter.h"
 
+const char* const CLLMBotSession::STATE_FORMAT_PROMPT =
+    "游戏状态格式：带 \"keyframe\": true 的消息是完整状态；带 \"delta\": true 的消息只包含自上一条状态以来变化的字段，"
+    "未出现的字段保持不变。players_entered 为进入范围的玩家，players_left 为离开范围的玩家名，"
+    "players_moved 为移动超过数米或状态变化的玩家，\"unchanged\": true 表示没有任何变化。";
+
+const char* const CLLMBotSession::SUMMARY_PROMPT =
+    "你负责压缩一个游戏机器人与 LLM 的对话记录。根据已有摘要和新的对话，写出一份更新后的摘要，"
+    "保留目标、承诺、与其他玩家的关系、重要事件和尚未完成的任务，省略坐标和过时的状态。"
+    "只输出摘要本身，不超过 300 字。";
+
 CLLMBotSession::CLLMBotSession(const std::string &sid, std::shared_ptr<CBot> bot_ptr,
                                std::shared_ptr<CLLMProvider> provider_ptr)
     : session_id(sid), bot(bot_ptr), llm_provider(provider_ptr), last_activity(std::chrono::steady_clock::now()),
-      is_active(true), is_idle_waiting_llm(false) {
+      is_active(true), is_idle_waiting_llm(false), next_update(std::chrono::steady_clock::now()),
+      update_requested(false), reserved_tokens(0), estimated_tokens(0), wake_signals(0),
+      last_state_hash(0), last_round_had_tools(true), skipped_rounds(0),
+      state_encoder(CApp::getInstance()->getConfig()->llm_state_keyframe_interval),
+      keyframe_history_index(0), summary_batch(0), summaries_made(0) {
     // No need to initialize function dispatcher - using global one
 }
 
@@ -18,10 +34,131 @@ void CLLMBotSession::updateActivity() {
 }
 
 void CLLMBotSession::addToConversationHistory(const json &message) {
-    conversation_history.push_back(message);
-    if (conversation_history.size() > 20) {
-        conversation_history.pop_front();
+    conversation_history.push(message, static_cast<int>(getHistoryBudget() * MAX_TOOL_RESULT_SHARE));
+}
+
+int CLLMBotSession::getHistoryBudget() const {
+    auto config = CApp::getInstance()->getConfig();
+    if (llm_provider) {
+        auto it = config->llm_model_history_tokens.find(llm_provider->getModel());
+        if (it != config->llm_model_history_tokens.end()) {
+            return it->second;
+        }
+    }
+    return config->llm_history_tokens;
+}
+
+std::string CLLMBotSession::getHistorySummary() const {
+    std::lock_guard<std::mutex> lock(summary_mutex);
+    return history_summary;
+}
+
+std::shared_ptr<CLLMProvider> CLLMBotSession::getSummaryProvider() const {
+    const auto& name = CApp::getInstance()->getConfig()->llm_summary_provider;
+    if (!name.empty()) {
+        for (const auto& provider : CApp::getInstance()->getDatabase()->vLLMProvider) {
+            if (provider->getName() == name) {
+                return provider;
+            }
+        }
+    }
+    return llm_provider;
+}
+
+// Keeps history plus summary inside the budget. The trimmed turns are
+// summarized in the background, the round goes ahead with the old summary.
+void CLLMBotSession::compactHistory() {
+    int budget = getHistoryBudget();
+    {
+        std::lock_guard<std::mutex> lock(summary_mutex);
+        int summary_tokens = CConversationHistory::estimateTokens(history_summary);
+        if (conversation_history.getTokens() + summary_tokens > budget) {
+            auto trimmed = conversation_history.trimTo(static_cast<int>(budget * COMPACT_TARGET) - summary_tokens);
+            pending_summary.insert(pending_summary.end(),
+                                   std::make_move_iterator(trimmed.begin()), std::make_move_iterator(trimmed.end()));
+        }
     }
+    requestSummary();
+}
+
+void CLLMBotSession::requestSummary() {
+    auto dispatcher = CApp::getInstance()->getFunctionDispatcher();
+    auto sessionManager = CApp::getInstance()->getLLMSessionManager();
+    auto provider = getSummaryProvider();
+
+    std::string transcript;
+    std::string previous;
+    {
+        std::lock_guard<std::mutex> lock(summary_mutex);
+        if (summary_batch != 0 || pending_summary.empty()) {
+            return;
+        }
+        if (!dispatcher || !provider) {
+            pending_summary.clear();
+            return;
+        }
+        for (const auto& message : pending_summary) {
+            std::string text;
+            if (auto content = message.find("content"); content != message.end() && content->is_string()) {
+                text = content->get<std::string>();
+            }
+            if (auto calls = message.find("tool_calls"); calls != message.end()) {
+                for (const auto& call : *calls) {
+                    auto function = call.value("function", json::object());
+                    text += " [" + function.value("name", "") + " " + function.value("arguments", "") + "]";
+                }
+            }
+            transcript += message.value("role", "") + ": " +
+                          CConversationHistory::truncate(text, SUMMARY_MESSAGE_TOKENS) + "\n";
+        }
+        previous = history_summary;
+        summary_batch = pending_summary.size();
+    }
+
+    int tokens = CConversationHistory::estimateTokens(transcript) + CConversationHistory::estimateTokens(previous) +
+                 SUMMARY_MAX_TOKENS;
+    if (sessionManager && !sessionManager->getRateLimiter()->tryAcquire(provider->getName(), tokens)) {
+        // Retried on the next round
+        std::lock_guard<std::mutex> lock(summary_mutex);
+        summary_batch = 0;
+        return;
+    }
+
+    std::vector<json> messages = {
+        json{{"role", "system"}, {"content", SUMMARY_PROMPT}},
+        json{{"role", "user"}, {"content", "已有摘要：\n" + (previous.empty() ? std::string("（无）") : previous) +
+                                           "\n\n新的对话：\n" + transcript}}
+    };
+
+    std::weak_ptr<CBot> weak_bot = bot;
+    dispatcher->callLLMAsync(messages, provider, SUMMARY_MAX_TOKENS, tokens,
+        [this, weak_bot](const json& response, bool ok) {
+            if (!weak_bot.lock() || !is_active) {
+                return;
+            }
+
+            std::string summary;
+            if (ok) {
+                json content = response["choices"][0]["message"].value("content", json());
+                if (content.is_string()) {
+                    summary = content.get<std::string>();
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(summary_mutex);
+            if (!summary.empty()) {
+                history_summary = CConversationHistory::truncate(summary, SUMMARY_MAX_TOKENS);
+                summaries_made++;
+            } else {
+                // Those turns are lost, a failing summary provider must not make the backlog grow
+                CLogger::getInstance()->llm->warn("History summary failed for session {}: {}",
+                                                  session_id, response.value("error", "no summary returned"));
+            }
+            pending_summary.erase(pending_summary.begin(), pending_summary.begin() +
+                                  std::min(summary_batch, pending_summary.size()));
+            summary_batch = 0;
+        },
+        session_id);
 }
 
 bool CLLMBotSession::isExpired(std::chrono::minutes timeout) const {
@@ -53,6 +190,12 @@ void CLLMBotSession::deactivate() {
     
     // Clear session data to prevent memory leaks
     conversation_history.clear();
+    state_encoder.reset();
+    {
+        std::lock_guard<std::mutex> lock(summary_mutex);
+        history_summary.clear();
+        pending_summary.clear();
+    }
     action_cooldowns.clear();
     
     // Clear bot reference to break circular references
@@ -66,6 +209,7 @@ json CLLMBotSession::toJson() const {
         {"is_active", is_active},
         {"is_idle_waiting_llm", is_idle_waiting_llm},
         {"conversation_length", conversation_history.size()},
+        {"conversation_tokens", conversation_history.getTokens()},
         {
             "last_activity", std::chrono::duration_cast<std::chrono::seconds>(
                 last_activity.time_since_epoch()).count()
@@ -85,7 +229,7 @@ std::string CLLMBotSession::getProcessedPrompt() const {
 
     std::string processed_prompt = CApp::getInstance()->getConfig()->base_internal_prompt;
 
-    static auto replace_str = [&processed_prompt](const std::string &src, const std::string &dst) {
+    auto replace_str = [&processed_prompt](const std::string &src, const std::string &dst) {
         size_t start_pos = 0;
         while ((start_pos = processed_prompt.find(src, start_pos)) != std::string::npos) {
             processed_prompt.replace(start_pos, src.length(), dst);
@@ -100,16 +244,16 @@ std::string CLLMBotSession::getProcessedPrompt() const {
     return processed_prompt;
 }
 
-void CLLMBotSession::performAutonomousUpdate() {
-    if (!bot) {
-        return;
-    }
-    auto dispatcher = CApp::getInstance()->getFunctionDispatcher();
-    if (!dispatcher) {
-        return;
-    }
-    if (!llm_provider) {
-        return;
+// Rebuilt only when one of its inputs changes, otherwise every round sends
+// the exact same bytes and the provider can serve them from its prompt cache
+const std::string& CLLMBotSession::getSystemPrefix() {
+    const auto& base_prompt = CApp::getInstance()->getConfig()->base_internal_prompt;
+    std::string name = bot->getName();
+    std::string password = bot->getPassword();
+    std::string bot_prompt = bot->getSystemPrompt();
+    if (system_prefix.built && system_prefix.base_prompt == base_prompt && system_prefix.name == name &&
+        system_prefix.password == password && system_prefix.bot_prompt == bot_prompt) {
+        return system_prefix.serialized;
     }
 
     std::vector<json> messages;
@@ -118,26 +262,72 @@ void CLLMBotSession::performAutonomousUpdate() {
         {"role", "system"},
         {"content", getProcessedPrompt()}
     });
+    messages.emplace_back(json{
+        {"role", "system"},
+        {"content", STATE_FORMAT_PROMPT}
+    });
 
     // 用户定义的 prompt
-    if (!bot->getSystemPrompt().empty()) {
+    if (!bot_prompt.empty()) {
         messages.emplace_back(json{
             {"role", "system"},
-            {"content", bot->getSystemPrompt()}
+            {"content", bot_prompt}
         });
     }
 
-    // 2. 在上下文中加入对话历史
-    for (auto& it : conversation_history)
-        messages.push_back(it);
+    system_prefix.base_prompt = base_prompt;
+    system_prefix.name = std::move(name);
+    system_prefix.password = std::move(password);
+    system_prefix.bot_prompt = std::move(bot_prompt);
+    system_prefix.serialized = CFunctionDispatcher::serializeMessages(messages);
+    system_prefix.built = true;
+    CLogger::getInstance()->llm->info("Built system prefix for session {} ({} bytes)",
+                                      session_id, system_prefix.serialized.size());
+    return system_prefix.serialized;
+}
+
+bool CLLMBotSession::performAutonomousUpdate() {
+    if (!bot) {
+        return false;
+    }
+    auto dispatcher = CApp::getInstance()->getFunctionDispatcher();
+    if (!dispatcher) {
+        return false;
+    }
+    if (!llm_provider) {
+        return false;
+    }
+
+    compactHistory();
+
+    // 1. 系统 prompt 前缀，已序列化，保持字节不变以命中服务端的 prompt 缓存
+    const std::string& system_prefix_json = getSystemPrefix();
+
+    std::vector<json> messages;
+    // 2. 在上下文中加入对话历史，较早的部分以摘要代替
+    if (std::string summary = getHistorySummary(); !summary.empty()) {
+        messages.emplace_back(json{
+            {"role", "system"},
+            {"content", "此前对话的摘要：\n" + summary}
+        });
+    }
+    conversation_history.appendTo(messages);
 
     // 3. 加入当前状态（作为 user 消息）
     // 不等待 function_calls_executed，每轮都要提供状态
     auto state = bot->generateStateJson();
-    CLogger::getInstance()->llm->info("state {}", state.dump());
+    last_state_hash = CBot::hashState(state);
+    // A delta needs its keyframe in the history the LLM gets
+    bool keyframe_trimmed = conversation_history.getPushed() == 0 ||
+                            keyframe_history_index < conversation_history.getDropped();
+    std::string content = state_encoder.encode(state, keyframe_trimmed);
+    if (state_encoder.wasKeyframe()) {
+        keyframe_history_index = conversation_history.getPushed();
+    }
+    CLogger::getInstance()->llm->info("state {}", content);
     json user_message = {
         {"role", "user"},
-        {"content", state.dump() }
+        {"content", std::move(content)}
     };
     messages.push_back(user_message);
 
@@ -152,9 +342,14 @@ void CLLMBotSession::performAutonomousUpdate() {
     std::weak_ptr<CBot> weak_bot = bot;
     // weak_bot is captured by lambda function, if we ues shared_ptr it will persist even after we deleted the bot instance
     // in case of the llm connection is active
+    // The dispatcher settles the reservation once the response is in
+    int reserved = reserved_tokens;
+    reserved_tokens = 0;
     dispatcher->callLLMWithFunctionsAsync(
+        system_prefix_json,
         messages,
         llm_provider,
+        reserved,
         [this, weak_bot](const json& response, const std::string& result_type, const json& function_results) {
             // Check if bot is still alive
             if (auto locked_bot = weak_bot.lock()) {
@@ -163,7 +358,7 @@ void CLLMBotSession::performAutonomousUpdate() {
         },
         session_id
     );
-
+    return true;
 }
 
 void CLLMBotSession::processLLMCallback(const json &response, const std::string &result_type, const json &function_results) {
@@ -176,8 +371,24 @@ void CLLMBotSession::processLLMCallback(const json &response, const std::string
     // 解除等待
     is_idle_waiting_llm = false;
 
+    // Sizes the reservation of the next round
+    if (response.contains("usage") && response["usage"].is_object()) {
+        int used_tokens = response["usage"].value("total_tokens", -1);
+        if (used_tokens > 0) {
+            estimated_tokens = used_tokens;
+        }
+    }
+
     spdlog::info(response.dump());
 
+    // Only a round that answered without acting lets later unchanged rounds be skipped
+    last_round_had_tools = result_type != "message";
+    if (result_type == "message" || result_type == "function_calls_executed") {
+        state_encoder.acknowledge();
+    } else {
+        state_encoder.reject();
+    }
+
     if (result_type == "function_calls_executed") {
         CLogger::getInstance()->llm->info("=== LLM Round Complete for Session {} ===", session_id);
         
@@ -5,9 +5,12 @@
 #include <map>
 #include <chrono>
 #include <memory>
+#include <mutex>
 #include <hv/json.hpp>
 #include "CBot.h"
 #include "CLLMProvider.h"
+#include "../utils/CConversationHistory.h"
+#include "../utils/CStateDeltaEncoder.h"
 
 using json = nlohmann::json;
 
@@ -16,12 +19,53 @@ public:
     std::string session_id;
     std::shared_ptr<CBot> bot;
     std::shared_ptr<CLLMProvider> llm_provider;
-    std::deque<json> conversation_history;
+    CConversationHistory conversation_history;
     std::chrono::steady_clock::time_point last_activity;
     std::map<std::string, std::chrono::steady_clock::time_point> action_cooldowns;
     bool is_active;
     bool is_idle_waiting_llm;  // Non-blocking idle state for LLM responses
-    
+
+    // Scheduling of autonomous rounds, owned by CLLMBotSessionManager
+    std::chrono::steady_clock::time_point next_update;
+    bool update_requested;  // triggerUpdate(), goes ahead of every other due session
+    int reserved_tokens;    // taken from the provider's token bucket for the round about to start
+    int estimated_tokens;   // total tokens of the last answered round, 0 before the first
+    uint32_t wake_signals;  // CBot::eWakeSignal bits collected since the last round
+    std::chrono::steady_clock::time_point wake_at;  // debounced time the wake signals take effect
+    std::chrono::steady_clock::time_point last_round;
+    std::chrono::steady_clock::time_point last_chat_wake;
+    size_t last_state_hash;     // CBot::hashState of the state sent in the last round
+    bool last_round_had_tools;  // the LLM acted last round, its results are still to be seen
+    int skipped_rounds;
+
+    // State messages are sent as deltas against what the LLM already saw. A
+    // delta is useless once its keyframe is trimmed from the history.
+    CStateDeltaEncoder state_encoder;
+    uint64_t keyframe_history_index;  // conversation_history.getPushed() when the last keyframe was added
+
+    // Turns trimmed from the history are folded into a rolling summary by
+    // the summary provider. Guarded by summary_mutex, the summary callback
+    // runs on the HTTP thread.
+    mutable std::mutex summary_mutex;
+    std::string history_summary;
+    std::vector<json> pending_summary;  // trimmed, not summarized yet
+    size_t summary_batch;               // pending messages in the request in flight, 0 if none
+    uint64_t summaries_made;
+
+    // System messages every round starts with, see getSystemPrefix()
+    struct stSystemPrefix {
+        bool built = false;
+        std::string base_prompt;
+        std::string name;
+        std::string password;
+        std::string bot_prompt;
+        std::string serialized;
+    } system_prefix;
+
+    // Explains the keyframe/delta state messages, sent after the base prompt
+    static const char* const STATE_FORMAT_PROMPT;
+    static const char* const SUMMARY_PROMPT;
+
     CLLMBotSession(const std::string& sid, std::shared_ptr<CBot> bot_ptr, std::shared_ptr<CLLMProvider> provider_ptr);
     ~CLLMBotSession() = default;
     
@@ -40,13 +84,32 @@ public:
     
     // Get processed prompt with placeholders replaced
     std::string getProcessedPrompt() const;
+    // Base prompt, state format and bot prompt as serialized messages joined by commas
+    const std::string& getSystemPrefix();
+
+    // Token budget of the history for the session's provider model
+    int getHistoryBudget() const;
+    std::string getHistorySummary() const;
 
-    // Periodic autonomous update
-    void performAutonomousUpdate();
+    // Periodic autonomous update, false if no request could be sent
+    bool performAutonomousUpdate();
     void processLLMCallback(const json &response, const std::string &result_type, const json &function_result);
     
     // Get bound LLM provider
     std::shared_ptr<CLLMProvider> getLLMProvider() const { return llm_provider; }
     
     json toJson() const;
+
+private:
+    void compactHistory();
+    void requestSummary();
+    std::shared_ptr<CLLMProvider> getSummaryProvider() const;
+
+    // Trimming goes down to this share of the budget so it does not run every round
+    static constexpr double COMPACT_TARGET = 0.6;
+    // A single tool result may take this share of the budget
+    static constexpr double MAX_TOOL_RESULT_SHARE = 0.25;
+    static constexpr int SUMMARY_MAX_TOKENS = 400;
+    // Longest text of one message in the summary request
+    static constexpr int SUMMARY_MESSAGE_TOKENS = 150;
 };
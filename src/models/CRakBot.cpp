@@ -15,8 +15,11 @@
 #include "StringCompressor.h"
 #include "../core/CSharedResourcePool.h"
 #include "../core/CLogger.h"
+#include "../core/CServerRegistry.h"
+#include "../core/CStreamableCache.h"
 #include "../utils/GetTickCount.h"
 #include "../utils/UUIDUtil.h"
+#include "../utils/PacketReader.h"
 
 #include "../authKey.h"
 #include "hv/json.hpp"
@@ -92,10 +95,27 @@ std::string CRakBot::getStatusName() {
 
 void CRakBot::setHost(const std::string &host) {
     this->host = host;
+    serverHandle = INVALID_SERVER_HANDLE;
 }
 
 void CRakBot::setPort(int port) {
     this->port = port;
+    serverHandle = INVALID_SERVER_HANDLE;
+}
+
+void CRakBot::setServer(const std::string &host, int port) {
+    this->host = host;
+    this->port = port;
+    serverHandle = CApp::getInstance()->getServerRegistry()->intern(this->host, this->port);
+}
+
+ServerHandle CRakBot::getServerHandle() {
+    ServerHandle handle = serverHandle;
+    if (handle == INVALID_SERVER_HANDLE) {
+        handle = CApp::getInstance()->getServerRegistry()->intern(host, port);
+        serverHandle = handle;
+    }
+    return handle;
 }
 
 std::string CRakBot::getHost() {
@@ -159,8 +179,9 @@ bool CRakBot::checkConectionDelay() {
 void CRakBot::connect(std::string host, unsigned short port) {
     if (status != DISCONNECTED) return;
 
-    this->host = host;
-    this->port = port;
+    setServer(host, port);
+    // Streamed records are shared with the other bots on this server
+    streamableResources.setCache(CApp::getInstance()->getStreamableCache()->getServerCache(serverHandle));
 
     client.Connect(host.c_str(), port, 0, 0, 0);
     status = CONNECTING;
@@ -182,6 +203,7 @@ void CRakBot::disconnect() {
 void CRakBot::process() {
     unsigned int currentTick = GetTickCount();
     receive();
+    publishStreamables();
 
     // if (status == SPAWNED && (currentTick - update_tick) > 100) {
     //     updateOnfoot();
@@ -189,140 +211,209 @@ void CRakBot::process() {
     // }
 }
 
+void CRakBot::publishStreamables() {
+    auto current = std::atomic_load(&publishedStreamables);
+    if (current && current->getVersion() == streamableResources.getVersion()) {
+        return;
+    }
+    std::atomic_store(&publishedStreamables, std::make_shared<const CStreamableResourcePool>(streamableResources));
+}
+
+std::shared_ptr<const CStreamableResourcePool> CRakBot::getStreamableSnapshot() const {
+    static const auto empty = std::make_shared<const CStreamableResourcePool>();
+    auto snapshot = std::atomic_load(&publishedStreamables);
+    return snapshot ? snapshot : empty;
+}
+
+unsigned int CRakBot::getProcessDelay() {
+    if (status == DISCONNECTED) {
+        // Woken up once the reconnect delay is over, then polled while waiting
+        // in the connection queue
+        unsigned int elapsed = GetTickCount() - reconnect_tick;
+        if (elapsed <= CONNECTION_TIMEOUT) {
+            return CONNECTION_TIMEOUT - elapsed + 1;
+        }
+        return QUEUE_POLL_INTERVAL;
+    }
+    return MAX_PROCESS_DELAY;
+}
+
+void CRakBot::setPacketArrivalNotifier(std::function<void()> notifier) {
+    std::atomic_store(&processNotifier, std::make_shared<const std::function<void()>>(notifier));
+    // Runs on RakNet's network thread
+    client.AddPacketArrivalHandler([this, notifier = std::move(notifier)]() {
+        packetArrived.store(true, std::memory_order_release);
+        if (notifier) notifier();
+    });
+}
+
+bool CRakBot::consumePacketArrival() {
+    return packetArrived.exchange(false, std::memory_order_acq_rel);
+}
+
+void CRakBot::requestProcess() {
+    // Same flag as network input, the shard treats the bot as due either way
+    packetArrived.store(true, std::memory_order_release);
+    auto notifier = std::atomic_load(&processNotifier);
+    if (notifier && *notifier) (*notifier)();
+}
+
+const std::array<CRakBot::PacketHandler, 256>& CRakBot::getPacketHandlers() {
+    static const std::array<PacketHandler, 256> handlers = []() {
+        std::array<PacketHandler, 256> table{};
+        table[ID_DISCONNECTION_NOTIFICATION] = &CRakBot::handleConnectionClosed;
+        table[ID_CONNECTION_BANNED] = &CRakBot::handleConnectionClosed;
+        table[ID_CONNECTION_ATTEMPT_FAILED] = &CRakBot::handleConnectionClosed;
+        table[ID_NO_FREE_INCOMING_CONNECTIONS] = &CRakBot::handleConnectionClosed;
+        table[ID_INVALID_PASSWORD] = &CRakBot::handleConnectionClosed;
+        table[ID_CONNECTION_LOST] = &CRakBot::handleConnectionClosed;
+        table[ID_CONNECTION_REQUEST_ACCEPTED] = &CRakBot::handleConnectionAccepted;
+        table[ID_AUTH_KEY] = &CRakBot::handleAuthKey;
+        table[ID_PLAYER_SYNC] = &CRakBot::handlePlayerSync;
+        table[ID_VEHICLE_SYNC] = &CRakBot::handleVehicleSync;
+        table[ID_PASSENGER_SYNC] = &CRakBot::handlePassengerSync;
+        table[ID_TRAILER_SYNC] = &CRakBot::handleTrailerSync;
+        table[ID_UNOCCUPIED_SYNC] = &CRakBot::handleUnoccupiedSync;
+        table[ID_BULLET_SYNC] = &CRakBot::handleBulletSync;
+        return table;
+    }();
+    return handlers;
+}
+
 void CRakBot::receive() {
-    unsigned char packetIdentifier;
     Packet *pkt;
-    while (pkt = client.Receive()) {
-        if (!pkt || !pkt->data) {
-            if (pkt) client.DeallocatePacket(pkt);
-            continue;
-        }
-        if ((unsigned char) pkt->data[0] == ID_TIMESTAMP) {
-            if (pkt->length > sizeof(unsigned char) + sizeof(unsigned int))
-                packetIdentifier = (unsigned char) pkt->data[sizeof(unsigned char) + sizeof(unsigned int)];
-            else {
-                client.DeallocatePacket(pkt);
-                continue;
-            }
-        } else
-            packetIdentifier = (unsigned char) pkt->data[0];
-
-        switch (packetIdentifier) {
-            case ID_DISCONNECTION_NOTIFICATION:
-                CLogger::getInstance()->bot->warn("[{}:{}] Server closed connection", name, uuid);
-                resetConnectionStatus();
-                break;
-            case ID_CONNECTION_BANNED:
-                CLogger::getInstance()->bot->error("[{}:{}] Connection banned by server", name, uuid);
-                resetConnectionStatus();
-                break;
-            case ID_CONNECTION_ATTEMPT_FAILED:
-                CLogger::getInstance()->bot->error("[{}:{}] Connection attempt failed", name, uuid);
-                resetConnectionStatus();
-                break;
-            case ID_NO_FREE_INCOMING_CONNECTIONS:
-                CLogger::getInstance()->bot->error("[{}:{}] Server full - no free connections", name, uuid);
-                resetConnectionStatus();
-                break;
-            case ID_INVALID_PASSWORD:
-                CLogger::getInstance()->bot->error("[{}:{}] Invalid password", name, uuid);
-                resetConnectionStatus();
-                break;
-            case ID_CONNECTION_LOST:
-                CLogger::getInstance()->bot->warn("[{}:{}] Connection lost", name, uuid);
-                resetConnectionStatus();
-                break;
-            case ID_CONNECTION_REQUEST_ACCEPTED:
-                CLogger::getInstance()->bot->info("[{}:{}] Connection accepted by server, joining...", name, uuid);
-                sendClientJoin(pkt);
-                status = CONNECTED;
-                break;
-            case ID_AUTH_KEY:
-                sendAuthInfo(pkt);
-                status = WAIT_FOR_JOIN;
-                break;
-            case ID_PLAYER_SYNC: {
-                RakNet::BitStream bsPlayerSync((unsigned char *) pkt->data, pkt->length, false);
-                unsigned short PlayerID;
-                bsPlayerSync.IgnoreBits(8); //PACKET ID
-                bsPlayerSync.Read(PlayerID);
-
-                stOnFootData onFootData{};
-                bsPlayerSync.Read((PCHAR) &onFootData, sizeof(stOnFootData));
-
-                // sync to resources
-                CApp::getInstance()->getResourceManager()->updatePlayer({host, port}, playerID, onFootData);
-
-                on_onfoot_data(&onFootData);
-                break;
-            }
-            case ID_VEHICLE_SYNC: {
-                RakNet::BitStream bsVehicleSync((unsigned char *) pkt->data, pkt->length, false);
-                unsigned short PlayerID;
-                bsVehicleSync.IgnoreBits(8); //PACKET ID
-                bsVehicleSync.Read(PlayerID);
-
-                stInCarData inCarData{};
-                bsVehicleSync.Read((PCHAR) &inCarData, sizeof(stInCarData));
-
-                CApp::getInstance()->getResourceManager()->updateVehicle({host, port}, inCarData.sVehicleID, inCarData);
-
-                on_incar_data(&inCarData);
-                break;
-            }
-            case ID_PASSENGER_SYNC: {
-                RakNet::BitStream bsPassengerSync((unsigned char *) pkt->data, pkt->length, false);
-                unsigned short PlayerID;
-                bsPassengerSync.IgnoreBits(8); //PACKET ID
-                bsPassengerSync.Read(PlayerID);
-
-                stPassengerData passengerData{};
-                bsPassengerSync.Read((PCHAR) &passengerData, sizeof(stPassengerData));
-                on_passenger_data(&passengerData);
-                break;
-            }
-            case ID_AIM_SYNC:
-                break;
-            case ID_TRAILER_SYNC: {
-                RakNet::BitStream bsTrailerSync((unsigned char *) pkt->data, pkt->length, false);
-                unsigned short PlayerID;
-                bsTrailerSync.IgnoreBits(8); //PACKET ID
-                bsTrailerSync.Read(PlayerID);
-
-                stTrailerData trailerData{};
-                bsTrailerSync.Read((PCHAR) &trailerData, sizeof(stTrailerData));
-                on_trailer_data(&trailerData);
-                break;
-            }
-            case ID_UNOCCUPIED_SYNC: {
-                RakNet::BitStream bsUnoccupiedSync((unsigned char *) pkt->data, pkt->length, false);
-                unsigned short PlayerID;
-                bsUnoccupiedSync.IgnoreBits(8); //PACKET ID
-                bsUnoccupiedSync.Read(PlayerID);
-
-                stUnoccupiedData unoccupiedData{};
-                bsUnoccupiedSync.Read((PCHAR) &unoccupiedData, sizeof(stUnoccupiedData));
-                on_unoccupied_data(&unoccupiedData);
-                break;
-            }
-            case ID_MARKERS_SYNC:
-                break;
-            case ID_BULLET_SYNC: {
-                RakNet::BitStream bsBulletSync((unsigned char *) pkt->data, pkt->length, false);
-                unsigned short PlayerID;
-                bsBulletSync.IgnoreBits(8); //PACKET ID
-                bsBulletSync.Read(PlayerID);
-
-                stBulletData bulletData{};
-                bsBulletSync.Read((PCHAR) &bulletData, sizeof(stBulletData));
-                on_bullet_data(&bulletData);
-                break;
-            }
-        }
+    while ((pkt = client.Receive())) {
+        dispatchPacket(pkt);
         client.DeallocatePacket(pkt);
     }
 }
 
+void CRakBot::dispatchPacket(Packet *pkt) {
+    if (!pkt->data || pkt->length == 0) {
+        return;
+    }
+
+    unsigned char packetIdentifier;
+    if ((unsigned char) pkt->data[0] == ID_TIMESTAMP) {
+        if (pkt->length <= sizeof(unsigned char) + sizeof(unsigned int)) {
+            return;
+        }
+        packetIdentifier = (unsigned char) pkt->data[sizeof(unsigned char) + sizeof(unsigned int)];
+    } else {
+        packetIdentifier = (unsigned char) pkt->data[0];
+    }
+
+    PacketHandler handler = getPacketHandlers()[packetIdentifier];
+    if (handler) {
+        (this->*handler)(pkt);
+    }
+}
+
+// Sync packets: packet id, sender player id, then the raw sync struct. Like
+// the BitStream reads before, a sync struct that does not fit is read as all
+// zero and still applied, only a packet without a sender id is dropped.
+template <typename T>
+static bool readSyncPacket(Packet *pkt, unsigned short &senderID, T &syncData) {
+    PacketReader reader(pkt->data, pkt->length);
+    if (!reader.skip(1) || !reader.read(senderID)) {
+        return false;
+    }
+    reader.readOrZero(syncData);
+    return true;
+}
+
+void CRakBot::handleConnectionClosed(Packet *pkt) {
+    switch ((unsigned char) pkt->data[0]) {
+        case ID_DISCONNECTION_NOTIFICATION:
+            CLogger::getInstance()->bot->warn("[{}:{}] Server closed connection", name, uuid);
+            break;
+        case ID_CONNECTION_BANNED:
+            CLogger::getInstance()->bot->error("[{}:{}] Connection banned by server", name, uuid);
+            break;
+        case ID_CONNECTION_ATTEMPT_FAILED:
+            CLogger::getInstance()->bot->error("[{}:{}] Connection attempt failed", name, uuid);
+            break;
+        case ID_NO_FREE_INCOMING_CONNECTIONS:
+            CLogger::getInstance()->bot->error("[{}:{}] Server full - no free connections", name, uuid);
+            break;
+        case ID_INVALID_PASSWORD:
+            CLogger::getInstance()->bot->error("[{}:{}] Invalid password", name, uuid);
+            break;
+        case ID_CONNECTION_LOST:
+            CLogger::getInstance()->bot->warn("[{}:{}] Connection lost", name, uuid);
+            break;
+    }
+    resetConnectionStatus();
+}
+
+void CRakBot::handleConnectionAccepted(Packet *pkt) {
+    CLogger::getInstance()->bot->info("[{}:{}] Connection accepted by server, joining...", name, uuid);
+    sendClientJoin(pkt);
+    status = CONNECTED;
+}
+
+void CRakBot::handleAuthKey(Packet *pkt) {
+    sendAuthInfo(pkt);
+    status = WAIT_FOR_JOIN;
+}
+
+void CRakBot::handlePlayerSync(Packet *pkt) {
+    unsigned short senderID;
+    stOnFootData onFootData;
+    if (!readSyncPacket(pkt, senderID, onFootData)) {
+        return;
+    }
+
+    // sync to resources
+    CApp::getInstance()->getResourceManager()->updatePlayer(getServerHandle(), senderID, onFootData);
+
+    on_onfoot_data(&onFootData);
+}
+
+void CRakBot::handleVehicleSync(Packet *pkt) {
+    unsigned short senderID;
+    stInCarData inCarData;
+    if (!readSyncPacket(pkt, senderID, inCarData)) {
+        return;
+    }
+
+    CApp::getInstance()->getResourceManager()->updateVehicle(getServerHandle(), inCarData.sVehicleID, inCarData);
+
+    on_incar_data(&inCarData);
+}
+
+void CRakBot::handlePassengerSync(Packet *pkt) {
+    unsigned short senderID;
+    stPassengerData passengerData;
+    if (readSyncPacket(pkt, senderID, passengerData)) {
+        on_passenger_data(&passengerData);
+    }
+}
+
+void CRakBot::handleTrailerSync(Packet *pkt) {
+    unsigned short senderID;
+    stTrailerData trailerData;
+    if (readSyncPacket(pkt, senderID, trailerData)) {
+        on_trailer_data(&trailerData);
+    }
+}
+
+void CRakBot::handleUnoccupiedSync(Packet *pkt) {
+    unsigned short senderID;
+    stUnoccupiedData unoccupiedData;
+    if (readSyncPacket(pkt, senderID, unoccupiedData)) {
+        on_unoccupied_data(&unoccupiedData);
+    }
+}
+
+void CRakBot::handleBulletSync(Packet *pkt) {
+    unsigned short senderID;
+    stBulletData bulletData;
+    if (readSyncPacket(pkt, senderID, bulletData)) {
+        on_bullet_data(&bulletData);
+    }
+}
+
 void CRakBot::sendRPC(int id, RakNet::BitStream *bs) {
     client.RPC(&id, bs, HIGH_PRIORITY, RELIABLE, 0, FALSE, UNASSIGNED_NETWORK_ID, NULL);
 }
@@ -518,9 +609,9 @@ void CRakBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
             bs->Read(facing_angle);
 
             // Increment stream count - this player is now visible to this bot
-            CApp::getInstance()->getResourceManager()->updatePlayer({host, port}, wPlayerID,
+            CApp::getInstance()->getResourceManager()->updatePlayer(getServerHandle(), wPlayerID,
                                                                     glm::vec3{PosX, PosY, PosZ});
-            CApp::getInstance()->getResourceManager()->incrementPlayerStreamCount({host, port}, wPlayerID);
+            CApp::getInstance()->getResourceManager()->incrementPlayerStreamCount(getServerHandle(), wPlayerID);
             break;
         }
         case RPC_WorldPlayerRemove: {
@@ -529,7 +620,7 @@ void CRakBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
 
             // Decrement stream count - this player is no longer visible to this bot
             CApp::getInstance()->getResourceManager()->decrementPlayerStreamCount(
-                std::make_pair(host, port), wPlayerID);
+                getServerHandle(), wPlayerID);
             break;
         }
 
@@ -548,8 +639,8 @@ void CRakBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
             bs->Read(szPlayerName, byteNameLen);
             szPlayerName[byteNameLen] = '\0';
 
-            auto cc = TextConverter::ensureUtf8(std::string(szPlayerName));
-            CApp::getInstance()->getResourceManager()->addPlayer(std::make_pair(host, port), {
+            auto cc = TextConverter::ensureUtf8(szPlayerName, strlen(szPlayerName));
+            CApp::getInstance()->getResourceManager()->addPlayer(getServerHandle(), {
                  cc,
                  playerId,
                  100,
@@ -569,7 +660,7 @@ void CRakBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
         case RPC_ServerQuit: {
             UINT16 playerId;
             bs->Read(playerId);
-            CApp::getInstance()->getResourceManager()->removePlayer(std::make_pair(host, port), playerId);
+            CApp::getInstance()->getResourceManager()->removePlayer(getServerHandle(), playerId);
             break;
         }
         case RPC_Create3DTextLabel: {
@@ -598,7 +689,7 @@ void CRakBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
                 {x, y, z},
                 (int) attachedPlayer,
                 (int) attachedVehicle,
-                TextConverter::ensureUtf8(std::string(text)),
+                TextConverter::ensureUtf8(text, strlen(text)),
                 DrawDistance,
                 testLOS != 0
             });
@@ -633,10 +724,10 @@ void CRakBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
             bs->Read(fHealth);
 
             // Add vehicle to shared resource manager
-            CApp::getInstance()->getResourceManager()->updateVehicle({host, port}, wVehicleID, subtype,
+            CApp::getInstance()->getResourceManager()->updateVehicle(getServerHandle(), wVehicleID, subtype,
                                                                      {PosX, PosY, PosZ});
             CApp::getInstance()->getResourceManager()->addVehicle(
-                std::make_pair(host, port), {
+                getServerHandle(), {
                     wVehicleID,
                     fHealth,
                     {PosX, PosY, PosZ},
@@ -646,7 +737,7 @@ void CRakBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
 
             // Increment stream count - this vehicle is now visible to this bot
             CApp::getInstance()->getResourceManager()->incrementVehicleStreamCount(
-                std::make_pair(host, port), wVehicleID);
+                getServerHandle(), wVehicleID);
             break;
         }
         case RPC_WorldVehicleRemove: {
@@ -655,7 +746,7 @@ void CRakBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
 
             // Decrement stream count - this vehicle is no longer visible to this bot
             CApp::getInstance()->getResourceManager()->decrementVehicleStreamCount(
-                std::make_pair(host, port), wVehicleID);
+                getServerHandle(), wVehicleID);
             break;
         }
 
@@ -683,6 +774,7 @@ void CRakBot::on_receive_rpc(int id, RakNet::BitStream *bs) {
             INT32 iPickupID;
             bs->Read(iPickupID);
             streamableResources.removePickup(iPickupID);
+            break;
         }
 
         case RPC_CreateObject: {
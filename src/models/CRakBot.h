@@ -6,11 +6,16 @@
 #define CRAKBOT_H
 
 #include <string>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include "BitStream.h"
 #include "RakClientInterface.h"
 #include "RakClient.h"
 #include "../samp.h"
 #include "../core/CStreamableResourcePool.h"
+#include "../core/CServerRegistry.h"
+#include <array>
 
 class CRakBot {
 public:
@@ -40,8 +45,11 @@ public:
     // === Configuration ===
     void setHost(const std::string& host);
     void setPort(int port);
+    void setServer(const std::string& host, int port);
     std::string getHost();
     int getPort();
+    // Interned handle of host:port, resolved on first use after a change
+    ServerHandle getServerHandle();
 
     // === State Access ===
     std::string getName();
@@ -62,8 +70,9 @@ public:
     std::string getUuid() const;
     unsigned int getReconnectTick() const;
     unsigned int getUpdateTick() const;
-    CStreamableResourcePool& getStreamableResources() { return streamableResources; }
-    const CStreamableResourcePool& getStreamableResources() const { return streamableResources; }
+    // Copy of the streamable resources published at the end of process(), safe to
+    // read from any thread. The live pool is only touched by the bot's shard.
+    std::shared_ptr<const CStreamableResourcePool> getStreamableSnapshot() const;
 
     // === Network Communication ===
     void sendRPC(int id, RakNet::BitStream *bs);
@@ -79,6 +88,18 @@ public:
     void sendSpawn();
     void sendOnfootSync(stOnFootData *onfoot);
 
+    // Handles one packet taken from client.Receive(), the caller keeps ownership
+    void dispatchPacket(Packet *pkt);
+
+    // === Scheduling ===
+    // Milliseconds until process() has time based work to do. Network input
+    // is signalled separately through the packet arrival notifier.
+    virtual unsigned int getProcessDelay();
+    void setPacketArrivalNotifier(std::function<void()> notifier);
+    bool consumePacketArrival();
+    // Makes process() run soon on the bot's tick thread, callable from any thread
+    void requestProcess();
+
     // === Virtual Event Handlers ===
     virtual void process();
     virtual void on_receive_rpc(int id, RakNet::BitStream *bs);
@@ -101,25 +122,52 @@ protected:
     // === Network Configuration ===
     std::string host; 
     unsigned short port;
+    // Interned host:port, the receive path only passes this handle around
+    std::atomic<ServerHandle> serverHandle{INVALID_SERVER_HANDLE};
     unsigned int reconnect_tick;
     unsigned int update_tick;
     bool gameInited;
 
     // === Network Components ===
     RakClient client;
+    std::atomic<bool> packetArrived{false};
+    // Notifier given to setPacketArrivalNotifier, only accessed through std::atomic_load / atomic_store
+    std::shared_ptr<const std::function<void()>> processNotifier;
 
-    // Per-bot streamable resources (pickups, objects, labels)
+    // Per-bot streamable resources (pickups, objects, labels), the records
+    // themselves are shared with the other bots on the server
     CStreamableResourcePool streamableResources;
+    // Only accessed through std::atomic_load / atomic_store
+    std::shared_ptr<const CStreamableResourcePool> publishedStreamables;
+
+    // Upper bound of getProcessDelay(), keeps idle bots polled now and then
+    static constexpr unsigned int MAX_PROCESS_DELAY = 1000;
 
     // === Helper Methods ===
     void resetConnectionStatus();
     void setupRPC();
     void receive();
+    void publishStreamables();
+
+    // === Packet Dispatch ===
+    using PacketHandler = void (CRakBot::*)(Packet *pkt);
+    static const std::array<PacketHandler, 256>& getPacketHandlers();
+
+    void handleConnectionClosed(Packet *pkt);
+    void handleConnectionAccepted(Packet *pkt);
+    void handleAuthKey(Packet *pkt);
+    void handlePlayerSync(Packet *pkt);
+    void handleVehicleSync(Packet *pkt);
+    void handlePassengerSync(Packet *pkt);
+    void handleTrailerSync(Packet *pkt);
+    void handleUnoccupiedSync(Packet *pkt);
+    void handleBulletSync(Packet *pkt);
 
 private:
     // === Network Constants ===
     static constexpr int CONNECTION_TIMEOUT = 4000;
     static constexpr int MTU_SIZE = 576;
+    static constexpr unsigned int QUEUE_POLL_INTERVAL = 100;
 };
 
 #endif //CRAKBOT_H
@@ -0,0 +1,342 @@
+//
+// CNavFile - Baked navigation grid, written offline and memory-mapped at runtime
+//
+
+#include "CNavFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "core/CLogger.h"
+#include "vendor/ColAndreas/DynamicWorld.h"
+
+namespace {
+    constexpr uint32_t NO_REGION = UINT32_MAX;
+    constexpr int TILE_AREA = CNavGrid::TILE_CELLS * CNavGrid::TILE_CELLS;
+    // Height the runtime tiles report for cells without ground
+    constexpr float NO_GROUND_Z = -1000.0f;
+
+    int16_t quantizeHeight(float z) {
+        float scaled = std::round(z * CNavFile::HEIGHT_SCALE);
+        return static_cast<int16_t>(std::clamp(scaled, -32767.0f, 32767.0f));
+    }
+
+    float heightOf(int16_t quantized) {
+        return static_cast<float>(quantized) / CNavFile::HEIGHT_SCALE;
+    }
+
+    uint64_t alignTo8(uint64_t value) {
+        return (value + 7) & ~uint64_t(7);
+    }
+
+    // Union-find that always links the larger root below the smaller one,
+    // so every parent index is lower than its child
+    uint32_t findRoot(std::vector<uint32_t>& parent, uint32_t cell) {
+        while (parent[cell] != cell) {
+            parent[cell] = parent[parent[cell]];
+            cell = parent[cell];
+        }
+        return cell;
+    }
+
+    void unite(std::vector<uint32_t>& parent, uint32_t a, uint32_t b) {
+        a = findRoot(parent, a);
+        b = findRoot(parent, b);
+        if (a < b) parent[b] = a;
+        else if (b < a) parent[a] = b;
+    }
+}
+
+bool CNavFile::open(const std::string& path, std::string& error) {
+    header = nullptr;
+    if (!file.open(path)) {
+        error = "file not found or not readable";
+        return false;
+    }
+
+    const auto* candidate = reinterpret_cast<const stHeader*>(file.data());
+    if (file.size() < sizeof(stHeader) || std::memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = "not a nav file";
+    } else if (candidate->version != VERSION || candidate->headerSize != sizeof(stHeader)) {
+        error = "nav file version " + std::to_string(candidate->version) + ", expected " + std::to_string(VERSION);
+    } else if (candidate->cellSize != CNavGrid::CELL_SIZE || candidate->worldMin != CNavGrid::WORLD_MIN ||
+               candidate->worldCells != CNavGrid::WORLD_CELLS || candidate->tileCells != CNavGrid::TILE_CELLS ||
+               candidate->maxStepHeight != CNavGrid::MAX_STEP_HEIGHT || candidate->minGroundZ != CNavGrid::MIN_GROUND_Z) {
+        error = "baked with different grid rules, run --bake-nav again";
+    } else if (candidate->fileSize != file.size() ||
+               candidate->tileOffsetsOffset + sizeof(uint64_t) * CNavGrid::WORLD_TILES * CNavGrid::WORLD_TILES > file.size() ||
+               candidate->paletteOffset + sizeof(uint32_t) * uint64_t(candidate->paletteCount) > file.size()) {
+        error = "truncated file";
+    } else {
+        header = candidate;
+        tileOffsets = reinterpret_cast<const uint64_t*>(file.data() + header->tileOffsetsOffset);
+        palette = reinterpret_cast<const uint32_t*>(file.data() + header->paletteOffset);
+        return true;
+    }
+
+    file.close();
+    return false;
+}
+
+const CNavFile::stTileRecord* CNavFile::getTileRecord(int tileX, int tileY) const {
+    if (!header || tileX < 0 || tileY < 0 || tileX >= CNavGrid::WORLD_TILES || tileY >= CNavGrid::WORLD_TILES) {
+        return nullptr;
+    }
+    uint64_t offset = tileOffsets[tileY * CNavGrid::WORLD_TILES + tileX];
+    if (offset == 0 || offset + sizeof(stTileRecord) > file.size()) {
+        return nullptr;
+    }
+    return reinterpret_cast<const stTileRecord*>(file.data() + offset);
+}
+
+bool CNavFile::readTile(int tileX, int tileY, CNavGrid::stTile& tile) const {
+    if (tileX < 0 || tileY < 0 || tileX >= CNavGrid::WORLD_TILES || tileY >= CNavGrid::WORLD_TILES) {
+        return false;
+    }
+
+    const stTileRecord* record = getTileRecord(tileX, tileY);
+    for (int i = 0; i < TILE_AREA; i++) {
+        if (record && record->heights[i] != NO_GROUND) {
+            tile.heights[i] = heightOf(record->heights[i]);
+            tile.flags[i] = CNavGrid::CELL_WALKABLE;
+        } else {
+            tile.heights[i] = NO_GROUND_Z;
+            tile.flags[i] = 0;
+        }
+    }
+    return true;
+}
+
+uint32_t CNavFile::getRegion(int cellX, int cellY) const {
+    if (!CNavGrid::isValidCell(cellX, cellY)) {
+        return CNavGrid::REGION_NONE;
+    }
+    const stTileRecord* record = getTileRecord(cellX / CNavGrid::TILE_CELLS, cellY / CNavGrid::TILE_CELLS);
+    if (!record) {
+        return CNavGrid::REGION_NONE;
+    }
+
+    uint8_t local = record->regions[CNavGrid::cellIndexInTile(cellX, cellY)];
+    if (local == 0) {
+        return CNavGrid::REGION_NONE;
+    }
+    if (local == LOCAL_REGION_OVERFLOW || local > record->paletteCount ||
+        uint64_t(record->paletteStart) + local > header->paletteCount) {
+        return CNavGrid::REGION_UNKNOWN;
+    }
+    return palette[record->paletteStart + local - 1];
+}
+
+bool CNavFile::bake(ColAndreasWorld* world, const std::string& path, int threads) {
+    auto log = CLogger::getInstance()->system;
+    constexpr int cells = CNavGrid::WORLD_CELLS;
+    constexpr int tiles = CNavGrid::WORLD_TILES;
+    const size_t cellCount = size_t(cells) * cells;
+    if (threads <= 0) {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    // Bullet is not built thread safe and raycast() locks per world, so every
+    // worker gets its own copy of the map. Copies are loaded one after another
+    // here, the ColAndreas database reader keeps its state in globals.
+    auto phaseStart = std::chrono::steady_clock::now();
+    std::vector<ColAndreasWorld*> worlds{world};
+    std::vector<std::unique_ptr<ColAndreasWorld>> copies;
+    while (static_cast<int>(worlds.size()) < threads) {
+        auto copy = std::make_unique<ColAndreasWorld>();
+        if (!copy->loadCollisionData()) {
+            log->warn("[NAV]: Could not load another collision world, sampling with {} thread(s)", worlds.size());
+            break;
+        }
+        copy->colandreasInitMap();
+        worlds.push_back(copy.get());
+        copies.push_back(std::move(copy));
+    }
+    threads = static_cast<int>(worlds.size());
+    log->info("[NAV]: Loaded {} collision world(s) in {} s", threads,
+              std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - phaseStart).count());
+
+    // 1. One ray per cell, tiles are handed out to the workers one at a time
+    phaseStart = std::chrono::steady_clock::now();
+    log->info("[NAV]: Sampling {}x{} cells with {} thread(s)", cells, cells, threads);
+    std::vector<int16_t> heights(cellCount, NO_GROUND);
+    std::atomic<int> nextTile{0};
+    std::atomic<int> doneTiles{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, workerWorld = worlds[t]]() {
+            CNavGrid::stTile tile;
+            for (int index; (index = nextTile.fetch_add(1)) < tiles * tiles;) {
+                int tileX = index % tiles;
+                int tileY = index / tiles;
+                CNavGrid::sampleTile(workerWorld, tileX, tileY, tile);
+                for (int y = 0; y < CNavGrid::TILE_CELLS; y++) {
+                    for (int x = 0; x < CNavGrid::TILE_CELLS; x++) {
+                        int cellX = tileX * CNavGrid::TILE_CELLS + x;
+                        int cellY = tileY * CNavGrid::TILE_CELLS + y;
+                        int i = y * CNavGrid::TILE_CELLS + x;
+                        if (CNavGrid::isValidCell(cellX, cellY) && (tile.flags[i] & CNavGrid::CELL_WALKABLE)) {
+                            heights[size_t(cellY) * cells + cellX] = quantizeHeight(tile.heights[i]);
+                        }
+                    }
+                }
+                doneTiles.fetch_add(1);
+            }
+        });
+    }
+    for (int reported = 0; doneTiles.load() < tiles * tiles;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        int percent = doneTiles.load() * 100 / (tiles * tiles);
+        if (percent >= reported + 5) {
+            reported = percent - percent % 5;
+            log->info("[NAV]: Sampled {}%", reported);
+        }
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    log->info("[NAV]: Sampling took {} s",
+              std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - phaseStart).count());
+
+    // 2. Connected regions under the same moves the path finder makes
+    phaseStart = std::chrono::steady_clock::now();
+    std::vector<uint32_t> regions(cellCount, NO_REGION);
+    for (size_t i = 0; i < cellCount; i++) {
+        if (heights[i] != NO_GROUND) regions[i] = static_cast<uint32_t>(i);
+    }
+    auto walkable = [&](int x, int y) {
+        return CNavGrid::isValidCell(x, y) && heights[size_t(y) * cells + x] != NO_GROUND;
+    };
+    auto step = [&](int fromX, int fromY, int toX, int toY) {
+        return walkable(toX, toY) &&
+               CNavGrid::isStepAllowed(heightOf(heights[size_t(fromY) * cells + fromX]), heightOf(heights[size_t(toY) * cells + toX]));
+    };
+    for (int y = 0; y < cells; y++) {
+        for (int x = 0; x < cells; x++) {
+            if (!walkable(x, y)) continue;
+            uint32_t cell = static_cast<uint32_t>(size_t(y) * cells + x);
+            if (step(x, y, x + 1, y)) unite(regions, cell, cell + 1);
+            if (step(x, y, x, y + 1)) unite(regions, cell, cell + cells);
+            // A diagonal move needs both corners walkable from one of its ends
+            for (int dx : {-1, 1}) {
+                int toX = x + dx, toY = y + 1;
+                if (!step(x, y, toX, toY)) continue;
+                bool fromHere = step(x, y, toX, y) && step(x, y, x, toY);
+                bool fromThere = step(toX, toY, toX, y) && step(toX, toY, x, toY);
+                if (fromHere || fromThere) {
+                    unite(regions, cell, static_cast<uint32_t>(size_t(toY) * cells + toX));
+                }
+            }
+        }
+    }
+
+    // Roots come before their cells, so one ascending pass turns every
+    // entry into a dense region id starting at 1
+    uint32_t regionCount = 0;
+    for (size_t i = 0; i < cellCount; i++) {
+        if (regions[i] == NO_REGION) continue;
+        regions[i] = regions[i] == i ? ++regionCount : regions[regions[i]];
+    }
+    log->info("[NAV]: {} regions found in {} ms", regionCount,
+              std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - phaseStart).count());
+
+    // 3. Tiles without ground are left out, the rest is written in tile order
+    std::string tempPath = path + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        log->error("[NAV]: Cannot write {}", tempPath);
+        return false;
+    }
+
+    stHeader fileHeader{};
+    std::memcpy(fileHeader.magic, MAGIC, sizeof(MAGIC));
+    fileHeader.version = VERSION;
+    fileHeader.headerSize = sizeof(stHeader);
+    fileHeader.cellSize = CNavGrid::CELL_SIZE;
+    fileHeader.worldMin = CNavGrid::WORLD_MIN;
+    fileHeader.worldCells = cells;
+    fileHeader.tileCells = CNavGrid::TILE_CELLS;
+    fileHeader.maxStepHeight = CNavGrid::MAX_STEP_HEIGHT;
+    fileHeader.minGroundZ = CNavGrid::MIN_GROUND_Z;
+    fileHeader.regionCount = regionCount;
+    fileHeader.tileOffsetsOffset = alignTo8(sizeof(stHeader));
+
+    std::vector<uint64_t> offsets(size_t(tiles) * tiles, 0);
+    std::vector<uint32_t> paletteEntries;
+    uint64_t position = fileHeader.tileOffsetsOffset + offsets.size() * sizeof(uint64_t);
+    out.seekp(static_cast<std::streamoff>(position));
+
+    stTileRecord record;
+    for (int tileY = 0; tileY < tiles; tileY++) {
+        for (int tileX = 0; tileX < tiles; tileX++) {
+            std::memset(&record, 0, sizeof(record));
+            record.paletteStart = static_cast<uint32_t>(paletteEntries.size());
+            bool hasGround = false;
+            for (int y = 0; y < CNavGrid::TILE_CELLS; y++) {
+                for (int x = 0; x < CNavGrid::TILE_CELLS; x++) {
+                    int cellX = tileX * CNavGrid::TILE_CELLS + x;
+                    int cellY = tileY * CNavGrid::TILE_CELLS + y;
+                    int i = y * CNavGrid::TILE_CELLS + x;
+                    record.heights[i] = NO_GROUND;
+                    if (!walkable(cellX, cellY)) continue;
+
+                    size_t cell = size_t(cellY) * cells + cellX;
+                    hasGround = true;
+                    record.heights[i] = heights[cell];
+
+                    auto begin = paletteEntries.begin() + record.paletteStart;
+                    auto it = std::find(begin, paletteEntries.end(), regions[cell]);
+                    if (it != paletteEntries.end()) {
+                        record.regions[i] = static_cast<uint8_t>(it - begin + 1);
+                    } else if (record.paletteCount + 1 < LOCAL_REGION_OVERFLOW) {
+                        paletteEntries.push_back(regions[cell]);
+                        record.paletteCount++;
+                        record.regions[i] = static_cast<uint8_t>(record.paletteCount);
+                    } else {
+                        record.regions[i] = LOCAL_REGION_OVERFLOW;
+                    }
+                }
+            }
+            if (!hasGround) continue;
+
+            offsets[size_t(tileY) * tiles + tileX] = position;
+            out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+            position += sizeof(record);
+        }
+    }
+
+    fileHeader.paletteOffset = position;
+    fileHeader.paletteCount = static_cast<uint32_t>(paletteEntries.size());
+    out.write(reinterpret_cast<const char*>(paletteEntries.data()),
+              static_cast<std::streamsize>(paletteEntries.size() * sizeof(uint32_t)));
+    position += paletteEntries.size() * sizeof(uint32_t);
+    fileHeader.fileSize = position;
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    out.seekp(static_cast<std::streamoff>(fileHeader.tileOffsetsOffset));
+    out.write(reinterpret_cast<const char*>(offsets.data()), static_cast<std::streamsize>(offsets.size() * sizeof(uint64_t)));
+    out.close();
+    if (!out) {
+        log->error("[NAV]: Failed writing {}", tempPath);
+        return false;
+    }
+
+    // Moved into place once complete, instances that already mapped the old
+    // file keep reading it. Windows refuses to rename over an existing file.
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0 &&
+        (std::remove(path.c_str()) != 0 || std::rename(tempPath.c_str(), path.c_str()) != 0)) {
+        log->error("[NAV]: Cannot move {} to {}", tempPath, path);
+        return false;
+    }
+    log->info("[NAV]: Wrote {} ({} MB)", path, position / (1024 * 1024));
+    return true;
+}
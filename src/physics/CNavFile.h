@@ -0,0 +1,84 @@
+//
+// CNavFile - Baked navigation grid, written offline and memory-mapped at runtime
+//
+
+#ifndef CNAVFILE_H
+#define CNAVFILE_H
+
+#include <cstdint>
+#include <string>
+
+#include "CNavGrid.h"
+#include "../utils/MappedFile.h"
+
+class ColAndreasWorld;
+
+// Layout (little endian, every section 8 byte aligned):
+//   stHeader
+//   uint64_t tileOffsets[WORLD_TILES * WORLD_TILES]   0 for tiles without walkable ground
+//   stTileRecord for every tile with walkable ground
+//   uint32_t palette[]                                region ids referenced by the tiles
+// The bake rules (cell size, step height, ground limit) are stored in the
+// header, a file baked with other rules than the running build is rejected.
+class CNavFile {
+public:
+    static constexpr char MAGIC[8] = {'B', 'M', 'X', 'L', 'N', 'A', 'V', '\0'};
+    static constexpr uint32_t VERSION = 1;
+    // Heights are stored in 1/32 m, which covers -1024..1024 m
+    static constexpr float HEIGHT_SCALE = 32.0f;
+    static constexpr int16_t NO_GROUND = INT16_MIN;
+    // Local region index of cells whose tile touches more regions than fit
+    static constexpr uint8_t LOCAL_REGION_OVERFLOW = 0xFF;
+
+    struct stHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        float cellSize;
+        float worldMin;
+        int32_t worldCells;
+        int32_t tileCells;
+        float maxStepHeight;
+        float minGroundZ;
+        uint32_t regionCount;
+        uint32_t paletteCount;
+        uint64_t tileOffsetsOffset;
+        uint64_t paletteOffset;
+        uint64_t fileSize;
+    };
+
+    struct stTileRecord {
+        int16_t heights[CNavGrid::TILE_CELLS * CNavGrid::TILE_CELLS];
+        // 1-based index into the tile's palette slice, 0 for cells without ground
+        uint8_t regions[CNavGrid::TILE_CELLS * CNavGrid::TILE_CELLS];
+        uint32_t paletteStart;
+        uint32_t paletteCount;
+    };
+
+    // Maps the file and checks that it was baked with the current rules
+    bool open(const std::string& path, std::string& error);
+    bool isOpen() const { return file.isOpen(); }
+
+    // Decodes a tile into the runtime layout, false outside the world
+    bool readTile(int tileX, int tileY, CNavGrid::stTile& tile) const;
+    // Connected region of the cell, REGION_NONE without ground and
+    // REGION_UNKNOWN where the tile ran out of local region slots
+    uint32_t getRegion(int cellX, int cellY) const;
+    uint32_t getRegionCount() const { return header ? header->regionCount : 0; }
+    size_t getFileSize() const { return file.size(); }
+
+    // Samples the whole map with `threads` workers and writes the file. Each
+    // worker beyond the first loads its own copy of the collision world.
+    // Runs for minutes, only used by the --bake-nav mode.
+    static bool bake(ColAndreasWorld* world, const std::string& path, int threads);
+
+private:
+    MappedFile file;
+    const stHeader* header = nullptr;
+    const uint64_t* tileOffsets = nullptr;
+    const uint32_t* palette = nullptr;
+
+    const stTileRecord* getTileRecord(int tileX, int tileY) const;
+};
+
+#endif //CNAVFILE_H
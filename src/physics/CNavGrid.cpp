@@ -0,0 +1,163 @@
+//
+// CNavGrid - Walkable height field of San Andreas, sampled lazily from ColAndreas
+//
+
+#include "CNavGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "CApp.h"
+#include "CNavFile.h"
+#include "Raycast.h"
+#include "core/CLogger.h"
+
+namespace {
+    constexpr float RAY_TOP_Z = 1000.0f;
+    constexpr float RAY_BOTTOM_Z = -1000.0f;
+
+    uint32_t tileKey(int tileX, int tileY) {
+        return static_cast<uint32_t>(tileY) * CNavGrid::WORLD_TILES + static_cast<uint32_t>(tileX);
+    }
+}
+
+CNavGrid::CNavGrid(size_t maxTiles) : maxTiles(std::max<size_t>(maxTiles, 16)) {
+}
+
+CNavGrid::~CNavGrid() = default;
+
+bool CNavGrid::loadBakedFile(const std::string& path) {
+    auto file = std::make_unique<CNavFile>();
+    std::string error;
+    if (!file->open(path, error)) {
+        CLogger::getInstance()->system->warn("[NAV]: Cannot use {}: {}", path, error);
+        return false;
+    }
+
+    CLogger::getInstance()->system->info("[NAV]: Mapped {} ({} MB, {} regions)", path,
+                                         file->getFileSize() / (1024 * 1024), file->getRegionCount());
+    clear();
+    bakedFile = std::move(file);
+    return true;
+}
+
+uint32_t CNavGrid::getRegion(int cellX, int cellY) const {
+    if (!bakedFile) {
+        return REGION_UNKNOWN;
+    }
+    return bakedFile->getRegion(cellX, cellY);
+}
+
+bool CNavGrid::toCell(float x, float y, int& cellX, int& cellY) {
+    float fx = std::floor((x - WORLD_MIN) / CELL_SIZE);
+    float fy = std::floor((y - WORLD_MIN) / CELL_SIZE);
+    if (!(fx >= 0.0f && fy >= 0.0f && fx < WORLD_CELLS && fy < WORLD_CELLS)) {
+        return false;
+    }
+    cellX = static_cast<int>(fx);
+    cellY = static_cast<int>(fy);
+    return true;
+}
+
+CNavGrid::TilePtr CNavGrid::getTile(int tileX, int tileY) {
+    if (tileX < 0 || tileY < 0 || tileX >= WORLD_TILES || tileY >= WORLD_TILES) {
+        return nullptr;
+    }
+
+    uint32_t key = tileKey(tileX, tileY);
+    {
+        std::shared_lock<SharedMutex> lock(mutex);
+        auto it = tiles.find(key);
+        if (it != tiles.end()) {
+            it->second->lastUsed.store(useClock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second->tile;
+        }
+    }
+
+    // Loaded without the lock, two searches racing for the same tile both
+    // build it and the first one to publish wins
+    misses.fetch_add(1, std::memory_order_relaxed);
+    TilePtr tile = loadTile(tileX, tileY);
+
+    std::unique_lock<SharedMutex> lock(mutex);
+    auto& entry = tiles[key];
+    if (!entry) {
+        entry = std::make_unique<stEntry>();
+        entry->tile = std::move(tile);
+    }
+    entry->lastUsed.store(useClock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+    TilePtr result = entry->tile;
+    if (tiles.size() > maxTiles) {
+        evictOldest();
+    }
+    return result;
+}
+
+CNavGrid::TilePtr CNavGrid::loadTile(int tileX, int tileY) {
+    auto tile = std::make_shared<stTile>();
+    if (bakedFile) {
+        bakedFile->readTile(tileX, tileY, *tile);
+        return tile;
+    }
+
+    sampleTile(CApp::getInstance()->getColAndreas(), tileX, tileY, *tile);
+    tilesSampled.fetch_add(1, std::memory_order_relaxed);
+    return tile;
+}
+
+void CNavGrid::sampleTile(ColAndreasWorld* world, int tileX, int tileY, stTile& tile) {
+    for (int y = 0; y < TILE_CELLS; y++) {
+        for (int x = 0; x < TILE_CELLS; x++) {
+            int index = y * TILE_CELLS + x;
+            float worldX = cellCenter(tileX * TILE_CELLS + x);
+            float worldY = cellCenter(tileY * TILE_CELLS + y);
+
+            glm::vec3 hitPoint;
+            if (world && raycast(world, {worldX, worldY, RAY_TOP_Z}, {worldX, worldY, RAY_BOTTOM_Z}, &hitPoint)) {
+                tile.heights[index] = hitPoint.z;
+                tile.flags[index] = hitPoint.z >= MIN_GROUND_Z ? CELL_WALKABLE : 0;
+            } else {
+                tile.heights[index] = RAY_BOTTOM_Z;
+                tile.flags[index] = 0;
+            }
+        }
+    }
+}
+
+// Drops the least recently used quarter of the cache, called with the lock held
+void CNavGrid::evictOldest() {
+    std::vector<std::pair<uint64_t, uint32_t>> ages;
+    ages.reserve(tiles.size());
+    for (const auto& [key, entry] : tiles) {
+        ages.emplace_back(entry->lastUsed.load(std::memory_order_relaxed), key);
+    }
+
+    size_t evict = tiles.size() - maxTiles + maxTiles / 4;
+    std::nth_element(ages.begin(), ages.begin() + evict, ages.end());
+    for (size_t i = 0; i < evict; i++) {
+        tiles.erase(ages[i].second);
+    }
+}
+
+void CNavGrid::clear() {
+    std::unique_lock<SharedMutex> lock(mutex);
+    tiles.clear();
+}
+
+CNavGrid::stStats CNavGrid::getStats() const {
+    stStats stats{};
+    {
+        std::shared_lock<SharedMutex> lock(mutex);
+        stats.cachedTiles = tiles.size();
+    }
+    stats.memoryBytes = stats.cachedTiles * (sizeof(stTile) + sizeof(stEntry));
+    stats.tilesSampled = tilesSampled.load(std::memory_order_relaxed);
+    stats.raysCast = stats.tilesSampled * TILE_CELLS * TILE_CELLS;
+    stats.hits = hits.load(std::memory_order_relaxed);
+    stats.misses = misses.load(std::memory_order_relaxed);
+    return stats;
+}
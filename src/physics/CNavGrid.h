@@ -0,0 +1,122 @@
+//
+// CNavGrid - Walkable height field of San Andreas, sampled lazily from ColAndreas
+//
+
+#ifndef CNAVGRID_H
+#define CNAVGRID_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "../utils/SharedMutex.h"
+
+class CNavFile;
+class ColAndreasWorld;
+
+// Ground height and walkability of every 1 m cell of the map, grouped in
+// square tiles. A tile is decoded from the baked nav file or, without one,
+// sampled with one vertical ray per cell the first time a search touches it.
+// It is then shared by every bot and search. Tiles are immutable once
+// published, readers keep them alive through the shared_ptr so the cache
+// may drop them at any time.
+class CNavGrid {
+public:
+    static constexpr float CELL_SIZE = 1.0f;
+    static constexpr int TILE_CELLS = 32;
+    static constexpr float WORLD_MIN = -3000.0f;
+    static constexpr float WORLD_MAX = 3000.0f;
+    static constexpr int WORLD_CELLS = static_cast<int>((WORLD_MAX - WORLD_MIN) / CELL_SIZE);
+    static constexpr int WORLD_TILES = (WORLD_CELLS + TILE_CELLS - 1) / TILE_CELLS;
+
+    // Largest height difference a ped can walk up or down between two cells
+    static constexpr float MAX_STEP_HEIGHT = 1.08f;
+    // Sea level is 0, anything lower is the sea bed or under the map
+    static constexpr float MIN_GROUND_Z = -1.0f;
+
+    enum eCellFlags : uint8_t {
+        CELL_WALKABLE = 1 << 0
+    };
+
+    // Connected regions are only known with a baked nav file
+    static constexpr uint32_t REGION_NONE = 0;
+    static constexpr uint32_t REGION_UNKNOWN = UINT32_MAX;
+
+    struct stTile {
+        float heights[TILE_CELLS * TILE_CELLS];
+        uint8_t flags[TILE_CELLS * TILE_CELLS];
+    };
+    using TilePtr = std::shared_ptr<const stTile>;
+
+    struct stStats {
+        size_t cachedTiles;
+        size_t memoryBytes;
+        uint64_t tilesSampled;
+        uint64_t raysCast;
+        uint64_t hits;
+        uint64_t misses;
+    };
+
+    explicit CNavGrid(size_t maxTiles);
+    ~CNavGrid();
+
+    // Serves tiles from a baked nav file instead of ColAndreas from now on
+    bool loadBakedFile(const std::string& path);
+    bool hasBakedFile() const { return bakedFile != nullptr; }
+
+    // Cell coordinates, false when the position is outside the world
+    static bool toCell(float x, float y, int& cellX, int& cellY);
+    static float cellCenter(int cell) { return WORLD_MIN + (cell + 0.5f) * CELL_SIZE; }
+    static bool isValidCell(int cellX, int cellY) {
+        return cellX >= 0 && cellY >= 0 && cellX < WORLD_CELLS && cellY < WORLD_CELLS;
+    }
+    static int cellIndexInTile(int cellX, int cellY) {
+        return (cellY % TILE_CELLS) * TILE_CELLS + (cellX % TILE_CELLS);
+    }
+    // Whether a ped can walk between two neighbouring walkable cells
+    static bool isStepAllowed(float fromHeight, float toHeight) {
+        float difference = toHeight - fromHeight;
+        return difference <= MAX_STEP_HEIGHT && difference >= -MAX_STEP_HEIGHT;
+    }
+    // Casts the rays of one tile against the collision world
+    static void sampleTile(ColAndreasWorld* world, int tileX, int tileY, stTile& tile);
+
+    // Tile holding the cell, sampled first if it is not cached. Null outside the world.
+    TilePtr getTile(int tileX, int tileY);
+    TilePtr getTileOfCell(int cellX, int cellY) {
+        return getTile(cellX / TILE_CELLS, cellY / TILE_CELLS);
+    }
+
+    // REGION_UNKNOWN without a baked file, two cells in different known
+    // regions can never be connected by a path
+    uint32_t getRegion(int cellX, int cellY) const;
+
+    void clear();
+    stStats getStats() const;
+
+private:
+    struct stEntry {
+        TilePtr tile;
+        // Value of useClock when the tile was last handed out
+        mutable std::atomic<uint64_t> lastUsed;
+    };
+
+    TilePtr loadTile(int tileX, int tileY);
+    void evictOldest();
+
+    // Set once during startup, before any search runs
+    std::unique_ptr<CNavFile> bakedFile;
+    size_t maxTiles;
+    mutable SharedMutex mutex;
+    std::unordered_map<uint32_t, std::unique_ptr<stEntry>> tiles;
+
+    std::atomic<uint64_t> useClock{0};
+    std::atomic<uint64_t> tilesSampled{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+};
+
+#endif //CNAVGRID_H
@@ -3,83 +3,332 @@
 //
 #include "CPathFinder.h"
 
-#include <queue>
-#include <glm/vec2.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <glm/geometric.hpp>
 
 #include "CApp.h"
-#include "Raycast.h"
+#include "CPathWorkerPool.h"
+#include "core/CConfig.h"
 
-std::vector<glm::vec3> CPathFinder::findPath(glm::vec3 from, glm::vec3 to) {
-    if (glm::distance(from, to) > 150.0) return {};
+namespace {
+    constexpr float SQRT2 = 1.41421356f;
+    constexpr int DIRECTIONS[8][2] = {
+        {1, 0}, {-1, 0}, {0, 1}, {0, -1},
+        {1, 1}, {1, -1}, {-1, 1}, {-1, -1}
+    };
 
-    std::vector<glm::vec3> result;
+    int32_t cellId(int cellX, int cellY) {
+        return cellY * CNavGrid::WORLD_CELLS + cellX;
+    }
 
-    glm::vec2 from2D(from.x, from.y);
-    glm::vec2 to2D(to.x, to.y);
-    glm::vec2 center2D = (from2D + to2D) * 0.5f;
+    float octile(int fromX, int fromY, int toX, int toY) {
+        int dx = std::abs(toX - fromX);
+        int dy = std::abs(toY - fromY);
+        return static_cast<float>(dx + dy) + (SQRT2 - 2.0f) * static_cast<float>(std::min(dx, dy));
+    }
 
-    float radius = glm::distance(from2D, to2D);
-    float spacing = 1;
+    size_t hashCell(int32_t cell) {
+        return static_cast<uint32_t>(cell) * 2654435761u;
+    }
+}
 
-    for (float x = -radius; x <= radius; x += spacing) {
-        for (float y = -radius; y <= radius; y += spacing) {
-            glm::vec2 offset(x, y);
-            if (glm::length(offset) > radius)
-                continue;
+bool CPathFinder::getCell(int cellX, int cellY, float& height) {
+    if (!CNavGrid::isValidCell(cellX, cellY)) {
+        return false;
+    }
 
-            glm::vec2 point2D = center2D + offset;
-            glm::vec3 rayStart(point2D.x, point2D.y, 1000.0f);
-            glm::vec3 rayEnd(point2D.x, point2D.y, -1000.0f);
+    uint32_t key = static_cast<uint32_t>(cellY / CNavGrid::TILE_CELLS) * CNavGrid::WORLD_TILES +
+                   static_cast<uint32_t>(cellX / CNavGrid::TILE_CELLS);
+    if (key != lastTileKey) {
+        // Tiles stay pinned for the whole search, the grid may evict them meanwhile
+        auto& tile = searchTiles[key];
+        if (!tile) {
+            tile = grid->getTileOfCell(cellX, cellY);
+        }
+        lastTileKey = key;
+        lastTile = tile.get();
+    }
 
-            glm::vec3 hitPoint;
-            if (raycast(rayStart, rayEnd, &hitPoint)) {
-                result.push_back(hitPoint);
+    int index = CNavGrid::cellIndexInTile(cellX, cellY);
+    height = lastTile->heights[index];
+    return (lastTile->flags[index] & CNavGrid::CELL_WALKABLE) != 0;
+}
+
+bool CPathFinder::canStep(int fromX, int fromY, float fromHeight, int toX, int toY, float& toHeight) {
+    return getCell(toX, toY, toHeight) && CNavGrid::isStepAllowed(fromHeight, toHeight);
+}
+
+bool CPathFinder::snapToWalkable(const glm::vec3& position, uint32_t preferredRegion, int& cellX, int& cellY) {
+    int centerX, centerY;
+    if (!CNavGrid::toCell(position.x, position.y, centerX, centerY)) {
+        return false;
+    }
+
+    float bestScore = INFINITY;
+    for (int dy = -SNAP_RADIUS; dy <= SNAP_RADIUS; dy++) {
+        for (int dx = -SNAP_RADIUS; dx <= SNAP_RADIUS; dx++) {
+            float height;
+            if (!getCell(centerX + dx, centerY + dy, height)) {
+                continue;
+            }
+            float heightOffset = std::abs(height - position.z);
+            if (heightOffset > SNAP_MAX_HEIGHT) {
+                continue;
+            }
+            float score = heightOffset + std::sqrt(static_cast<float>(dx * dx + dy * dy)) * CNavGrid::CELL_SIZE;
+            if (preferredRegion != CNavGrid::REGION_UNKNOWN) {
+                uint32_t region = grid->getRegion(centerX + dx, centerY + dy);
+                if (region != preferredRegion && region != CNavGrid::REGION_UNKNOWN) {
+                    score += UNREACHABLE_SNAP_PENALTY;
+                }
+            }
+            if (score < bestScore) {
+                bestScore = score;
+                cellX = centerX + dx;
+                cellY = centerY + dy;
             }
         }
     }
+    return bestScore != INFINITY;
+}
 
-    result.push_back(from); // index: n - 2
-    result.push_back(to);   // index: n - 1
+// Walks the cells a straight line from cell to cell crosses, every move
+// between them has to obey the same rules as the search
+bool CPathFinder::isStraightWalkable(int fromX, int fromY, int toX, int toY) {
+    int dx = toX - fromX;
+    int dy = toY - fromY;
+    int steps = std::max(std::abs(dx), std::abs(dy)) * 4;
+    if (steps == 0) {
+        return true;
+    }
 
-    int n = result.size();
-    glm::vec3 tmp;
-    std::vector<std::vector<bool>> edges(n, std::vector<bool>(n, false));
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < i; j++) {
-            if (abs(result[i].z - result[j].z) < 1.08f) {
-                edges[i][j] = edges[j][i] = true;
-            }
+    int x = fromX, y = fromY;
+    float height;
+    getCell(x, y, height);
+    for (int i = 1; i <= steps; i++) {
+        float t = static_cast<float>(i) / static_cast<float>(steps);
+        int nextX = static_cast<int>(std::lround(fromX + dx * t));
+        int nextY = static_cast<int>(std::lround(fromY + dy * t));
+        if (nextX == x && nextY == y) {
+            continue;
+        }
+
+        float nextHeight, cornerHeight;
+        if (!canStep(x, y, height, nextX, nextY, nextHeight)) {
+            return false;
+        }
+        if (nextX != x && nextY != y &&
+            (!canStep(x, y, height, nextX, y, cornerHeight) || !canStep(x, y, height, x, nextY, cornerHeight))) {
+            return false;
         }
+        x = nextX;
+        y = nextY;
+        height = nextHeight;
     }
+    return true;
+}
+
+CPathFinder::stNode* CPathFinder::findNode(int32_t cell) {
+    size_t mask = nodes.size() - 1;
+    for (size_t slot = hashCell(cell) & mask;; slot = (slot + 1) & mask) {
+        if (nodes[slot].cell == cell) return &nodes[slot];
+        if (nodes[slot].cell == -1) return nullptr;
+    }
+}
 
-    std::vector<bool> vis(n, false);
-    std::vector<int> prev(n, -1);
-    std::queue<int> q;
+CPathFinder::stNode& CPathFinder::findOrInsertNode(int32_t cell) {
+    // Open addressing at a load factor of at most one half
+    if ((nodeCount + 1) * 2 > nodes.size()) {
+        std::vector<stNode> previous(std::max<size_t>(nodes.size() * 2, 1024), stNode{-1, -1, 0.0f, false});
+        previous.swap(nodes);
+        size_t mask = nodes.size() - 1;
+        for (const auto& node : previous) {
+            if (node.cell == -1) continue;
+            size_t slot = hashCell(node.cell) & mask;
+            while (nodes[slot].cell != -1) slot = (slot + 1) & mask;
+            nodes[slot] = node;
+        }
+    }
 
-    vis[n - 2] = true; // from
-    q.push(n - 2);
+    size_t mask = nodes.size() - 1;
+    size_t slot = hashCell(cell) & mask;
+    while (nodes[slot].cell != -1) {
+        if (nodes[slot].cell == cell) return nodes[slot];
+        slot = (slot + 1) & mask;
+    }
+    nodeCount++;
+    nodes[slot] = stNode{cell, -1, INFINITY, false};
+    return nodes[slot];
+}
 
-    while (!q.empty()) {
-        int u = q.front(); q.pop();
-        for (int v = 0; v < n; ++v) {
-            if (edges[u][v] && !vis[v]) {
-                vis[v] = true;
-                prev[v] = u;
-                q.push(v);
+void CPathFinder::resetSearch() {
+    if (nodes.size() > RETAINED_NODE_SLOTS) {
+        std::vector<stNode>().swap(nodes);
+        std::vector<stOpenEntry>().swap(open);
+    } else {
+        std::fill(nodes.begin(), nodes.end(), stNode{-1, -1, 0.0f, false});
+        open.clear();
+    }
+    nodeCount = 0;
+    searchTiles.clear();
+    lastTileKey = UINT32_MAX;
+    lastTile = nullptr;
+}
+
+std::vector<glm::vec3> CPathFinder::buildWaypoints(int32_t goalCell, const glm::vec3& to) {
+    std::vector<int32_t> cells;
+    for (int32_t cell = goalCell; cell != -1; cell = findNode(cell)->parent) {
+        cells.push_back(cell);
+    }
+    std::reverse(cells.begin(), cells.end());
+
+    // Keeps only the cells where the straight line to the next one would leave walkable ground
+    std::vector<glm::vec3> waypoints;
+    size_t anchor = 0;
+    while (anchor + 1 < cells.size()) {
+        int anchorX = cells[anchor] % CNavGrid::WORLD_CELLS;
+        int anchorY = cells[anchor] / CNavGrid::WORLD_CELLS;
+        size_t next = anchor + 1;
+        while (next + 1 < cells.size()) {
+            int x = cells[next + 1] % CNavGrid::WORLD_CELLS;
+            int y = cells[next + 1] / CNavGrid::WORLD_CELLS;
+            float length = std::hypot(static_cast<float>(x - anchorX), static_cast<float>(y - anchorY)) * CNavGrid::CELL_SIZE;
+            if (length > MAX_SEGMENT_LENGTH || !isStraightWalkable(anchorX, anchorY, x, y)) {
+                break;
             }
+            next++;
         }
+
+        int x = cells[next] % CNavGrid::WORLD_CELLS;
+        int y = cells[next] / CNavGrid::WORLD_CELLS;
+        float height;
+        getCell(x, y, height);
+        waypoints.emplace_back(CNavGrid::cellCenter(x), CNavGrid::cellCenter(y), height);
+        anchor = next;
+    }
+
+    // The goal cell stands for the requested destination itself
+    if (waypoints.empty()) {
+        waypoints.push_back(to);
+    } else {
+        waypoints.back() = to;
+    }
+    return waypoints;
+}
+
+std::vector<glm::vec3> CPathFinder::findPath(glm::vec3 from, glm::vec3 to) {
+    auto startTime = std::chrono::steady_clock::now();
+    lastStats = {};
+
+    auto config = CApp::getInstance()->getConfig();
+    grid = CApp::getInstance()->getNavGrid();
+    if (!grid || glm::distance(from, to) > config->nav_max_path_distance) {
+        return {};
     }
 
-    // 回溯路径
     std::vector<glm::vec3> path;
-    for (int at = n - 1; at != -1; at = prev[at]) {
-        path.push_back(result[at]);
+    int startX, startY, goalX, goalY;
+    bool snapped = snapToWalkable(from, CNavGrid::REGION_UNKNOWN, startX, startY) &&
+                   snapToWalkable(to, grid->getRegion(startX, startY), goalX, goalY);
+
+    // Cells of different regions are never connected, no need to flood the region of the start
+    if (snapped) {
+        uint32_t startRegion = grid->getRegion(startX, startY);
+        uint32_t goalRegion = grid->getRegion(goalX, goalY);
+        if (startRegion != goalRegion && startRegion != CNavGrid::REGION_UNKNOWN && goalRegion != CNavGrid::REGION_UNKNOWN) {
+            lastStats.differentRegions = true;
+            snapped = false;
+        }
     }
-    std::reverse(path.begin(), path.end());
+
+    if (snapped) {
+        const int32_t goalCell = cellId(goalX, goalY);
+        const size_t maxNodes = static_cast<size_t>(std::max(config->nav_max_search_nodes, 1));
+        // Min-heap on f
+        auto byCost = [](const stOpenEntry& a, const stOpenEntry& b) { return a.f > b.f; };
+
+        stNode& start = findOrInsertNode(cellId(startX, startY));
+        start.g = 0.0f;
+        open.push_back({octile(startX, startY, goalX, goalY) * CNavGrid::CELL_SIZE * HEURISTIC_WEIGHT, 0.0f, start.cell});
+
+        while (!open.empty() && lastStats.expandedNodes < maxNodes) {
+            std::pop_heap(open.begin(), open.end(), byCost);
+            stOpenEntry current = open.back();
+            open.pop_back();
+
+            stNode* node = findNode(current.cell);
+            if (node->closed || current.g > node->g) {
+                continue; // Already expanded through a shorter route
+            }
+            node->closed = true;
+            lastStats.expandedNodes++;
+
+            if (current.cell == goalCell) {
+                lastStats.found = true;
+                break;
+            }
+
+            int x = current.cell % CNavGrid::WORLD_CELLS;
+            int y = current.cell / CNavGrid::WORLD_CELLS;
+            float height;
+            getCell(x, y, height);
+
+            bool passable[4] = {false, false, false, false};
+            for (int d = 0; d < 8; d++) {
+                int nextX = x + DIRECTIONS[d][0];
+                int nextY = y + DIRECTIONS[d][1];
+                float nextHeight;
+                if (d >= 4) {
+                    // Diagonals need both orthogonal neighbours, no squeezing past corners
+                    bool horizontal = passable[DIRECTIONS[d][0] > 0 ? 0 : 1];
+                    bool vertical = passable[DIRECTIONS[d][1] > 0 ? 2 : 3];
+                    if (!horizontal || !vertical) continue;
+                }
+                if (!canStep(x, y, height, nextX, nextY, nextHeight)) {
+                    continue;
+                }
+                if (d < 4) {
+                    passable[d] = true;
+                }
+
+                float g = current.g + (d < 4 ? 1.0f : SQRT2) * CNavGrid::CELL_SIZE;
+                stNode& next = findOrInsertNode(cellId(nextX, nextY));
+                if (next.closed || g >= next.g) {
+                    continue;
+                }
+                next.g = g;
+                next.parent = current.cell;
+                open.push_back({g + octile(nextX, nextY, goalX, goalY) * CNavGrid::CELL_SIZE * HEURISTIC_WEIGHT, g, next.cell});
+                std::push_heap(open.begin(), open.end(), byCost);
+            }
+        }
+
+        if (lastStats.found) {
+            path = buildWaypoints(goalCell, to);
+            float length = 0.0f;
+            glm::vec3 previous = from;
+            for (const auto& waypoint : path) {
+                length += glm::distance(previous, waypoint);
+                previous = waypoint;
+            }
+            lastStats.length = length;
+        }
+    }
+
+    lastStats.tiles = searchTiles.size();
+    lastStats.waypoints = path.size();
+    lastStats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    resetSearch();
     return path;
 }
 
 
-void CPathFinder::findPathAsync(glm::vec3 from, glm::vec3 to, std::function<void(std::vector<glm::vec3>)> callback) {
+CPathFinder::AsyncRequestPtr CPathFinder::findPathAsync(const glm::vec3& from, const glm::vec3& to, Callback callback) {
+    auto pool = CApp::getInstance()->getPathWorkerPool();
+    if (!pool) {
+        return nullptr;
+    }
+    return pool->submit(from, to, std::move(callback));
 }
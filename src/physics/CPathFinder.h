@@ -4,17 +4,97 @@
 
 #ifndef CPATHFINDER_H
 #define CPATHFINDER_H
+#include <atomic>
 #include <vector>
+#include <functional>
+#include <memory>
+#include <unordered_map>
 
 #include "glm/vec3.hpp"
 #include "glm/detail/type_vec4.hpp"
+#include "CNavGrid.h"
 
+// A* over the shared CNavGrid height field. Cells are 8-connected, a move is
+// allowed when the ground height changes by at most a step and diagonal moves
+// do not cut corners. The node table and open list are kept between searches.
 class CPathFinder {
 public:
+    struct stSearchStats {
+        bool found;
+        // Rejected up front, the baked nav file puts start and goal in unconnected regions
+        bool differentRegions;
+        size_t expandedNodes;
+        size_t tiles;
+        size_t waypoints;
+        float length;
+        double milliseconds;
+    };
+
+    using Callback = std::function<void(std::vector<glm::vec3>)>;
+
+    // Handle of a findPathAsync request, the callback is not called once it is cancelled
+    struct stAsyncRequest {
+        std::atomic<bool> cancelled{false};
+
+        void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+        bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+    };
+    using AsyncRequestPtr = std::shared_ptr<stAsyncRequest>;
+
+    // Waypoints from (excluded) to `to` (included), empty if there is no path
     std::vector<glm::vec3> findPath(glm::vec3 from, glm::vec3 to);
-    void findPathAsync(glm::vec3 from, glm::vec3 to, std::function<void(std::vector<glm::vec3>)> callback);
+    // Queues the search on the shared worker pool. The callback runs on a worker
+    // thread. Null when the pool is missing or its queue is full.
+    static AsyncRequestPtr findPathAsync(const glm::vec3& from, const glm::vec3& to, Callback callback);
+
+    const stSearchStats& getLastSearchStats() const { return lastStats; }
+
 private:
+    struct stNode {
+        int32_t cell;   // -1 for a free slot
+        int32_t parent;
+        float g;
+        bool closed;
+    };
+    struct stOpenEntry {
+        float f;
+        float g;
+        int32_t cell;
+    };
+
+    // Inflates the heuristic, paths are at most this much longer than the
+    // shortest one but long searches expand far fewer cells
+    static constexpr float HEURISTIC_WEIGHT = 1.2f;
+    // Start and goal are moved to the closest walkable cell within this many cells
+    static constexpr int SNAP_RADIUS = 4;
+    // ... whose ground is at most this far from the requested z
+    static constexpr float SNAP_MAX_HEIGHT = 3.0f;
+    // Goal cells outside the start's region are only taken if nothing else is close
+    static constexpr float UNREACHABLE_SNAP_PENALTY = 1000.0f;
+    // Straightened segments stay short so the bot follows the terrain
+    static constexpr float MAX_SEGMENT_LENGTH = 30.0f;
+    // Scratch node table slots kept after a search, larger tables are freed
+    static constexpr size_t RETAINED_NODE_SLOTS = 1 << 16;
+
+    CNavGrid* grid = nullptr;
+    std::unordered_map<uint32_t, CNavGrid::TilePtr> searchTiles;
+    uint32_t lastTileKey = UINT32_MAX;
+    const CNavGrid::stTile* lastTile = nullptr;
+
+    std::vector<stNode> nodes;
+    size_t nodeCount = 0;
+    std::vector<stOpenEntry> open;
+    stSearchStats lastStats{};
+
+    bool getCell(int cellX, int cellY, float& height);
+    bool canStep(int fromX, int fromY, float fromHeight, int toX, int toY, float& toHeight);
+    bool snapToWalkable(const glm::vec3& position, uint32_t preferredRegion, int& cellX, int& cellY);
+    bool isStraightWalkable(int fromX, int fromY, int toX, int toY);
 
+    stNode& findOrInsertNode(int32_t cell);
+    stNode* findNode(int32_t cell);
+    void resetSearch();
+    std::vector<glm::vec3> buildWaypoints(int32_t goalCell, const glm::vec3& to);
 };
 
 
@@ -0,0 +1,203 @@
+//
+// CPathWorkerPool - Runs path searches off the LLM and tick threads
+//
+
+#include "CPathWorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "CNavGrid.h"
+#include "core/CLogger.h"
+
+size_t CPathWorkerPool::stKeyHash::operator()(const stKey& key) const {
+    uint64_t cells = (static_cast<uint64_t>(static_cast<uint32_t>(key.fromCell)) << 32) |
+                     static_cast<uint32_t>(key.toCell);
+    uint64_t heights = (static_cast<uint64_t>(static_cast<uint32_t>(key.fromZ)) << 32) |
+                       static_cast<uint32_t>(key.toZ);
+    return std::hash<uint64_t>()(cells ^ (heights * 0x9E3779B97F4A7C15ull));
+}
+
+CPathWorkerPool::CPathWorkerPool(int threads, size_t queueCapacity)
+    : queueCapacity(std::max<size_t>(queueCapacity, 1)) {
+    if (threads <= 0) {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency() / 2));
+    }
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(&CPathWorkerPool::workerLoop, this);
+    }
+    CLogger::getInstance()->system->info("[NAV]: Started {} path worker(s), queue holds {} searches",
+                                         workers.size(), this->queueCapacity);
+}
+
+CPathWorkerPool::~CPathWorkerPool() {
+    stop();
+}
+
+void CPathWorkerPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+        queue.clear();
+        inFlight.clear();
+    }
+    cv.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+// Cells and whole metres, z keeps requests on different floors apart
+CPathWorkerPool::stKey CPathWorkerPool::makeKey(const glm::vec3& from, const glm::vec3& to) {
+    stKey key{-1, -1, static_cast<int32_t>(std::lround(from.z)), static_cast<int32_t>(std::lround(to.z))};
+    int cellX, cellY;
+    if (CNavGrid::toCell(from.x, from.y, cellX, cellY)) {
+        key.fromCell = cellY * CNavGrid::WORLD_CELLS + cellX;
+    }
+    if (CNavGrid::toCell(to.x, to.y, cellX, cellY)) {
+        key.toCell = cellY * CNavGrid::WORLD_CELLS + cellX;
+    }
+    return key;
+}
+
+CPathWorkerPool::RequestPtr CPathWorkerPool::submit(const glm::vec3& from, const glm::vec3& to, Callback callback) {
+    auto request = std::make_shared<CPathFinder::stAsyncRequest>();
+    stKey key = makeKey(from, to);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            return nullptr;
+        }
+
+        auto it = inFlight.find(key);
+        if (it != inFlight.end()) {
+            it->second->waiters.push_back({request, to, std::move(callback)});
+            submitted++;
+            deduplicated++;
+            return request;
+        }
+
+        if (queue.size() >= queueCapacity) {
+            rejected++;
+            return nullptr;
+        }
+
+        auto job = std::make_shared<stJob>();
+        job->key = key;
+        job->from = from;
+        job->to = to;
+        job->waiters.push_back({request, to, std::move(callback)});
+        job->queuedAt = std::chrono::steady_clock::now();
+        inFlight.emplace(key, job);
+        queue.push_back(std::move(job));
+        submitted++;
+        maxQueueDepth = std::max(maxQueueDepth, queue.size());
+    }
+    cv.notify_one();
+    return request;
+}
+
+void CPathWorkerPool::workerLoop() {
+    CPathFinder pathFinder;
+    std::vector<stWaiter> waiters;
+
+    while (true) {
+        std::shared_ptr<stJob> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return !queue.empty() || !running; });
+            if (!running) {
+                return;
+            }
+            job = std::move(queue.front());
+            queue.pop_front();
+
+            // Nobody is waiting for it any more, e.g. every bot got a new order
+            bool wanted = std::any_of(job->waiters.begin(), job->waiters.end(), [](const stWaiter& waiter) {
+                return !waiter.request->isCancelled();
+            });
+            if (!wanted) {
+                inFlight.erase(job->key);
+                cancelled++;
+                continue;
+            }
+        }
+
+        auto startedAt = std::chrono::steady_clock::now();
+        std::vector<glm::vec3> path;
+        try {
+            path = pathFinder.findPath(job->from, job->to);
+        } catch (const std::exception& e) {
+            CLogger::getInstance()->system->error("[NAV]: Path search failed: {}", e.what());
+        }
+
+        // Late joiners are added under the lock, so collect them the same way
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight.erase(job->key);
+            waiters.swap(job->waiters);
+            if (path.empty()) {
+                failed++;
+            } else {
+                completed++;
+            }
+        }
+
+        for (auto& waiter : waiters) {
+            if (waiter.request->isCancelled() || !waiter.callback) {
+                continue;
+            }
+            if (path.empty()) {
+                waiter.callback({});
+                continue;
+            }
+            std::vector<glm::vec3> own = path;
+            own.back() = waiter.to;
+            waiter.callback(std::move(own));
+        }
+        waiters.clear();
+
+        auto finishedAt = std::chrono::steady_clock::now();
+        recordLatency(std::chrono::duration<double, std::milli>(startedAt - job->queuedAt).count(),
+                      std::chrono::duration<double, std::milli>(finishedAt - job->queuedAt).count());
+    }
+}
+
+void CPathWorkerPool::recordLatency(double waitMs, double latencyMs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t samples = completed + failed;
+    if (samples <= 1) {
+        avgWaitMs = waitMs;
+        avgLatencyMs = latencyMs;
+    } else {
+        avgWaitMs += LATENCY_AVG_ALPHA * (waitMs - avgWaitMs);
+        avgLatencyMs += LATENCY_AVG_ALPHA * (latencyMs - avgLatencyMs);
+    }
+    maxWaitMs = std::max(maxWaitMs, waitMs);
+    maxLatencyMs = std::max(maxLatencyMs, latencyMs);
+}
+
+CPathWorkerPool::stStats CPathWorkerPool::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    stStats stats{};
+    stats.workers = workers.size();
+    stats.queueDepth = queue.size();
+    stats.maxQueueDepth = maxQueueDepth;
+    stats.queueCapacity = queueCapacity;
+    stats.submitted = submitted;
+    stats.deduplicated = deduplicated;
+    stats.rejected = rejected;
+    stats.cancelled = cancelled;
+    stats.completed = completed;
+    stats.failed = failed;
+    stats.avgWaitMs = avgWaitMs;
+    stats.maxWaitMs = maxWaitMs;
+    stats.avgLatencyMs = avgLatencyMs;
+    stats.maxLatencyMs = maxLatencyMs;
+    return stats;
+}
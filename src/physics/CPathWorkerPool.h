@@ -0,0 +1,121 @@
+//
+// CPathWorkerPool - Runs path searches off the LLM and tick threads
+//
+
+#ifndef CPATHWORKERPOOL_H
+#define CPATHWORKERPOOL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "CPathFinder.h"
+
+// Fixed set of threads, each with its own CPathFinder so the scratch node
+// tables are reused between searches. Requests for the same start and goal
+// cell that arrive while an earlier one is still queued or running share its
+// search. Callbacks run on the worker thread.
+class CPathWorkerPool {
+public:
+    using Callback = CPathFinder::Callback;
+    using RequestPtr = CPathFinder::AsyncRequestPtr;
+
+    struct stStats {
+        size_t workers;
+        size_t queueDepth;
+        size_t maxQueueDepth;
+        size_t queueCapacity;
+        uint64_t submitted;
+        // Joined a search that was already queued or running
+        uint64_t deduplicated;
+        // Refused because the queue was full
+        uint64_t rejected;
+        // Searches skipped because every requester had cancelled
+        uint64_t cancelled;
+        uint64_t completed;
+        uint64_t failed;
+        // Time spent queued, and from queueing until the result was handed out
+        double avgWaitMs;
+        double maxWaitMs;
+        double avgLatencyMs;
+        double maxLatencyMs;
+    };
+
+    // threads <= 0 uses one thread per two CPU cores
+    CPathWorkerPool(int threads, size_t queueCapacity);
+    ~CPathWorkerPool();
+
+    // Null when the queue is full or the pool is stopped
+    RequestPtr submit(const glm::vec3& from, const glm::vec3& to, Callback callback);
+    // Drops queued searches and joins the workers, called before the collision world goes away
+    void stop();
+
+    stStats getStats() const;
+
+private:
+    struct stKey {
+        int32_t fromCell;
+        int32_t toCell;
+        int32_t fromZ;
+        int32_t toZ;
+
+        bool operator==(const stKey& other) const {
+            return fromCell == other.fromCell && toCell == other.toCell &&
+                   fromZ == other.fromZ && toZ == other.toZ;
+        }
+    };
+    struct stKeyHash {
+        size_t operator()(const stKey& key) const;
+    };
+
+    struct stWaiter {
+        RequestPtr request;
+        // Exact goal of this requester, the shared path ends at the first requester's goal
+        glm::vec3 to;
+        Callback callback;
+    };
+    struct stJob {
+        stKey key;
+        glm::vec3 from;
+        glm::vec3 to;
+        std::vector<stWaiter> waiters;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+    static stKey makeKey(const glm::vec3& from, const glm::vec3& to);
+    void workerLoop();
+    void recordLatency(double waitMs, double latencyMs);
+
+    std::vector<std::thread> workers;
+    size_t queueCapacity;
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    bool running = true;
+    std::deque<std::shared_ptr<stJob>> queue;
+    // Queued and running searches, removed once their callbacks are collected
+    std::unordered_map<stKey, std::shared_ptr<stJob>, stKeyHash> inFlight;
+
+    size_t maxQueueDepth = 0;
+    uint64_t submitted = 0;
+    uint64_t deduplicated = 0;
+    uint64_t rejected = 0;
+    uint64_t cancelled = 0;
+    uint64_t completed = 0;
+    uint64_t failed = 0;
+    double avgWaitMs = 0.0;
+    double maxWaitMs = 0.0;
+    double avgLatencyMs = 0.0;
+    double maxLatencyMs = 0.0;
+
+    // Weight of the newest sample in the moving averages
+    static constexpr double LATENCY_AVG_ALPHA = 0.05;
+};
+
+#endif //CPATHWORKERPOOL_H
@@ -5,24 +5,47 @@
 #include "Raycast.h"
 
 #include <LinearMath/btVector3.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include "spdlog/spdlog.h"
 
 #include "CApp.h"
 #include "vendor/ColAndreas/DynamicWorld.h"
 
+namespace {
+    // Bullet is built without BT_THREADSAFE, so ray tests into the same world
+    // must not overlap. Path workers, bots and bake workers all cast rays, a
+    // lock per world keeps separate worlds running in parallel.
+    std::mutex &worldMutex(ColAndreasWorld *world) {
+        static std::mutex registryMutex;
+        static std::unordered_map<ColAndreasWorld *, std::unique_ptr<std::mutex>> mutexes;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto &mutex = mutexes[world];
+        if (!mutex) {
+            mutex = std::make_unique<std::mutex>();
+        }
+        return *mutex;
+    }
+}
+
 int raycast(const glm::vec3 &from, const glm::vec3 &to, glm::vec3 *result) {
+    auto colAndreas = CApp::getInstance()->getColAndreas();
+    if (!colAndreas) {
+        spdlog::error("ColAndreas instance is null!");
+        return 0;
+    }
+    return raycast(colAndreas, from, to, result);
+}
 
+int raycast(ColAndreasWorld *world, const glm::vec3 &from, const glm::vec3 &to, glm::vec3 *result) {
     btVector3 Start = btVector3(btScalar(from.x + 0.00001), btScalar(from.y + 0.00001), btScalar(from.z + 0.00001));
     btVector3 End = btVector3(btScalar(to.x), btScalar(to.y), btScalar(to.z));
     btVector3 Result;
     int32_t iModel = 0;
 
-    auto colAndreas = CApp::getInstance()->getColAndreas();
-    if (!colAndreas) {
-        spdlog::error("ColAndreas instance is null!");
-        return 0;
-    }
-    if (colAndreas->performRayTest(Start, End, Result, iModel)) {
+    std::lock_guard<std::mutex> lock(worldMutex(world));
+    if (world->performRayTest(Start, End, Result, iModel)) {
         result->x = Result.getX();
         result->y = Result.getY();
         result->z = Result.getZ();
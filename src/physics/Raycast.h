@@ -7,7 +7,11 @@
 
 #include <glm/vec3.hpp>
 
+class ColAndreasWorld;
+
 int raycast(const glm::vec3 &from, const glm::vec3 &to, glm::vec3 *result);
+// Same against a given collision world, for callers that run before CApp is set up
+int raycast(ColAndreasWorld *world, const glm::vec3 &from, const glm::vec3 &to, glm::vec3 *result);
 float raycast_ground_z(float x, float y, float start_z = 1500.0f);
 
 #endif //RAYCAST_H
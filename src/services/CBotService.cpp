@@ -15,6 +15,7 @@
 #include <hv/json.hpp>
 #include "../database/querybuilder.h"
 #include "core/CLLMBotSessionManager.h"
+#include "core/CBotScheduler.h"
 #include "spdlog/spdlog.h"
 #include "core/CLogger.h"
 
@@ -173,8 +174,7 @@ int CBotService::create_bot(HttpRequest* req, HttpResponse* resp) {
         }
         
         // Set server connection details
-        bot->setHost(host);
-        bot->setPort(port);
+        bot->setServer(host, port);
         
         // Insert into database using query builder (handles escaping automatically)
         sql::InsertModel im;
@@ -198,6 +198,7 @@ int CBotService::create_bot(HttpRequest* req, HttpResponse* resp) {
         // Add bot to memory and hash map
         database->vBots.push_back(bot);
         database->botsByUuid[uuid] = bot;
+        CApp::getInstance()->getBotScheduler()->addBot(bot);
         
         // Create LLM session if provider ID is provided
         std::string llm_session_id = "";
@@ -285,7 +286,8 @@ int CBotService::delete_bot(HttpRequest* req, HttpResponse* resp) {
         // Clean up any LLM sessions associated with this bot
         deleteLLMSessionForBot(uuid);
         
-        // Remove from memory and hash map
+        // Remove from scheduler, memory and hash map
+        CApp::getInstance()->getBotScheduler()->removeBot(uuid);
         auto& bots = database->vBots;
         bots.erase(std::remove_if(bots.begin(), bots.end(),
             [&uuid](const std::shared_ptr<CBot>& bot) {
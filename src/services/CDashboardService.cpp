@@ -12,6 +12,8 @@
 #include "../database/DBSchema.h"
 #include "../CApp.h"
 #include "../core/CPersistentDataStorage.h"
+#include "../core/CBotScheduler.h"
+#include "../core/CStreamableCache.h"
 #include "../models/CBot.h"
 #include <hv/json.hpp>
 #include "spdlog/spdlog.h"
@@ -27,6 +29,8 @@ void CDashboardService::on_install(HttpService *router) {
     router->GET(getRelativePath("runtime").c_str(), CDashboardService::get_runtime);
     router->GET(getRelativePath("bot_stats").c_str(), CDashboardService::get_bot_stats);
     router->GET(getRelativePath("server_stats").c_str(), CDashboardService::get_server_stats);
+    router->GET(getRelativePath("scheduler_stats").c_str(), CDashboardService::get_scheduler_stats);
+    router->GET(getRelativePath("memory_stats").c_str(), CDashboardService::get_memory_stats);
 }
 
 int CDashboardService::get_runtime(HttpRequest* req, HttpResponse* resp) {
@@ -155,4 +159,80 @@ int CDashboardService::get_server_stats(HttpRequest* req, HttpResponse* resp) {
         CLogger::getInstance()->api->error("Error in get_server_stats: {}", e.what());
         return resp->Json(JsonResponse::internal_error());
     }
-}
\ No newline at end of file
+}
+
+int CDashboardService::get_scheduler_stats(HttpRequest* req, HttpResponse* resp) {
+    try {
+        auto scheduler = CApp::getInstance()->getBotScheduler();
+        if (!scheduler) {
+            return resp->Json(JsonResponse::internal_error());
+        }
+
+        json shards = json::array();
+        for (const auto& stats : scheduler->getStats()) {
+            shards.push_back({
+                {"shard", stats.shard},
+                {"bots", stats.bots},
+                {"ticks", stats.ticks},
+                {"last_tick_us", stats.last_tick_us},
+                {"avg_tick_us", stats.avg_tick_us},
+                {"max_tick_us", stats.max_tick_us}
+            });
+        }
+
+        json scheduler_stats = {
+            {"shard_count", scheduler->getShardCount()},
+            {"shards", shards}
+        };
+
+        return resp->Json(JsonResponse::with_success(scheduler_stats, "Scheduler statistics retrieved successfully"));
+    } catch (const std::exception& e) {
+        CLogger::getInstance()->api->error("Error in get_scheduler_stats: {}", e.what());
+        return resp->Json(JsonResponse::internal_error());
+    }
+}
+
+int CDashboardService::get_memory_stats(HttpRequest* req, HttpResponse* resp) {
+    try {
+        auto app = CApp::getInstance();
+        auto database = app->getDatabase();
+        auto streamableCache = app->getStreamableCache();
+        if (!database || !streamableCache) {
+            return resp->Json(JsonResponse::internal_error());
+        }
+
+        size_t bots = database->vBots.size();
+        size_t ownBytes = 0, recordBytes = 0;
+        for (const auto& bot : database->vBots) {
+            auto streamables = bot->getStreamableSnapshot();
+            ownBytes += sizeof(CStreamableResourcePool) + streamables->getMemoryUsage();
+            recordBytes += streamables->getRecordBytes();
+        }
+        auto cache = streamableCache->getStats();
+        size_t divisor = bots > 0 ? bots : 1;
+
+        // before: the fixed per-bot arrays, private: every bot owning copies of
+        // what it streamed, after: the bot's own index plus its share of the cache
+        json memory_stats = {
+            {"bots", bots},
+            {"streamable_bytes_per_bot", {
+                {"before", sizeof(CStreamableResourcePool) + CStreamableResourcePool::getFixedLayoutBytes()},
+                {"private", (ownBytes + recordBytes) / divisor},
+                {"after", (ownBytes + cache.bytes) / divisor}
+            }},
+            {"streamable_cache", {
+                {"servers", cache.servers},
+                {"objects", cache.objects},
+                {"pickups", cache.pickups},
+                {"labels", cache.labels},
+                {"texts", cache.texts},
+                {"bytes", cache.bytes}
+            }}
+        };
+
+        return resp->Json(JsonResponse::with_success(memory_stats, "Memory statistics retrieved successfully"));
+    } catch (const std::exception& e) {
+        CLogger::getInstance()->api->error("Error in get_memory_stats: {}", e.what());
+        return resp->Json(JsonResponse::internal_error());
+    }
+}
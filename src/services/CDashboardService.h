@@ -17,6 +17,8 @@ private:
     static int get_runtime(HttpRequest* req, HttpResponse* resp);
     static int get_bot_stats(HttpRequest* req, HttpResponse* resp);
     static int get_server_stats(HttpRequest* req, HttpResponse* resp);
+    static int get_scheduler_stats(HttpRequest* req, HttpResponse* resp);
+    static int get_memory_stats(HttpRequest* req, HttpResponse* resp);
 };
 
 
@@ -1,6 +1,8 @@
 #include "SituationAwarenessTools.h"
+#include "core/CServerSnapshot.h"
 #include <glm/glm.hpp>
 #include <cmath>
+#include <unordered_map>
 
 #include "utils/ObjectNameUtil.h"
 #include "utils/VehicleNameUtil.h"
@@ -23,13 +25,12 @@ std::vector<tool> SituationAwarenessTools::createAllTools() {
 
             float distance = 300.0f;
             glm::vec3 botPos = bot->getPosition();
-            ServerAddress serverAddr = ToolHelpers::getServerAddress(bot);
-
-            auto resourceManager = CApp::getInstance()->getResourceManager();
-            auto vehicles = resourceManager->getVehiclesInRange(serverAddr, botPos, distance);
+            ServerHandle server = ToolHelpers::getServerHandle(bot);
 
+            auto world = CApp::getInstance()->getResourceManager()->getSnapshot(server);
+            auto streamables = bot->getStreamableSnapshot();
             json vehicle_array = json::array();
-            for (const auto& vehicle : vehicles) {
+            world->forEachVehicleInRange(botPos, distance, [&](const stVehicle& vehicle) {
                 json vehicle_element = {
                     {"id", vehicle.id},
                     {"model_id", vehicle.model},
@@ -39,18 +40,18 @@ std::vector<tool> SituationAwarenessTools::createAllTools() {
                     {"health", round_to_two_places(vehicle.health)}
                 };
                 // Get labels attached to this vehicle using O(1) hashmap query
-                auto attachedLabels = bot->getStreamableResources().getLabelsAttachedToVehicle(vehicle.id);
+                auto attachedLabels = streamables->getLabelsAttachedToVehicle(vehicle.id);
                 json label_array = json::array();
 
                 // 只需要提供文字即可
                 for (const auto& label : attachedLabels) {
-                    label_array.push_back(label.text);
+                    label_array.push_back(label.text.str());
                 }
                 if (!label_array.empty())
                     vehicle_element["attached_labels"] = label_array;
 
                 vehicle_array.push_back(vehicle_element);
-            }
+            });
             return ToolHelpers::createSuccess({{"vehicles", vehicle_array}});
         })
         .build(),
@@ -64,13 +65,12 @@ std::vector<tool> SituationAwarenessTools::createAllTools() {
             }
             float distance = 300.0f;
             glm::vec3 botPos = bot->getPosition();
-            ServerAddress serverAddr = ToolHelpers::getServerAddress(bot);
-
-            auto resourceManager = CApp::getInstance()->getResourceManager();
-            auto players = resourceManager->getPlayersInRange(serverAddr, botPos, distance, true);
+            ServerHandle server = ToolHelpers::getServerHandle(bot);
 
+            auto world = CApp::getInstance()->getResourceManager()->getSnapshot(server);
+            auto streamables = bot->getStreamableSnapshot();
             json player_array = json::array();
-            for (const auto& player : players) {
+            world->forEachPlayerInRange(botPos, distance, true, [&](const stPlayer& player) {
                 json player_element = {
                     {"id", player.id},
                     {"name", player.name},
@@ -83,16 +83,16 @@ std::vector<tool> SituationAwarenessTools::createAllTools() {
                     {"is_npc", player.is_npc}
                 };
                 // Get labels attached to this player using O(1) hashmap query
-                auto attachedLabels = bot->getStreamableResources().getLabelsAttachedToPlayer(player.id);
+                auto attachedLabels = streamables->getLabelsAttachedToPlayer(player.id);
                 json label_array = json::array();
                 for (const auto& label : attachedLabels) {
-                    label_array.push_back(label.text);
+                    label_array.push_back(label.text.str());
                 }
                 if (!label_array.empty())
                     player_element["attached_labels"] = label_array;
                 
                 player_array.push_back(player_element);
-            }
+            });
 
             return ToolHelpers::createSuccess({{"players", player_array}});
         })
@@ -108,40 +108,26 @@ std::vector<tool> SituationAwarenessTools::createAllTools() {
 
             float distance = 300.0f;
             glm::vec3 botPos = bot->getPosition();
-            ServerAddress serverAddr = ToolHelpers::getServerAddress(bot);
 
-            auto resourceManager = CApp::getInstance()->getResourceManager();
-            auto objects = bot->getStreamableResources().getObjectsInRange(botPos, distance);
+            auto streamables = bot->getStreamableSnapshot();
 
-            // Sort objects by distance and limit to 100 nearest
-            std::vector<std::pair<float, decltype(objects)::value_type>> objectsWithDistance;
-            for (const auto& obj : objects) {
-                float dist = glm::distance(botPos, obj.position);
-                objectsWithDistance.emplace_back(dist, obj);
-            }
-            
-            std::sort(objectsWithDistance.begin(), objectsWithDistance.end(),
-                     [](const auto& a, const auto& b) { return a.first < b.first; });
-            
-            // Limit to 100 nearest objects
-            size_t maxObjects = std::min(static_cast<size_t>(100), objectsWithDistance.size());
+            // Labels within 2.0 units of each object, joined cell by cell
+            std::unordered_map<int, json> labelsByObject;
+            streamables->forEachLabelNearObjects(botPos, distance, 2.0f, [&](const stObject& obj, const st3DTextLabel& label) {
+                labelsByObject[obj.id].push_back(label.text.str());
+            });
 
+            // Limit to 100 nearest objects
             json object_array = json::array();
-            for (size_t i = 0; i < maxObjects; ++i) {
-                const auto& obj = objectsWithDistance[i].second;
+            for (const auto& obj : streamables->getNearestObjects(botPos, 100, distance)) {
                 // 在AI作为玩家的视角里面，知道obj id没有意义
                 json object_element = {
                     {"model_name", CApp::getInstance()->getObjectNameUtil()->getObjectName(obj.model)},
                     {"position", {{"x", round_to_two_places(obj.position.x)}, {"y", round_to_two_places(obj.position.y)}, {"z", round_to_two_places(obj.position.z)}}}
                 };
-                // Get labels near this object (within 2.0 units) using spatial search
-                auto nearbyLabels = bot->getStreamableResources().getLabelsInRange(obj.position, 2.0f);
-                json label_array = json::array();
-                for (const auto& label : nearbyLabels) {
-                    label_array.push_back(label.text);
-                }
-                if (!label_array.empty())
-                    object_element["attached_labels"] = label_array;
+                auto labels = labelsByObject.find(obj.id);
+                if (labels != labelsByObject.end())
+                    object_element["attached_labels"] = labels->second;
 
                 object_array.push_back(object_element);
             }
@@ -160,10 +146,9 @@ std::vector<tool> SituationAwarenessTools::createAllTools() {
 
             float distance = 300.0f;
             glm::vec3 botPos = bot->getPosition();
-            ServerAddress serverAddr = ToolHelpers::getServerAddress(bot);
 
-            auto resourceManager = CApp::getInstance()->getResourceManager();
-            auto objects = bot->getStreamableResources().getObjectsInRange(botPos, distance);
+            auto streamables = bot->getStreamableSnapshot();
+            auto objects = streamables->getObjectsInRange(botPos, distance);
 
             json object_array = json::array();
             for (const auto& obj : objects) {
@@ -172,7 +157,7 @@ std::vector<tool> SituationAwarenessTools::createAllTools() {
                     object_array.push_back({
                         {"model_name", CApp::getInstance()->getObjectNameUtil()->getObjectName(obj.model)},
                         {"position", {{"x", round_to_two_places(obj.position.x)}, {"y", round_to_two_places(obj.position.y)}, {"z", round_to_two_places(obj.position.z)}}},
-                        {"text", obj.materialText}
+                        {"text", obj.materialText.str()}
                     });
                 }
             }
@@ -190,26 +175,25 @@ std::vector<tool> SituationAwarenessTools::createAllTools() {
 
             float distance = 300.0f;
             glm::vec3 botPos = bot->getPosition();
-            ServerAddress serverAddr = ToolHelpers::getServerAddress(bot);
 
-            auto resourceManager = CApp::getInstance()->getResourceManager();
-            auto pickups = bot->getStreamableResources().getPickupsInRange(bot->getPosition(), distance);
+            auto streamables = bot->getStreamableSnapshot();
+
+            // check nearest labels for 3d space, joined cell by cell
+            std::unordered_map<int, json> labelsByPickup;
+            streamables->forEachLabelNearPickups(botPos, distance, 2.0f, [&](const stMyPickup& pickup, const st3DTextLabel& label) {
+                labelsByPickup[pickup.id].push_back(label.text.str());
+            });
 
             json pickup_array = json::array();
-            for (const auto& pickup : pickups) {
+            for (const auto& pickup : streamables->getPickupsInRange(botPos, distance)) {
                 json pickup_element = {
                     {"id", pickup.id},
                     {"model_name", CApp::getInstance()->getObjectNameUtil()->getObjectName(pickup.model)},
                     {"position", {{"x", round_to_two_places(pickup.position.x)}, {"y", round_to_two_places(pickup.position.y)}, {"z", round_to_two_places(pickup.position.z)}}}
                 };
-                // check nearest labels for 3d space
-                auto labels = bot->getStreamableResources().getLabelsInRangeLinear(pickup.position, 2.0);
-                json label_array = json::array();
-                for (auto& label : labels) {
-                    label_array.push_back(label.text);
-                }
-                if (!label_array.empty())
-                    pickup_element["attached_labels"] = label_array;
+                auto labels = labelsByPickup.find(pickup.id);
+                if (labels != labelsByPickup.end())
+                    pickup_element["attached_labels"] = labels->second;
 
                 pickup_array.push_back(pickup_element);
             }
@@ -227,17 +211,16 @@ std::vector<tool> SituationAwarenessTools::createAllTools() {
 
             float distance = 300.0f;
             glm::vec3 botPos = bot->getPosition();
-            ServerAddress serverAddr = ToolHelpers::getServerAddress(bot);
 
-            auto resourceManager = CApp::getInstance()->getResourceManager();
-            auto labels = bot->getStreamableResources().getLabelsInRange(bot->getPosition(), distance);
+            auto streamables = bot->getStreamableSnapshot();
+            auto labels = streamables->getLabelsInRange(botPos, distance);
 
             json label_array = json::array();
 
             for (const auto& label : labels) {
                 try {
                     // Validate label data before adding to JSON
-                    std::string safe_text = label.text;
+                    std::string safe_text = label.text.str();
                     if (safe_text.empty()) {
                         safe_text = "[empty]";
                     }
@@ -266,12 +249,11 @@ std::vector<tool> SituationAwarenessTools::createAllTools() {
                 return ToolHelpers::createError("Bot not found for session");
             }
             auto npc_included = args.contains("npc_included") ? (bool)args["npc_included"] : false;
-            auto resourceManager = CApp::getInstance()->getResourceManager();
-
-            ServerAddress serverAddr = ToolHelpers::getServerAddress(bot);
-            auto players = resourceManager->getAllPlayer(serverAddr, npc_included);
+            ServerHandle server = ToolHelpers::getServerHandle(bot);
+            auto world = CApp::getInstance()->getResourceManager()->getSnapshot(server);
             json player_array = json::array();
-            for (const auto& player : players) {
+            for (const auto& player : world->getPlayers()) {
+                if (!npc_included && player.is_npc) continue;
                 player_array.push_back({
                     {"id", player.id},
                     {"name", player.name},
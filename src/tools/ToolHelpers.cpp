@@ -9,8 +9,8 @@ CBot* ToolHelpers::getBotBySessionId(const std::string& session_id) {
     return CApp::getInstance()->getLLMSessionManager()->getBotFromLLMSession(session_id);
 }
 
-ServerAddress ToolHelpers::getServerAddress(CBot* bot) {
-    return std::make_pair(bot->getHost(), bot->getPort());
+ServerHandle ToolHelpers::getServerHandle(CBot* bot) {
+    return bot->getServerHandle();
 }
 
 json ToolHelpers::createError(const std::string& message) {
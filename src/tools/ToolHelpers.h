@@ -9,7 +9,7 @@
 class ToolHelpers {
 public:
     static CBot* getBotBySessionId(const std::string& session_id);
-    static ServerAddress getServerAddress(CBot* bot);
+    static ServerHandle getServerHandle(CBot* bot);
     static json createError(const std::string& message);
     static json createSuccess(const json& data = json::object());
 };
\ No newline at end of file
@@ -90,6 +90,7 @@ std::vector<tool> WorldInteractionTools::createAllTools() {
             }
             float radius = args.contains("radius") ? (float)args["radius"] : 1.0f;
             glm::vec3 destination(x, y, z);
+            bot->cancelPathRequest();
             bot->go(destination, type, radius, true, speed, 0.0f, 0);
             return ToolHelpers::createSuccess({{"destination", {{"x", x}, {"y", y}, {"z", z}}}});
         })
@@ -227,7 +228,7 @@ std::vector<tool> WorldInteractionTools::createAllTools() {
             }
 
             int pickupId = args["pickup_id"];
-            float dis = glm::distance(bot->getStreamableResources().getPickupPosition(pickupId), bot->getPosition());
+            float dis = glm::distance(bot->getStreamableSnapshot()->getPickupPosition(pickupId), bot->getPosition());
             if (dis > 3) {
                 return ToolHelpers::createError(fmt::format("Pickup is too far, distance: {:.2f}", dis));
             }
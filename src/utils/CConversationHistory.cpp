@@ -0,0 +1,105 @@
+#include "CConversationHistory.h"
+
+namespace {
+    bool isToolResult(const json& message) {
+        return message.value("role", "") == "tool";
+    }
+}
+
+int CConversationHistory::estimateTokens(const std::string& text) {
+    size_t ascii = 0;
+    int others = 0;
+    for (unsigned char c : text) {
+        if (c < 0x80) {
+            ascii++;
+        } else if ((c & 0xC0) != 0x80) {
+            others++;
+        }
+    }
+    return static_cast<int>((ascii + 3) / 4) + others;
+}
+
+int CConversationHistory::estimateTokens(const json& message) {
+    int result = MESSAGE_OVERHEAD_TOKENS;
+    if (auto content = message.find("content"); content != message.end()) {
+        result += content->is_string() ? estimateTokens(content->get_ref<const std::string&>())
+                                       : estimateTokens(content->dump());
+    }
+    if (auto calls = message.find("tool_calls"); calls != message.end()) {
+        result += estimateTokens(calls->dump());
+    }
+    return result;
+}
+
+std::string CConversationHistory::truncate(const std::string& text, int max_tokens) {
+    if (estimateTokens(text) <= max_tokens) {
+        return text;
+    }
+    size_t length = 0;
+    int tokens = 0;
+    int ascii = 0;
+    while (length < text.size() && tokens < max_tokens) {
+        unsigned char c = static_cast<unsigned char>(text[length]);
+        if (c < 0x80) {
+            if (++ascii == 4) {
+                ascii = 0;
+                tokens++;
+            }
+            length++;
+            continue;
+        }
+        tokens++;
+        length++;
+        while (length < text.size() && (static_cast<unsigned char>(text[length]) & 0xC0) == 0x80) {
+            length++;
+        }
+    }
+    return text.substr(0, length) + "...(truncated " + std::to_string(text.size() - length) + " bytes)";
+}
+
+void CConversationHistory::push(json message, int max_tool_tokens) {
+    if (max_tool_tokens > 0 && isToolResult(message)) {
+        auto content = message.find("content");
+        if (content != message.end() && content->is_string() &&
+            estimateTokens(content->get_ref<const std::string&>()) > max_tool_tokens) {
+            *content = truncate(content->get_ref<const std::string&>(), max_tool_tokens);
+        }
+    }
+
+    int message_tokens = estimateTokens(message);
+    tokens += message_tokens;
+    pushed++;
+    entries.push_back({std::move(message), message_tokens});
+}
+
+std::vector<json> CConversationHistory::trimTo(int token_budget) {
+    std::vector<json> result;
+    while (tokens > token_budget) {
+        size_t turn_end = 1;
+        while (turn_end < entries.size() && isToolResult(entries[turn_end].message)) {
+            turn_end++;
+        }
+        if (turn_end >= entries.size()) {
+            break;
+        }
+        for (size_t i = 0; i < turn_end; i++) {
+            tokens -= entries.front().tokens;
+            result.push_back(std::move(entries.front().message));
+            entries.pop_front();
+            dropped++;
+        }
+    }
+    return result;
+}
+
+void CConversationHistory::clear() {
+    dropped += entries.size();
+    entries.clear();
+    tokens = 0;
+}
+
+void CConversationHistory::appendTo(std::vector<json>& messages) const {
+    for (const auto& entry : entries) {
+        messages.push_back(entry.message);
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include <hv/json.hpp>
+
+using json = nlohmann::json;
+
+// Conversation history of one LLM session, sized in estimated tokens rather
+// than messages. The oldest turns are trimmed first and always as a whole: a
+// turn starts at a user or assistant message and takes the tool results that
+// follow it, so an assistant tool_calls message never loses its tool replies
+// and no tool reply is left without its call.
+class CConversationHistory {
+public:
+    // Appends a message. Tool results above max_tool_tokens are cut down,
+    // 0 keeps them whole.
+    void push(json message, int max_tool_tokens = 0);
+    // Drops the oldest turns until the history fits token_budget, always
+    // keeping the latest turn. Returns the dropped messages, oldest first.
+    std::vector<json> trimTo(int token_budget);
+    void clear();
+
+    void appendTo(std::vector<json>& messages) const;
+    size_t size() const { return entries.size(); }
+    int getTokens() const { return tokens; }
+    // Messages ever pushed and dropped, pushed - dropped is where the history starts
+    uint64_t getPushed() const { return pushed; }
+    uint64_t getDropped() const { return dropped; }
+
+    // Rough count without a tokenizer: about 4 bytes per token for ASCII and
+    // one token per character for anything else, CJK mostly
+    static int estimateTokens(const std::string& text);
+    static int estimateTokens(const json& message);
+    // Cuts text to about max_tokens without splitting a UTF-8 character,
+    // text that already fits comes back unchanged
+    static std::string truncate(const std::string& text, int max_tokens);
+
+private:
+    struct stEntry {
+        json message;
+        int tokens;
+    };
+
+    std::deque<stEntry> entries;
+    int tokens = 0;
+    uint64_t pushed = 0;
+    uint64_t dropped = 0;
+
+    // Role, name and separators every message costs on top of its content
+    static constexpr int MESSAGE_OVERHEAD_TOKENS = 4;
+};
@@ -2,15 +2,17 @@
 #include "../models/CBot.h"
 #include "../CApp.h"
 #include <hv/hlog.h>
+#include <algorithm>
 #include <sstream>
 #include <spdlog/spdlog.h>
 
 #include "core/CLLMBotSessionManager.h"
+#include "core/CConfig.h"
 #include "core/CLogger.h"
 
-CFunctionDispatcher::CFunctionDispatcher() {
-    // No default LLM configuration needed
-    http_client.setTimeout(30);  // Set 30-second timeout
+CFunctionDispatcher::CFunctionDispatcher()
+    : http_pool(static_cast<size_t>(std::max(CApp::getInstance()->getConfig()->llm_max_in_flight, 1)),
+                CApp::getInstance()->getConfig()->llm_request_timeout) {
 }
 
 void CFunctionDispatcher::registerFunction(const std::string& name, 
@@ -25,6 +27,7 @@ void CFunctionDispatcher::registerFunction(const std::string& name,
     def.parameters = parameters;
     
     function_definitions.push_back(def);
+    tools_fragment = createToolsArray().dump();
 }
 
 json CFunctionDispatcher::executeFunction(const std::string& name, const json& arguments, const std::string& session_id) {
@@ -64,6 +67,10 @@ std::vector<FunctionDefinition> CFunctionDispatcher::getFunctionDefinitions() co
     return function_definitions;
 }
 
+std::vector<CLLMHttpPool::stEndpointStats> CFunctionDispatcher::getHttpStats() const {
+    return http_pool.getStats();
+}
+
 
 json CFunctionDispatcher::handleFunctionCalls(const json& llm_response, const std::string& session_id) {
     json result = llm_response;
@@ -110,6 +117,17 @@ json CFunctionDispatcher::createFunctionCallMessage(const json& result) {
     return message;
 }
 
+std::string CFunctionDispatcher::serializeMessages(const std::vector<json>& messages) {
+    std::string result;
+    for (const auto& message : messages) {
+        if (!result.empty()) {
+            result += ',';
+        }
+        result += message.dump();
+    }
+    return result;
+}
+
 json CFunctionDispatcher::createToolsArray() const {
     json tools = json::array();
     
@@ -128,33 +146,48 @@ json CFunctionDispatcher::createToolsArray() const {
     return tools;
 }
 
-void CFunctionDispatcher::callLLMWithFunctionsAsync(const std::vector<json>& messages,
+void CFunctionDispatcher::callLLMWithFunctionsAsync(const std::string& message_prefix,
+                                                    const std::vector<json>& messages,
                                                     std::shared_ptr<CLLMProvider> llmProvider,
+                                                    int reserved_tokens,
                                                     std::function<void(const json&, const std::string&, const json&)> callback,
                                                     const std::string& session_id) {
     if (!llmProvider) {
         callback(json{{"error", "No LLM provider specified"}}, "error", {});
         return;
     }
-    
-    json request_body = {
-        {"model", llmProvider->getModel()},
-        {"messages", messages},
-        {"tools", createToolsArray()}
-    };
+
+    // Assembled by hand so the cached prefix and tools go out byte for byte
+    // as last time, providers only reuse their prompt cache on an exact prefix
+    std::string request_body = "{\"model\":" + json(llmProvider->getModel()).dump() + ",\"messages\":[" + message_prefix;
+    for (const auto& message : messages) {
+        if (!message_prefix.empty() || &message != &messages.front()) {
+            request_body += ',';
+        }
+        request_body += message.dump();
+    }
+    request_body += "],\"tools\":" + (tools_fragment.empty() ? std::string("[]") : tools_fragment);
     if (!function_definitions.empty()) {
-        request_body["tool_choice"] = "auto";
+        request_body += ",\"tool_choice\":\"auto\"";
     }
+    request_body += '}';
 
-    auto req = std::make_shared<HttpRequest>();
-    req->method = HTTP_POST;
-    req->url = llmProvider->getBaseUrl();
-    req->headers["Content-Type"] = "application/json";
-    req->headers["Authorization"] = "Bearer " + llmProvider->getApiKey();
-    req->body = request_body.dump();
+    // Pooled per provider base URL, keeps connections alive between rounds
+    std::string provider_name = llmProvider->getName();
+    http_pool.post(llmProvider, std::move(request_body),
+                   [this, callback, session_id, provider_name, reserved_tokens](const HttpResponsePtr& resp) {
+        json response;
+        std::string parse_error;
+        if (resp && resp->status_code == 200) {
+            try {
+                response = json::parse(resp->body);
+            } catch (const std::exception& e) {
+                parse_error = e.what();
+            }
+        }
+        // Settled before the session check, a session ended mid request still spent its tokens
+        settleRateLimit(provider_name, reserved_tokens, resp, response);
 
-    // Use member HTTP client
-    http_client.sendAsync(req, [this, callback, session_id](const HttpResponsePtr& resp) {
         // Check if session is still active before processing callback
         auto sessionManager = CApp::getInstance()->getLLMSessionManager();
         if (!session_id.empty() && sessionManager && !sessionManager->hasSession(session_id)) {
@@ -169,27 +202,98 @@ void CFunctionDispatcher::callLLMWithFunctionsAsync(const std::vector<json>& mes
         if (resp->status_code != 200) {
             std::stringstream ss;
             ss << "LLM API error: " << resp->status_code << " - " << resp->body;
-            callback(json{{"error", ss.str()}}, "", {});
+            callback(json{{"error", ss.str()}, {"status", resp->status_code}}, "", {});
+            return;
+        }
+        if (!parse_error.empty()) {
+            callback(json{{"error", "Failed to parse LLM response: " + parse_error}}, "", {});
+            return;
+        }
+
+        if (response.contains("choices") && !response["choices"].empty()) {
+            json message = response["choices"][0]["message"];
+            if (message.contains("tool_calls") && !message["tool_calls"].empty()) {
+                json function_results = handleFunctionCalls(response, session_id);
+                // 处理后会产生 function_results
+                callback(response, "function_calls_executed", function_results);
+            } else {
+                callback(response, "message", {});
+            }
+        } else {
+            callback(json{{"error", "Invalid response format from LLM"}}, "", {});
+        }
+    });
+}
+
+void CFunctionDispatcher::callLLMAsync(const std::vector<json>& messages,
+                                       std::shared_ptr<CLLMProvider> llmProvider,
+                                       int max_tokens,
+                                       int reserved_tokens,
+                                       std::function<void(const json&, bool)> callback,
+                                       const std::string& session_id) {
+    if (!llmProvider) {
+        callback(json{{"error", "No LLM provider specified"}}, false);
+        return;
+    }
+
+    json request_body = {
+        {"model", llmProvider->getModel()},
+        {"messages", messages}
+    };
+    if (max_tokens > 0) {
+        request_body["max_tokens"] = max_tokens;
+    }
+
+    std::string provider_name = llmProvider->getName();
+    http_pool.post(llmProvider, request_body.dump(),
+                   [callback, session_id, provider_name, reserved_tokens](const HttpResponsePtr& resp) {
+        json response;
+        std::string parse_error;
+        if (resp && resp->status_code == 200) {
+            try {
+                response = json::parse(resp->body);
+            } catch (const std::exception& e) {
+                parse_error = e.what();
+            }
+        }
+        settleRateLimit(provider_name, reserved_tokens, resp, response);
+
+        auto sessionManager = CApp::getInstance()->getLLMSessionManager();
+        if (!session_id.empty() && sessionManager && !sessionManager->hasSession(session_id)) {
+            return;
+        }
+
+        if (!resp) {
+            callback(json{{"error", "Failed to send request to LLM API"}}, false);
+            return;
+        }
+        if (resp->status_code != 200) {
+            std::stringstream ss;
+            ss << "LLM API error: " << resp->status_code << " - " << resp->body;
+            callback(json{{"error", ss.str()}, {"status", resp->status_code}}, false);
             return;
         }
-        try {
-            json response = json::parse(resp->body);
-
-            if (response.contains("choices") && !response["choices"].empty()) {
-               json message = response["choices"][0]["message"];
-               if (message.contains("tool_calls") && !message["tool_calls"].empty()) {
-                   json function_results = handleFunctionCalls(response, session_id);
-                   // 处理后会产生 function_results
-                   callback(response, "function_calls_executed", function_results);
-               } else {
-                   callback(response, "message", {});
-               }
-           } else {
-               callback(json{{"error", "Invalid response format from LLM"}}, "", {});
-           }
-
-        } catch (const std::exception& e) {
-            callback(json{{"error", "Failed to parse LLM response: " + std::string(e.what())}}, "", {});
+        if (!parse_error.empty()) {
+            callback(json{{"error", "Failed to parse LLM response: " + parse_error}}, false);
+            return;
         }
+        bool has_message = response.contains("choices") && !response["choices"].empty() &&
+                           response["choices"][0].contains("message");
+        callback(response, has_message);
     });
 }
+
+// Corrects the reservation with the usage the provider reported, -1 keeps it
+void CFunctionDispatcher::settleRateLimit(const std::string& provider, int reserved_tokens,
+                                          const HttpResponsePtr& resp, const json& response) {
+    auto sessionManager = CApp::getInstance()->getLLMSessionManager();
+    if (!sessionManager) {
+        return;
+    }
+    int used_tokens = -1;
+    if (response.contains("usage") && response["usage"].is_object()) {
+        used_tokens = response["usage"].value("total_tokens", -1);
+    }
+    sessionManager->getRateLimiter()->release(provider, reserved_tokens, used_tokens,
+                                              resp && resp->status_code == 429);
+}
@@ -2,13 +2,13 @@
 
 #include <hv/json.hpp>
 #include <hv/requests.h>
-#include <hv/HttpClient.h>
 #include <functional>
 #include <map>
 #include <string>
 #include <vector>
 #include <memory>
 #include "../models/CLLMProvider.h"
+#include "CLLMHttpPool.h"
 
 using json = nlohmann::json;
 
@@ -27,7 +27,10 @@ class CFunctionDispatcher {
 private:
     std::map<std::string, std::function<json(const json&, const std::string&)>> registered_functions;
     std::vector<FunctionDefinition> function_definitions;
-    hv::HttpClient http_client;
+    CLLMHttpPool http_pool;
+    // createToolsArray() serialized once per registration, the tools never
+    // change afterwards and must stay byte-identical for prompt caching
+    std::string tools_fragment;
 
 public:
     CFunctionDispatcher();
@@ -41,18 +44,36 @@ public:
     json executeFunction(const std::string& name, const json& arguments, const std::string& session_id = "");
     
     std::vector<FunctionDefinition> getFunctionDefinitions() const;
+    std::vector<CLLMHttpPool::stEndpointStats> getHttpStats() const;
 
 
     // 回调函数： LLM反馈，结果类型，工具结果的上下文信息
-    void callLLMWithFunctionsAsync(const std::vector<json>& messages,
+    // message_prefix is serialized messages joined by commas that go before
+    // `messages`, see serializeMessages(). reserved_tokens were acquired from
+    // the rate limiter and are settled when the response arrives, whether or
+    // not the session is still there to get the callback.
+    void callLLMWithFunctionsAsync(const std::string& message_prefix,
+                                   const std::vector<json>& messages,
                                    std::shared_ptr<CLLMProvider> llmProvider,
+                                   int reserved_tokens,
                                    std::function<void(const json&, const std::string&, const json&)> callback,
                                    const std::string& session_id = "");
     json createFunctionCallMessage(const json& result);
+    static std::string serializeMessages(const std::vector<json>& messages);
+    // Plain completion without tools, the callback gets the parsed response
+    // and whether it carries a message, or the error
+    void callLLMAsync(const std::vector<json>& messages,
+                      std::shared_ptr<CLLMProvider> llmProvider,
+                      int max_tokens,
+                      int reserved_tokens,
+                      std::function<void(const json&, bool)> callback,
+                      const std::string& session_id = "");
 
 
 private:
     // 处理工具，会返回工具结果的上下文信息
     json handleFunctionCalls(const json& llm_response, const std::string& session_id);
     json createToolsArray() const;
+    static void settleRateLimit(const std::string& provider, int reserved_tokens,
+                                const HttpResponsePtr& resp, const json& response);
 };
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "CLLMHttpPool.h"
+
+#include <algorithm>
+
+#include "core/CLogger.h"
+
+CLLMHttpPool::CLLMHttpPool(size_t max_in_flight, int timeout_seconds)
+    : max_in_flight(std::max<size_t>(max_in_flight, 1)), timeout_seconds(timeout_seconds) {
+}
+
+CLLMHttpPool::~CLLMHttpPool() = default;
+
+CLLMHttpPool::stEndpoint* CLLMHttpPool::getEndpoint(const std::string& base_url) {
+    std::lock_guard<std::mutex> lock(endpoints_mutex);
+    auto& endpoint = endpoints[base_url];
+    if (!endpoint) {
+        endpoint = std::make_unique<stEndpoint>();
+        endpoint->base_url = base_url;
+        endpoint->client.setTimeout(timeout_seconds);
+        CLogger::getInstance()->system->info("[LLM]: New connection pool for {} ({} requests in flight)",
+                                             base_url, max_in_flight);
+    }
+    return endpoint.get();
+}
+
+void CLLMHttpPool::post(const std::shared_ptr<CLLMProvider>& provider, std::string body, HttpResponseCallback callback) {
+    auto request = std::make_shared<HttpRequest>();
+    request->method = HTTP_POST;
+    request->url = provider->getBaseUrl();
+    request->timeout = timeout_seconds;
+    request->headers["Content-Type"] = "application/json";
+    request->headers["Authorization"] = "Bearer " + provider->getApiKey();
+    // Keeps the socket in the client's pool once the response is read
+    request->headers["Connection"] = "keep-alive";
+    request->body = std::move(body);
+
+    stEndpoint* endpoint = getEndpoint(request->url);
+    dispatch(endpoint, {std::move(request), std::move(callback), std::chrono::steady_clock::now()});
+}
+
+void CLLMHttpPool::dispatch(stEndpoint* endpoint, stPending pending) {
+    {
+        std::lock_guard<std::mutex> lock(endpoint->mutex);
+        if (endpoint->in_flight >= max_in_flight) {
+            endpoint->queue.push_back(std::move(pending));
+            endpoint->max_queued = std::max(endpoint->max_queued, endpoint->queue.size());
+            return;
+        }
+        endpoint->in_flight++;
+    }
+    send(endpoint, std::move(pending));
+}
+
+void CLLMHttpPool::send(stEndpoint* endpoint, stPending pending) {
+    auto sent_at = std::chrono::steady_clock::now();
+    double queue_ms = std::chrono::duration<double, std::milli>(sent_at - pending.queued_at).count();
+    {
+        std::lock_guard<std::mutex> lock(endpoint->mutex);
+        endpoint->requests++;
+        endpoint->avg_queue_ms = endpoint->requests == 1
+            ? queue_ms
+            : endpoint->avg_queue_ms + LATENCY_AVG_ALPHA * (queue_ms - endpoint->avg_queue_ms);
+    }
+
+    auto callback = std::move(pending.callback);
+    endpoint->client.sendAsync(pending.request,
+        [this, endpoint, callback = std::move(callback), sent_at](const HttpResponsePtr& response) {
+            onResponse(endpoint, response, sent_at);
+            if (callback) {
+                callback(response);
+            }
+        });
+}
+
+// Runs on the endpoint's event loop, frees the slot and sends the next queued request
+void CLLMHttpPool::onResponse(stEndpoint* endpoint, const HttpResponsePtr& response,
+                              std::chrono::steady_clock::time_point sent_at) {
+    double round_trip_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - sent_at).count();
+
+    bool has_next = false;
+    stPending next;
+    {
+        std::lock_guard<std::mutex> lock(endpoint->mutex);
+        if (!response || response->status_code != 200) {
+            endpoint->failures++;
+        }
+        endpoint->responses++;
+        endpoint->avg_round_trip_ms = endpoint->responses == 1
+            ? round_trip_ms
+            : endpoint->avg_round_trip_ms + LATENCY_AVG_ALPHA * (round_trip_ms - endpoint->avg_round_trip_ms);
+        endpoint->max_round_trip_ms = std::max(endpoint->max_round_trip_ms, round_trip_ms);
+
+        size_t bucket = 0;
+        while (bucket < LATENCY_BUCKETS_MS.size() && round_trip_ms > LATENCY_BUCKETS_MS[bucket]) {
+            bucket++;
+        }
+        endpoint->round_trip_buckets[bucket]++;
+
+        if (endpoint->queue.empty()) {
+            endpoint->in_flight--;
+        } else {
+            // The slot passes straight to the next request
+            next = std::move(endpoint->queue.front());
+            endpoint->queue.pop_front();
+            has_next = true;
+        }
+    }
+
+    if (has_next) {
+        send(endpoint, std::move(next));
+    }
+}
+
+std::vector<CLLMHttpPool::stEndpointStats> CLLMHttpPool::getStats() const {
+    std::vector<stEndpointStats> result;
+    std::lock_guard<std::mutex> lock(endpoints_mutex);
+    result.reserve(endpoints.size());
+    for (const auto& [base_url, endpoint] : endpoints) {
+        std::lock_guard<std::mutex> endpoint_lock(endpoint->mutex);
+        stEndpointStats stats{};
+        stats.base_url = base_url;
+        stats.in_flight = endpoint->in_flight;
+        stats.queued = endpoint->queue.size();
+        stats.max_queued = endpoint->max_queued;
+        stats.requests = endpoint->requests;
+        stats.failures = endpoint->failures;
+        stats.avg_queue_ms = endpoint->avg_queue_ms;
+        stats.avg_round_trip_ms = endpoint->avg_round_trip_ms;
+        stats.max_round_trip_ms = endpoint->max_round_trip_ms;
+        stats.round_trip_buckets = endpoint->round_trip_buckets;
+        result.push_back(std::move(stats));
+    }
+    return result;
+}
+
+double CLLMHttpPool::percentile(const stEndpointStats& stats, double fraction) {
+    uint64_t total = 0;
+    for (auto count : stats.round_trip_buckets) {
+        total += count;
+    }
+    if (total == 0) {
+        return 0.0;
+    }
+
+    uint64_t target = static_cast<uint64_t>(fraction * static_cast<double>(total));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS_MS.size(); i++) {
+        seen += stats.round_trip_buckets[i];
+        if (seen > target) {
+            return LATENCY_BUCKETS_MS[i];
+        }
+    }
+    return stats.max_round_trip_ms;
+}
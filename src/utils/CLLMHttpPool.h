@@ -0,0 +1,97 @@
+#pragma once
+
+#include <hv/HttpClient.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../models/CLLMProvider.h"
+
+// Keep-alive HTTP clients for the LLM providers, one per base URL.
+//
+// Every endpoint has its own hv::HttpClient, so its own event loop and its
+// own pool of idle connections; requests to one provider reuse warm TCP/TLS
+// connections instead of paying the handshake every round, and a slow
+// provider does not hold up the callbacks of another. At most
+// max_in_flight requests are on the wire per endpoint, the rest wait in a
+// FIFO and go out as responses come back.
+class CLLMHttpPool {
+public:
+    // Upper bounds of the latency histogram buckets in milliseconds, the last bucket is unbounded
+    static constexpr std::array<int, 9> LATENCY_BUCKETS_MS = {100, 250, 500, 1000, 2000, 4000, 8000, 16000, 32000};
+    static constexpr size_t BUCKET_COUNT = LATENCY_BUCKETS_MS.size() + 1;
+
+    struct stEndpointStats {
+        std::string base_url;
+        size_t in_flight;
+        size_t queued;
+        size_t max_queued;
+        uint64_t requests;
+        uint64_t failures;
+        double avg_queue_ms;
+        double avg_round_trip_ms;
+        double max_round_trip_ms;
+        // Round trips (send to response) per LATENCY_BUCKETS_MS bucket
+        std::array<uint64_t, BUCKET_COUNT> round_trip_buckets;
+    };
+
+    CLLMHttpPool(size_t max_in_flight, int timeout_seconds);
+    ~CLLMHttpPool();
+
+    // POSTs a JSON body to the provider's base URL. The callback runs on the
+    // endpoint's event loop thread, with a null response on network errors.
+    void post(const std::shared_ptr<CLLMProvider>& provider, std::string body, HttpResponseCallback callback);
+
+    std::vector<stEndpointStats> getStats() const;
+
+    // Round trip in milliseconds below which `fraction` (0..1) of the requests
+    // finished, the upper bound of the histogram bucket it falls in
+    static double percentile(const stEndpointStats& stats, double fraction);
+
+private:
+    struct stPending {
+        HttpRequestPtr request;
+        HttpResponseCallback callback;
+        std::chrono::steady_clock::time_point queued_at;
+    };
+
+    struct stEndpoint {
+        std::string base_url;
+
+        std::mutex mutex;
+        size_t in_flight = 0;
+        std::deque<stPending> queue;
+        size_t max_queued = 0;
+        uint64_t requests = 0;
+        uint64_t responses = 0;
+        uint64_t failures = 0;
+        double avg_queue_ms = 0.0;
+        double avg_round_trip_ms = 0.0;
+        double max_round_trip_ms = 0.0;
+        std::array<uint64_t, BUCKET_COUNT> round_trip_buckets{};
+
+        // Declared last so its event loop is stopped before the state above goes away
+        hv::HttpClient client;
+    };
+
+    stEndpoint* getEndpoint(const std::string& base_url);
+    void dispatch(stEndpoint* endpoint, stPending pending);
+    void send(stEndpoint* endpoint, stPending pending);
+    void onResponse(stEndpoint* endpoint, const HttpResponsePtr& response,
+                    std::chrono::steady_clock::time_point sent_at);
+
+    size_t max_in_flight;
+    int timeout_seconds;
+
+    mutable std::mutex endpoints_mutex;
+    std::unordered_map<std::string, std::unique_ptr<stEndpoint>> endpoints;
+
+    // Weight of the newest sample in the moving averages
+    static constexpr double LATENCY_AVG_ALPHA = 0.1;
+};
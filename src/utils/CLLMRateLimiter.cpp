@@ -0,0 +1,133 @@
+#include "CLLMRateLimiter.h"
+
+#include <algorithm>
+
+void CLLMRateLimiter::stBucket::refill(double seconds) {
+    if (capacity > 0.0) {
+        available = std::min(capacity, available + seconds * per_second);
+    }
+}
+
+// A full bucket always grants, so a request larger than the whole per
+// minute budget still goes out once instead of waiting forever
+bool CLLMRateLimiter::stBucket::has(double amount) const {
+    return capacity <= 0.0 || available >= amount || available >= capacity;
+}
+
+namespace {
+    int limitFor(const std::map<std::string, int>& overrides, const std::string& provider, int fallback) {
+        auto it = overrides.find(provider);
+        return std::max(it != overrides.end() ? it->second : fallback, 0);
+    }
+}
+
+CLLMRateLimiter::CLLMRateLimiter(int requests_per_minute, int tokens_per_minute,
+                                 std::map<std::string, int> provider_requests_per_minute,
+                                 std::map<std::string, int> provider_tokens_per_minute)
+    : requests_per_minute(std::max(requests_per_minute, 0)), tokens_per_minute(std::max(tokens_per_minute, 0)),
+      provider_requests_per_minute(std::move(provider_requests_per_minute)),
+      provider_tokens_per_minute(std::move(provider_tokens_per_minute)) {
+}
+
+CLLMRateLimiter::stProvider& CLLMRateLimiter::getProvider(const std::string& provider, Clock::time_point now) {
+    auto it = providers.find(provider);
+    if (it == providers.end()) {
+        int rpm = limitFor(provider_requests_per_minute, provider, requests_per_minute);
+        int tpm = limitFor(provider_tokens_per_minute, provider, tokens_per_minute);
+        stProvider state;
+        state.requests.capacity = state.requests.available = rpm;
+        state.requests.per_second = rpm / 60.0;
+        state.tokens.capacity = state.tokens.available = tpm;
+        state.tokens.per_second = tpm / 60.0;
+        state.last_refill = now;
+        it = providers.emplace(provider, state).first;
+    }
+
+    auto& state = it->second;
+    double seconds = std::chrono::duration<double>(now - state.last_refill).count();
+    state.requests.refill(seconds);
+    state.tokens.refill(seconds);
+    state.last_refill = now;
+    return state;
+}
+
+bool CLLMRateLimiter::tryAcquire(const std::string& provider, int tokens) {
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& state = getProvider(provider, now);
+
+    if (now < state.blocked_until || !state.requests.has(1.0) || !state.tokens.has(tokens)) {
+        state.throttled++;
+        return false;
+    }
+    if (state.requests.capacity > 0.0) {
+        state.requests.available -= 1.0;
+    }
+    if (state.tokens.capacity > 0.0) {
+        state.tokens.available -= tokens;
+    }
+    state.granted++;
+    return true;
+}
+
+void CLLMRateLimiter::release(const std::string& provider, int reserved_tokens, int used_tokens, bool rate_limited) {
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& state = getProvider(provider, now);
+
+    if (used_tokens >= 0 && state.tokens.capacity > 0.0) {
+        state.tokens.available = std::min(state.tokens.capacity,
+                                          state.tokens.available + reserved_tokens - used_tokens);
+    }
+
+    if (rate_limited) {
+        state.rate_limited++;
+        state.backoff = std::min(MAX_BACKOFF, std::max(MIN_BACKOFF, state.backoff * 2));
+        state.blocked_until = now + state.backoff;
+    } else {
+        state.backoff = std::chrono::milliseconds(0);
+    }
+}
+
+void CLLMRateLimiter::cancel(const std::string& provider, int reserved_tokens) {
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& state = getProvider(provider, now);
+
+    if (state.requests.capacity > 0.0) {
+        state.requests.available = std::min(state.requests.capacity, state.requests.available + 1.0);
+    }
+    if (state.tokens.capacity > 0.0) {
+        state.tokens.available = std::min(state.tokens.capacity, state.tokens.available + reserved_tokens);
+    }
+    if (state.granted > 0) {
+        state.granted--;
+    }
+}
+
+std::vector<CLLMRateLimiter::stProviderStats> CLLMRateLimiter::getStats() const {
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<stProviderStats> result;
+    result.reserve(providers.size());
+    for (const auto& [name, state] : providers) {
+        double seconds = std::chrono::duration<double>(now - state.last_refill).count();
+        stBucket requests = state.requests;
+        stBucket tokens = state.tokens;
+        requests.refill(seconds);
+        tokens.refill(seconds);
+
+        stProviderStats stats{};
+        stats.provider = name;
+        stats.requests_available = requests.capacity > 0.0 ? requests.available : -1.0;
+        stats.tokens_available = tokens.capacity > 0.0 ? tokens.available : -1.0;
+        stats.blocked_seconds = now < state.blocked_until
+            ? std::chrono::duration<double>(state.blocked_until - now).count()
+            : 0.0;
+        stats.granted = state.granted;
+        stats.throttled = state.throttled;
+        stats.rate_limited = state.rate_limited;
+        result.push_back(std::move(stats));
+    }
+    return result;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Token buckets per LLM provider, one for requests per minute and one for
+// tokens per minute. A limit of 0 leaves that bucket unlimited. Tokens are
+// reserved from an estimate when a request is sent and corrected with the
+// usage reported in the response. A 429 from the provider blocks it for a
+// backoff that doubles on every further 429 and resets on the next success.
+// Providers without an override share the default limits.
+class CLLMRateLimiter {
+public:
+    struct stProviderStats {
+        std::string provider;
+        // -1 for an unlimited bucket
+        double requests_available;
+        double tokens_available;
+        double blocked_seconds;
+        uint64_t granted;
+        uint64_t throttled;
+        uint64_t rate_limited;
+    };
+
+    CLLMRateLimiter(int requests_per_minute, int tokens_per_minute,
+                    std::map<std::string, int> provider_requests_per_minute = {},
+                    std::map<std::string, int> provider_tokens_per_minute = {});
+
+    // Takes one request and `tokens` from the provider's buckets, false if
+    // either runs short or the provider is backing off
+    bool tryAcquire(const std::string& provider, int tokens);
+    // Settles a request once it is answered. `used_tokens` < 0 keeps the
+    // reservation as it was.
+    void release(const std::string& provider, int reserved_tokens, int used_tokens, bool rate_limited);
+    // Hands back the request and tokens of an acquire whose request was never sent
+    void cancel(const std::string& provider, int reserved_tokens);
+
+    std::vector<stProviderStats> getStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct stBucket {
+        double capacity = 0.0;  // 0 = unlimited
+        double available = 0.0;
+        double per_second = 0.0;
+
+        void refill(double seconds);
+        bool has(double amount) const;
+    };
+
+    struct stProvider {
+        stBucket requests;
+        stBucket tokens;
+        Clock::time_point last_refill;
+        Clock::time_point blocked_until;
+        std::chrono::milliseconds backoff{0};
+        uint64_t granted = 0;
+        uint64_t throttled = 0;
+        uint64_t rate_limited = 0;
+    };
+
+    stProvider& getProvider(const std::string& provider, Clock::time_point now);
+
+    int requests_per_minute;
+    int tokens_per_minute;
+    std::map<std::string, int> provider_requests_per_minute;
+    std::map<std::string, int> provider_tokens_per_minute;
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, stProvider> providers;
+
+    static constexpr std::chrono::milliseconds MIN_BACKOFF{5000};
+    static constexpr std::chrono::milliseconds MAX_BACKOFF{60000};
+};
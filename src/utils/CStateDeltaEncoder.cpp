@@ -0,0 +1,158 @@
+#include "CStateDeltaEncoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+    // Reported every round they occur, never part of the baseline
+    const char* const EVENT_KEYS[] = {"new_chat_message", "important_events"};
+
+    bool isEventKey(const std::string& key) {
+        return std::find(std::begin(EVENT_KEYS), std::end(EVENT_KEYS), key) != std::end(EVENT_KEYS);
+    }
+
+    float number(const json& object, const char* key) {
+        auto it = object.find(key);
+        return it != object.end() && it->is_number() ? it->get<float>() : 0.0f;
+    }
+}
+
+CStateDeltaEncoder::CStateDeltaEncoder(int keyframe_interval)
+    : keyframe_interval(std::max(keyframe_interval, 1)), rounds_since_keyframe(0), has_baseline(false),
+      pending_keyframe(false) {
+}
+
+void CStateDeltaEncoder::reset() {
+    has_baseline = false;
+    baseline = json();
+    pending_baseline = json();
+    rounds_since_keyframe = 0;
+}
+
+bool CStateDeltaEncoder::movedFar(const json& from, const json& to) {
+    float dx = number(to, "x") - number(from, "x");
+    float dy = number(to, "y") - number(from, "y");
+    float dz = number(to, "z") - number(from, "z");
+    return dx * dx + dy * dy + dz * dz > POSITION_EPSILON * POSITION_EPSILON;
+}
+
+std::string CStateDeltaEncoder::encode(const json& state, bool force_keyframe) {
+    std::string full = state.dump();
+    std::string sent;
+
+    pending_keyframe = force_keyframe || !has_baseline || rounds_since_keyframe + 1 >= keyframe_interval;
+    if (pending_keyframe) {
+        json message = {{"keyframe", true}};
+        message.update(state);
+        sent = message.dump();
+        pending_baseline = state;
+        stats.keyframes++;
+    } else {
+        sent = diff(state).dump();
+    }
+    for (const char* key : EVENT_KEYS) {
+        pending_baseline.erase(key);
+    }
+
+    stats.rounds++;
+    stats.full_bytes += full.size();
+    stats.sent_bytes += sent.size();
+    return sent;
+}
+
+// Builds the delta message and the baseline the LLM will know once it is acknowledged
+json CStateDeltaEncoder::diff(const json& state) {
+    json delta = {{"delta", true}};
+    pending_baseline = baseline;
+
+    for (const auto& [key, value] : state.items()) {
+        if (isEventKey(key)) {
+            if (!value.empty()) {
+                delta[key] = value;
+            }
+            continue;
+        }
+        if (key == "streamed_players") {
+            continue;
+        }
+
+        auto previous = baseline.find(key);
+        bool changed = previous == baseline.end() || *previous != value;
+        if (changed && key == "position" && previous != baseline.end() && previous->is_object()) {
+            // Small steps are not worth a line, the zone changing always is
+            changed = movedFar(*previous, value) || previous->value("zone", json()) != value.value("zone", json());
+        }
+        if (changed) {
+            delta[key] = value;
+            pending_baseline[key] = value;
+        }
+    }
+    if (!state.contains("dialog")) {
+        pending_baseline.erase("dialog");
+    }
+
+    // Players are matched by name
+    std::unordered_map<std::string, const json*> known;
+    if (auto players = baseline.find("streamed_players"); players != baseline.end() && players->is_array()) {
+        for (const auto& player : *players) {
+            known.emplace(player.value("name", ""), &player);
+        }
+    }
+
+    json entered = json::array();
+    json moved = json::array();
+    json current = json::array();
+    if (auto players = state.find("streamed_players"); players != state.end() && players->is_array()) {
+        for (const auto& player : *players) {
+            std::string name = player.value("name", "");
+            auto it = known.find(name);
+            if (it == known.end()) {
+                entered.push_back(player);
+                current.push_back(player);
+                continue;
+            }
+
+            const json& previous = *it->second;
+            bool stateChanged = previous.value("health", json()) != player.value("health", json()) ||
+                                previous.value("weapon", json()) != player.value("weapon", json());
+            if (stateChanged || movedFar(previous, player)) {
+                moved.push_back(player);
+                current.push_back(player);
+            } else {
+                // Keep what the LLM was told so slow drift still adds up to a report
+                current.push_back(previous);
+            }
+            known.erase(it);
+        }
+    }
+
+    json left = json::array();
+    for (const auto& [name, player] : known) {
+        left.push_back(name);
+    }
+
+    if (!entered.empty()) delta["players_entered"] = std::move(entered);
+    if (!left.empty()) delta["players_left"] = std::move(left);
+    if (!moved.empty()) delta["players_moved"] = std::move(moved);
+    pending_baseline["streamed_players"] = std::move(current);
+
+    if (delta.size() == 1) {
+        delta["unchanged"] = true;
+    }
+    return delta;
+}
+
+void CStateDeltaEncoder::acknowledge() {
+    if (pending_baseline.is_null()) {
+        return;
+    }
+    baseline = std::move(pending_baseline);
+    pending_baseline = json();
+    has_baseline = true;
+    rounds_since_keyframe = pending_keyframe ? 0 : rounds_since_keyframe + 1;
+}
+
+void CStateDeltaEncoder::reject() {
+    pending_baseline = json();
+}
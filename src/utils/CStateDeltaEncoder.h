@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <hv/json.hpp>
+
+using json = nlohmann::json;
+
+// Turns the bot state of every round into a user message for the LLM. Most
+// rounds only carry what changed since the state the LLM has already seen:
+// players entering or leaving, players or the bot moving more than a few
+// metres, changed values, new chat and events. Every few rounds, or when the
+// last full state may have left the conversation, a full keyframe is sent.
+//
+// The baseline only moves forward once a round is acknowledged, a failed
+// round is diffed again against the last state that got an answer.
+class CStateDeltaEncoder {
+public:
+    struct stStats {
+        uint64_t rounds = 0;
+        uint64_t keyframes = 0;
+        // Bytes the full states would have taken and the bytes actually sent
+        uint64_t full_bytes = 0;
+        uint64_t sent_bytes = 0;
+    };
+
+    explicit CStateDeltaEncoder(int keyframe_interval);
+
+    // Serialized message content for this round's state
+    std::string encode(const json& state, bool force_keyframe);
+    // Whether the last encode() produced a keyframe
+    bool wasKeyframe() const { return pending_keyframe; }
+    void acknowledge();
+    void reject();
+    void reset();
+
+    const stStats& getStats() const { return stats; }
+    // Rough estimate used for the token counters, about 4 bytes per token for JSON
+    static uint64_t estimateTokens(uint64_t bytes) { return (bytes + 3) / 4; }
+
+    // Bot or player movement below this is not reported
+    static constexpr float POSITION_EPSILON = 2.0f;
+
+private:
+    json diff(const json& state);
+    static bool movedFar(const json& from, const json& to);
+
+    int keyframe_interval;
+    int rounds_since_keyframe;
+    bool has_baseline;
+    // What the LLM knows: the last acknowledged keyframe with the acknowledged deltas applied
+    json baseline;
+    json pending_baseline;
+    bool pending_keyframe;
+    stStats stats;
+};
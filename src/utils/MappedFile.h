@@ -0,0 +1,37 @@
+//
+// Read-only memory mapping of a whole file
+//
+
+#ifndef BOTMASTERXL_MAPPEDFILE_H
+#define BOTMASTERXL_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// Maps a file read-only into the address space. Pages are shared with every
+// other mapping of the same file and only loaded when first touched.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return mapping != nullptr; }
+    const unsigned char* data() const { return static_cast<const unsigned char*>(mapping); }
+    size_t size() const { return length; }
+
+private:
+    void* mapping = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+#endif //BOTMASTERXL_MAPPEDFILE_H
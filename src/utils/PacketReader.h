@@ -0,0 +1,60 @@
+//
+// PacketReader - Non-owning reader over raw RakNet packet data
+//
+
+#ifndef PACKETREADER_H
+#define PACKETREADER_H
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+// Reads byte aligned fields straight out of Packet::data without allocating
+// like RakNet::BitStream does. read() fails when the packet is too short,
+// readOrZero() leaves a zeroed value behind like a failed BitStream::Read
+// into a value-initialised struct. Sync packets are byte aligned and use the
+// native byte order (__BITSTREAM_NATIVE_END), so a plain memcpy matches
+// BitStream::Read.
+class PacketReader {
+public:
+    PacketReader(const unsigned char* data, size_t length) : data(data), length(length), offset(0) {}
+
+    template <typename T>
+    bool read(T& out) {
+        static_assert(std::is_trivially_copyable<T>::value, "PacketReader only reads trivially copyable types");
+        if (remaining() < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&out, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    // All or nothing like BitStream::Read: a struct that does not fit is
+    // left zeroed and nothing is consumed. Returns whether it was read.
+    template <typename T>
+    bool readOrZero(T& out) {
+        if (read(out)) {
+            return true;
+        }
+        std::memset(&out, 0, sizeof(T));
+        return false;
+    }
+
+    bool skip(size_t bytes) {
+        if (remaining() < bytes) {
+            return false;
+        }
+        offset += bytes;
+        return true;
+    }
+
+    size_t remaining() const { return length - offset; }
+
+private:
+    const unsigned char* data;
+    size_t length;
+    size_t offset;
+};
+
+#endif //PACKETREADER_H
@@ -0,0 +1,107 @@
+//
+// Vectorized distance filter over structure-of-arrays positions
+//
+
+#include "RangeFilter.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    inline bool within(const float* xs, const float* ys, const float* zs, size_t i,
+                       float cx, float cy, float cz, float rangeSq) {
+        float dx = xs[i] - cx;
+        float dy = ys[i] - cy;
+        float dz = zs[i] - cz;
+        return dx * dx + dy * dy + dz * dz <= rangeSq;
+    }
+
+    // Returns a bit mask of the lanes within range for the block starting at i
+#if defined(__AVX__)
+    constexpr size_t LANES = 8;
+
+    inline int blockMask(const float* xs, const float* ys, const float* zs, size_t i,
+                         __m256 cx, __m256 cy, __m256 cz, __m256 rangeSq) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(xs + i), cx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(ys + i), cy);
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(zs + i), cz);
+        __m256 distSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                      _mm256_mul_ps(dz, dz));
+        return _mm256_movemask_ps(_mm256_cmp_ps(distSq, rangeSq, _CMP_LE_OQ));
+    }
+#elif defined(__SSE2__)
+    constexpr size_t LANES = 4;
+
+    inline int blockMask(const float* xs, const float* ys, const float* zs, size_t i,
+                         __m128 cx, __m128 cy, __m128 cz, __m128 rangeSq) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), cx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i), cy);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(zs + i), cz);
+        __m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        return _mm_movemask_ps(_mm_cmple_ps(distSq, rangeSq));
+    }
+#endif
+}
+
+size_t RangeFilter::inRange(const float* xs, const float* ys, const float* zs, size_t count,
+                            float cx, float cy, float cz, float rangeSq, uint16_t* out) {
+    size_t found = 0;
+    size_t i = 0;
+
+#if defined(__AVX__)
+    __m256 vcx = _mm256_set1_ps(cx), vcy = _mm256_set1_ps(cy), vcz = _mm256_set1_ps(cz);
+    __m256 vrange = _mm256_set1_ps(rangeSq);
+#elif defined(__SSE2__)
+    __m128 vcx = _mm_set1_ps(cx), vcy = _mm_set1_ps(cy), vcz = _mm_set1_ps(cz);
+    __m128 vrange = _mm_set1_ps(rangeSq);
+#endif
+
+#if defined(__AVX__) || defined(__SSE2__)
+    for (; i + LANES <= count; i += LANES) {
+        int mask = blockMask(xs, ys, zs, i, vcx, vcy, vcz, vrange);
+        // Most blocks are entirely out of range
+        while (mask) {
+            int lane = __builtin_ctz(mask);
+            out[found++] = static_cast<uint16_t>(i + lane);
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        if (within(xs, ys, zs, i, cx, cy, cz, rangeSq)) {
+            out[found++] = static_cast<uint16_t>(i);
+        }
+    }
+    return found;
+}
+
+size_t RangeFilter::countInRange(const float* xs, const float* ys, const float* zs, size_t count,
+                                 float cx, float cy, float cz, float rangeSq) {
+    size_t found = 0;
+    size_t i = 0;
+
+#if defined(__AVX__)
+    __m256 vcx = _mm256_set1_ps(cx), vcy = _mm256_set1_ps(cy), vcz = _mm256_set1_ps(cz);
+    __m256 vrange = _mm256_set1_ps(rangeSq);
+#elif defined(__SSE2__)
+    __m128 vcx = _mm_set1_ps(cx), vcy = _mm_set1_ps(cy), vcz = _mm_set1_ps(cz);
+    __m128 vrange = _mm_set1_ps(rangeSq);
+#endif
+
+#if defined(__AVX__) || defined(__SSE2__)
+    for (; i + LANES <= count; i += LANES) {
+        found += __builtin_popcount(blockMask(xs, ys, zs, i, vcx, vcy, vcz, vrange));
+    }
+#endif
+
+    for (; i < count; i++) {
+        if (within(xs, ys, zs, i, cx, cy, cz, rangeSq)) {
+            found++;
+        }
+    }
+    return found;
+}
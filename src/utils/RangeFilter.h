@@ -0,0 +1,24 @@
+//
+// Vectorized distance filter over structure-of-arrays positions
+//
+
+#ifndef BOTMASTERXL_RANGEFILTER_H
+#define BOTMASTERXL_RANGEFILTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace RangeFilter {
+    // Writes the index of every point within sqrt(rangeSq) of (cx, cy, cz) to
+    // `out` in ascending order and returns how many were written. `out` must
+    // have room for `count` entries. Uses AVX when the build enables it, SSE2
+    // on every other x86-64 target and a scalar loop elsewhere.
+    size_t inRange(const float* xs, const float* ys, const float* zs, size_t count,
+                   float cx, float cy, float cz, float rangeSq, uint16_t* out);
+
+    // Same test without collecting indices
+    size_t countInRange(const float* xs, const float* ys, const float* zs, size_t count,
+                        float cx, float cy, float cz, float rangeSq);
+}
+
+#endif //BOTMASTERXL_RANGEFILTER_H
@@ -0,0 +1,60 @@
+//
+// Reader/writer lock that does not starve writers
+//
+
+#ifndef BOTMASTERXL_SHAREDMUTEX_H
+#define BOTMASTERXL_SHAREDMUTEX_H
+
+#if defined(__GLIBC__)
+#include <pthread.h>
+#else
+#include <shared_mutex>
+#endif
+
+// Drop-in for std::shared_mutex (works with std::unique_lock / std::shared_lock).
+// glibc's default rwlock, which backs std::shared_mutex, lets a steady stream of
+// readers hold off a writer indefinitely. Here a waiting writer blocks new
+// readers, so the network threads applying sync data always get through.
+// A thread must not take the shared lock recursively while a writer waits.
+class SharedMutex {
+public:
+#if defined(__GLIBC__)
+    SharedMutex() {
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+        pthread_rwlock_init(&rwlock, &attr);
+        pthread_rwlockattr_destroy(&attr);
+    }
+    ~SharedMutex() { pthread_rwlock_destroy(&rwlock); }
+
+    void lock() { pthread_rwlock_wrlock(&rwlock); }
+    bool try_lock() { return pthread_rwlock_trywrlock(&rwlock) == 0; }
+    void unlock() { pthread_rwlock_unlock(&rwlock); }
+
+    void lock_shared() { pthread_rwlock_rdlock(&rwlock); }
+    bool try_lock_shared() { return pthread_rwlock_tryrdlock(&rwlock) == 0; }
+    void unlock_shared() { pthread_rwlock_unlock(&rwlock); }
+#else
+    // SRW locks (Windows) and libc++ already keep writers from starving
+    void lock() { mutex.lock(); }
+    bool try_lock() { return mutex.try_lock(); }
+    void unlock() { mutex.unlock(); }
+
+    void lock_shared() { mutex.lock_shared(); }
+    bool try_lock_shared() { return mutex.try_lock_shared(); }
+    void unlock_shared() { mutex.unlock_shared(); }
+#endif
+
+    SharedMutex(const SharedMutex&) = delete;
+    SharedMutex& operator=(const SharedMutex&) = delete;
+
+private:
+#if defined(__GLIBC__)
+    pthread_rwlock_t rwlock;
+#else
+    std::shared_mutex mutex;
+#endif
+};
+
+#endif //BOTMASTERXL_SHAREDMUTEX_H
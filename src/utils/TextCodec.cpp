@@ -0,0 +1,259 @@
+//
+// Table driven GBK / CP1251 <-> UTF-8 conversion
+//
+
+#include "TextCodec.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "TextCodecTables.h"
+#include "TextConverter.h"
+
+using namespace TextCodecTables;
+
+namespace {
+    constexpr uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+    // GBK keeps the euro sign of CP936 as a single byte
+    constexpr uint8_t GBK_EURO_BYTE = 0x80;
+    constexpr uint16_t EURO_SIGN = 0x20AC;
+
+    // Reverse tables, derived from the decode tables at compile time.
+    // UNICODE_TO_GBK holds (lead << 8) | trail, a value below 0x100 is a single byte.
+    struct UnicodeToGbk {
+        uint16_t codes[0x10000];
+    };
+
+    constexpr UnicodeToGbk buildUnicodeToGbk() {
+        UnicodeToGbk table{};
+        for (unsigned lead = GBK_LEAD_MIN; lead <= GBK_LEAD_MAX; lead++) {
+            for (unsigned trail = GBK_TRAIL_MIN; trail <= GBK_TRAIL_MAX; trail++) {
+                uint16_t codePoint = GBK_TO_UNICODE[(lead - GBK_LEAD_MIN) * GBK_TRAILS + (trail - GBK_TRAIL_MIN)];
+                if (codePoint != 0) {
+                    table.codes[codePoint] = static_cast<uint16_t>((lead << 8) | trail);
+                }
+            }
+        }
+        table.codes[EURO_SIGN] = GBK_EURO_BYTE;
+        return table;
+    }
+
+    constexpr UnicodeToGbk UNICODE_TO_GBK = buildUnicodeToGbk();
+
+    // Highest code point CP1251 maps (U+2122 TRADE MARK SIGN) plus one
+    constexpr uint32_t CP1251_CODE_POINTS = 0x2123;
+
+    struct UnicodeToCp1251 {
+        uint8_t bytes[CP1251_CODE_POINTS];
+    };
+
+    constexpr UnicodeToCp1251 buildUnicodeToCp1251() {
+        UnicodeToCp1251 table{};
+        for (unsigned byte = 0x80; byte <= 0xFF; byte++) {
+            uint16_t codePoint = CP1251_TO_UNICODE[byte - 0x80];
+            if (codePoint != 0) {
+                table.bytes[codePoint] = static_cast<uint8_t>(byte);
+            }
+        }
+        return table;
+    }
+
+    constexpr UnicodeToCp1251 UNICODE_TO_CP1251 = buildUnicodeToCp1251();
+
+    char* appendUtf8(char* out, uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            *out++ = static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            *out++ = static_cast<char>(0xC0 | (codePoint >> 6));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            *out++ = static_cast<char>(0xE0 | (codePoint >> 12));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            *out++ = static_cast<char>(0xF0 | (codePoint >> 18));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        return out;
+    }
+
+    // Decodes the multi byte sequence at input[i], whose lead byte has
+    // already been classified as `length` bytes long. 0 if malformed.
+    uint32_t readUtf8(const uint8_t* input, size_t i, int length) {
+        static constexpr uint32_t MIN_CODE_POINT[5] = {0, 0, 0x80, 0x800, 0x10000};
+        static constexpr uint8_t LEAD_MASK[5] = {0, 0, 0x1F, 0x0F, 0x07};
+
+        uint32_t codePoint = input[i] & LEAD_MASK[length];
+        for (int j = 1; j < length; j++) {
+            if ((input[i + j] & 0xC0) != 0x80) {
+                return 0;
+            }
+            codePoint = (codePoint << 6) | (input[i + j] & 0x3F);
+        }
+        // Overlong forms, surrogates and anything past U+10FFFF are rejected like iconv does
+        if (codePoint < MIN_CODE_POINT[length] || (codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF) {
+            return 0;
+        }
+        return codePoint;
+    }
+
+    void decodeGbk(const uint8_t* input, size_t length, char* out, size_t& written) {
+        char* start = out;
+        size_t i = 0;
+        while (i < length) {
+            size_t run = TextConverter::asciiPrefixLength(reinterpret_cast<const char*>(input + i), length - i);
+            std::memcpy(out, input + i, run);
+            out += run;
+            i += run;
+            if (i >= length) break;
+
+            uint8_t lead = input[i];
+            if (lead == GBK_EURO_BYTE) {
+                out = appendUtf8(out, EURO_SIGN);
+                i++;
+                continue;
+            }
+            if (lead > GBK_LEAD_MAX || i + 1 >= length) {
+                out = appendUtf8(out, REPLACEMENT_CHARACTER);
+                i++;
+                continue;
+            }
+
+            uint8_t trail = input[i + 1];
+            uint16_t codePoint = 0;
+            if (trail >= GBK_TRAIL_MIN && trail <= GBK_TRAIL_MAX) {
+                codePoint = GBK_TO_UNICODE[(lead - GBK_LEAD_MIN) * GBK_TRAILS + (trail - GBK_TRAIL_MIN)];
+            }
+            if (codePoint != 0) {
+                out = appendUtf8(out, codePoint);
+                i += 2;
+            } else {
+                out = appendUtf8(out, REPLACEMENT_CHARACTER);
+                // An ASCII byte after a bad lead byte starts the next character
+                i += trail < 0x80 ? 1 : 2;
+            }
+        }
+        written = out - start;
+    }
+
+    void decodeCp1251(const uint8_t* input, size_t length, char* out, size_t& written) {
+        char* start = out;
+        size_t i = 0;
+        while (i < length) {
+            size_t run = TextConverter::asciiPrefixLength(reinterpret_cast<const char*>(input + i), length - i);
+            std::memcpy(out, input + i, run);
+            out += run;
+            i += run;
+            if (i >= length) break;
+
+            uint16_t codePoint = CP1251_TO_UNICODE[input[i] - 0x80];
+            out = appendUtf8(out, codePoint != 0 ? codePoint : REPLACEMENT_CHARACTER);
+            i++;
+        }
+        written = out - start;
+    }
+
+    // Bytes of `codePoint` in the target encoding written to out, '?' if unmapped
+    char* encodeCodePoint(TextCodec::Encoding encoding, uint32_t codePoint, char* out) {
+        if (encoding == TextCodec::Encoding::GBK) {
+            uint16_t code = codePoint < 0x10000 ? UNICODE_TO_GBK.codes[codePoint] : 0;
+            if (code >= 0x100) {
+                *out++ = static_cast<char>(code >> 8);
+                *out++ = static_cast<char>(code & 0xFF);
+            } else {
+                *out++ = code != 0 ? static_cast<char>(code) : '?';
+            }
+        } else {
+            uint8_t byte = codePoint < CP1251_CODE_POINTS ? UNICODE_TO_CP1251.bytes[codePoint] : 0;
+            *out++ = byte != 0 ? static_cast<char>(byte) : '?';
+        }
+        return out;
+    }
+
+    int utf8SequenceLength(uint8_t lead) {
+        if ((lead & 0xE0) == 0xC0) return 2;
+        if ((lead & 0xF0) == 0xE0) return 3;
+        if ((lead & 0xF8) == 0xF0) return 4;
+        return 0;
+    }
+
+    char asciiLower(char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    bool equalsIgnoreCase(const std::string& a, const char* b) {
+        size_t length = std::strlen(b);
+        if (a.length() != length) return false;
+        for (size_t i = 0; i < length; i++) {
+            if (asciiLower(a[i]) != asciiLower(b[i])) return false;
+        }
+        return true;
+    }
+}
+
+TextCodec::Encoding TextCodec::fromName(const std::string& name) {
+    for (const char* gbk : {"GBK", "GB2312", "CP936", "MS936", "WINDOWS-936", "936"}) {
+        if (equalsIgnoreCase(name, gbk)) return Encoding::GBK;
+    }
+    for (const char* cp1251 : {"CP1251", "WINDOWS-1251", "MS-CYRL", "1251"}) {
+        if (equalsIgnoreCase(name, cp1251)) return Encoding::CP1251;
+    }
+    return Encoding::UNSUPPORTED;
+}
+
+void TextCodec::decode(Encoding encoding, const char* input, size_t length, std::string& out) {
+    // Worst case is a lone invalid byte turning into a 3 byte U+FFFD
+    out.resize(length * 3);
+    size_t written = 0;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(input);
+    if (encoding == Encoding::GBK) {
+        decodeGbk(bytes, length, &out[0], written);
+    } else if (encoding == Encoding::CP1251) {
+        decodeCp1251(bytes, length, &out[0], written);
+    } else {
+        out.assign(input, length);
+        return;
+    }
+    out.resize(written);
+}
+
+void TextCodec::encode(Encoding encoding, const char* input, size_t length, std::string& out) {
+    if (encoding == Encoding::UNSUPPORTED) {
+        out.assign(input, length);
+        return;
+    }
+
+    // Never longer than the UTF-8 input
+    out.resize(length);
+    char* start = &out[0];
+    char* cursor = start;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(input);
+    size_t i = 0;
+    while (i < length) {
+        size_t run = TextConverter::asciiPrefixLength(input + i, length - i);
+        std::memcpy(cursor, input + i, run);
+        cursor += run;
+        i += run;
+        if (i >= length) break;
+
+        int sequence = utf8SequenceLength(bytes[i]);
+        if (sequence == 0) {
+            i++; // Invalid UTF-8 start byte, skip it
+            continue;
+        }
+        if (i + sequence > length) {
+            break; // Incomplete character at end, skip remaining bytes
+        }
+
+        uint32_t codePoint = readUtf8(bytes, i, sequence);
+        if (codePoint != 0) {
+            cursor = encodeCodePoint(encoding, codePoint, cursor);
+        } else {
+            *cursor++ = '?';
+        }
+        i += sequence;
+    }
+    out.resize(cursor - start);
+}
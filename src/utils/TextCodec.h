@@ -0,0 +1,34 @@
+//
+// Table driven GBK / CP1251 <-> UTF-8 conversion
+//
+
+#ifndef BOTMASTERXL_TEXTCODEC_H
+#define BOTMASTERXL_TEXTCODEC_H
+
+#include <cstddef>
+#include <string>
+
+// Built-in codecs for the message encodings servers actually use. Both
+// directions run off compile time tables and copy ASCII runs in bulk, so
+// converting chat, dialogs and labels never has to go through iconv.
+// TextConverter falls back to iconv for every other encoding.
+namespace TextCodec {
+    enum class Encoding {
+        UNSUPPORTED,
+        GBK,    // also serves GB2312 and CP936, GBK is a superset of GB2312
+        CP1251
+    };
+
+    // Case-insensitive lookup of a configured encoding name
+    Encoding fromName(const std::string& name);
+
+    // Writes the UTF-8 form of `input` to `out`. Invalid or truncated byte
+    // sequences become U+FFFD.
+    void decode(Encoding encoding, const char* input, size_t length, std::string& out);
+
+    // Writes UTF-8 `input` in `encoding` to `out`. Code points the encoding
+    // cannot represent become '?', malformed UTF-8 lead bytes are skipped.
+    void encode(Encoding encoding, const char* input, size_t length, std::string& out);
+}
+
+#endif //BOTMASTERXL_TEXTCODEC_H
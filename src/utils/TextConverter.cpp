@@ -8,69 +8,169 @@
 #include <cstring>
 #include <spdlog/spdlog.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "CApp.h"
+#include "TextCodec.h"
 #include "core/CConfig.h"
 
+namespace {
+    // iconv descriptors carry conversion state and must not be shared between
+    // threads, so every thread opens its own once per encoding pair and keeps
+    // it until it exits. Failed opens are remembered too, they are not retried.
+    class ConverterCache {
+    public:
+        ~ConverterCache() {
+            for (auto& converter : converters) {
+                if (converter.cd != INVALID) {
+                    iconv_close(converter.cd);
+                }
+            }
+        }
+
+        // Returns the descriptor in its initial state, or INVALID
+        iconv_t get(const std::string& to, const std::string& from) {
+            for (auto& converter : converters) {
+                if (converter.to == to && converter.from == from) {
+                    if (converter.cd != INVALID) {
+                        iconv(converter.cd, nullptr, nullptr, nullptr, nullptr);
+                    }
+                    return converter.cd;
+                }
+            }
+
+            iconv_t cd = iconv_open(to.c_str(), from.c_str());
+            if (cd == INVALID) {
+                spdlog::error("Failed to open iconv descriptor for {}->{}: {}", from, to, strerror(errno));
+            }
+            converters.push_back({to, from, cd});
+            return cd;
+        }
+
+        static inline const iconv_t INVALID = (iconv_t)-1;
+
+    private:
+        struct Converter {
+            std::string to;
+            std::string from;
+            iconv_t cd;
+        };
+        std::vector<Converter> converters;
+    };
+
+    thread_local ConverterCache converterCache;
+
+    const std::string& messageEncoding() {
+        return CApp::getInstance()->getConfig()->message_encoding;
+    }
+
+    // Built-in codec for the configured encoding, resolved again only when the name changes
+    TextCodec::Encoding messageCodec() {
+        thread_local std::string resolvedName;
+        thread_local TextCodec::Encoding resolved = TextCodec::Encoding::UNSUPPORTED;
+        const std::string& name = messageEncoding();
+        if (name != resolvedName) {
+            resolvedName = name;
+            resolved = TextCodec::fromName(name);
+        }
+        return resolved;
+    }
+
+    // Ensure the result contains only printable characters, control
+    // characters might break JSON
+    void replaceControlCharacters(std::string& text) {
+        for (char& c : text) {
+            unsigned char byte = static_cast<unsigned char>(c);
+            if ((byte < 32 && c != '\n' && c != '\r' && c != '\t') || byte == 127) {
+                c = ' ';
+            }
+        }
+    }
+}
+
 std::string TextConverter::gb2312ToUtf8(const std::string& gb2312_str) {
     return gb2312ToUtf8(gb2312_str.c_str(), gb2312_str.length());
 }
 
 std::string TextConverter::gb2312ToUtf8(const char* gb2312_buffer, size_t length) {
+    std::string result;
+    gb2312ToUtf8(gb2312_buffer, length, result);
+    return result;
+}
+
+bool TextConverter::gb2312ToUtf8(const char* gb2312_buffer, size_t length, std::string& out) {
+    out.clear();
     if (!gb2312_buffer || length == 0) {
-        return "";
+        return true;
     }
-    
-    // Open iconv descriptor to UTF-8 conversion
-    std::string encoding = CApp::getInstance()->getConfig()->message_encoding;
-    iconv_t cd = iconv_open("UTF-8", encoding.c_str());
-    if (cd == (iconv_t)-1) {
-        spdlog::error("Failed to open iconv descriptor for {}->UTF-8: {}", encoding, strerror(errno));
-        return std::string(gb2312_buffer, length); // Return original if conversion fails
+
+    TextCodec::Encoding codec = messageCodec();
+    if (codec != TextCodec::Encoding::UNSUPPORTED) {
+        TextCodec::decode(codec, gb2312_buffer, length, out);
+        return true;
+    }
+
+    iconv_t cd = converterCache.get("UTF-8", messageEncoding());
+    if (cd == ConverterCache::INVALID) {
+        out.assign(gb2312_buffer, length); // Return original if conversion fails
+        return false;
     }
-    
-    // Prepare input and output buffers
-    size_t in_bytes_left = length;
-    size_t out_bytes_left = length * 4; // UTF-8 can be up to 4 bytes per character
 
 #ifdef _WIN32
-    const char* in_buf = const_cast<char*>(gb2312_buffer);
+    const char* in_buf = gb2312_buffer;
 #else
     char* in_buf = const_cast<char*>(gb2312_buffer);
 #endif
+    size_t in_bytes_left = length;
 
-    std::vector<char> out_buffer(out_bytes_left);
-    char* out_buf = out_buffer.data();
-    char* out_buf_start = out_buf;
-    
-    // Perform conversion
-    size_t result = iconv(cd, &in_buf, &in_bytes_left, &out_buf, &out_bytes_left);
-    
-    // Close iconv descriptor
-    iconv_close(cd);
-    
-    if (result == (size_t)-1) {
-        spdlog::warn("iconv conversion failed: {}", strerror(errno));
-        return std::string(gb2312_buffer, length); // Return original if conversion fails
+    // Double byte encodings grow by half at most, single byte ones double,
+    // the loop below widens the buffer for anything else
+    out.resize(length * 2);
+    size_t written = 0;
+    while (in_bytes_left > 0) {
+        char* out_buf = &out[written];
+        size_t out_bytes_left = out.size() - written;
+        size_t result = iconv(cd, &in_buf, &in_bytes_left, &out_buf, &out_bytes_left);
+        written = out_buf - out.data();
+
+        if (result != (size_t)-1) {
+            break;
+        }
+        if (errno != E2BIG) {
+            spdlog::warn("iconv conversion failed: {}", strerror(errno));
+            out.assign(gb2312_buffer, length); // Return original if conversion fails
+            return false;
+        }
+        out.resize(out.size() * 2);
     }
-    
-    // Calculate converted length
-    size_t converted_length = out_buf - out_buf_start;
-    return std::string(out_buf_start, converted_length);
+    out.resize(written);
+    return true;
 }
 
 std::string TextConverter::utf8ToGb2312(const std::string& utf8_str) {
     if (utf8_str.empty()) {
         return "";
     }
+
+    TextCodec::Encoding codec = messageCodec();
+    if (codec != TextCodec::Encoding::UNSUPPORTED) {
+        std::string result;
+        TextCodec::encode(codec, utf8_str.data(), utf8_str.length(), result);
+        replaceControlCharacters(result);
+        return result;
+    }
     
     // Force conversion approach - process character by character
     std::string result;
     result.reserve(utf8_str.length() * 2);
     
-    // Open iconv descriptor for UTF-8 to GBK conversion
-    std::string encoding = CApp::getInstance()->getConfig()->message_encoding + "//IGNORE";
-    iconv_t cd = iconv_open(encoding.c_str(), "UTF-8");
-    if (cd == (iconv_t)-1) {
+    // Cached descriptor for UTF-8 to GBK conversion
+    iconv_t cd = converterCache.get(messageEncoding() + "//IGNORE", "UTF-8");
+    if (cd == ConverterCache::INVALID) {
         // If iconv fails to open, fall back to ASCII-only filtering
         spdlog::warn("Failed to open iconv descriptor, using ASCII fallback");
         for (unsigned char c : utf8_str) {
@@ -151,40 +251,31 @@ std::string TextConverter::utf8ToGb2312(const std::string& utf8_str) {
         pos = char_start + char_len;
     }
     
-    iconv_close(cd);
-    
-    // Final safety check - ensure result contains only printable characters
-    std::string safe_result;
-    safe_result.reserve(result.length());
-    
-    for (unsigned char c : result) {
-        if (c >= 32 && c <= 126) { // Printable ASCII
-            safe_result += static_cast<char>(c);
-        } else if (c >= 128) { // Extended characters (GB2312)
-            safe_result += static_cast<char>(c);
-        } else if (c == '\n' || c == '\r' || c == '\t') { // Common whitespace
-            safe_result += static_cast<char>(c);
-        } else {
-            // Skip control characters that might break JSON
-            safe_result += ' ';
-        }
-    }
-    
-    return safe_result;
+    // Final safety check
+    replaceControlCharacters(result);
+    return result;
 }
 
 bool TextConverter::isValidUtf8(const std::string& str) {
-    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(str.c_str());
-    size_t len = str.length();
+    return isValidUtf8(str.data(), str.length());
+}
+
+bool TextConverter::isValidUtf8(const char* data, size_t length) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
     
-    for (size_t i = 0; i < len; ) {
+    for (size_t i = asciiPrefixLength(data, length); i < length; ) {
+        if (bytes[i] < 0x80) {
+            i++;
+            continue;
+        }
+
         int char_len = getUtf8CharLength(bytes[i]);
         
         if (char_len == 0) {
             return false; // Invalid first byte
         }
         
-        if (i + char_len > len) {
+        if (i + char_len > length) {
             return false; // Not enough bytes for character
         }
         
@@ -201,22 +292,58 @@ bool TextConverter::isValidUtf8(const std::string& str) {
     return true;
 }
 
+size_t TextConverter::asciiPrefixLength(const char* data, size_t length) {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    for (; i + 32 <= length; i += 32) {
+        int mask = _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#elif defined(__SSE2__)
+    for (; i + 16 <= length; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    for (; i < length; i++) {
+        if (static_cast<uint8_t>(data[i]) >= 0x80) {
+            return i;
+        }
+    }
+    return length;
+}
+
 std::string TextConverter::ensureUtf8(const std::string& input) {
-    if (isValidUtf8(input)) {
-        return input; // Already UTF-8
+    return ensureUtf8(input.data(), input.length());
+}
+
+std::string TextConverter::ensureUtf8(const char* input, size_t length) {
+    std::string result;
+    ensureUtf8(input, length, result);
+    return result;
+}
+
+void TextConverter::ensureUtf8(const char* input, size_t length, std::string& out) {
+    // Most names, commands and labels are plain ASCII
+    if (isValidUtf8(input, length)) {
+        out.assign(input, length); // Already UTF-8
+        return;
     }
-    
-    // Try to convert from GBK
-    std::string converted = gb2312ToUtf8(input);
-    
-    // Check if conversion was successful
-    if (isValidUtf8(converted)) {
-        return converted;
+
+    // Try to convert from GBK, the converters only ever produce valid UTF-8
+    if (gb2312ToUtf8(input, length, out)) {
+        return;
     }
-    
+
     // If all else fails, return empty string to ensure UTF-8 compliance
     spdlog::warn("Could not convert string to UTF-8, returning empty string");
-    return "";
+    out.clear();
 }
 
 std::vector<uint8_t> TextConverter::gb2312CharToUtf8(uint16_t gb2312_char) {
@@ -24,6 +24,15 @@ public:
      * @return String converted to UTF-8 encoding
      */
     static std::string gb2312ToUtf8(const char* gb2312_buffer, size_t length);
+
+    /**
+     * Convert a buffer in the configured message encoding to UTF-8
+     * @param gb2312_buffer Input buffer in the message encoding
+     * @param length Length of input buffer
+     * @param out Receives the UTF-8 text, its storage is reused
+     * @return false if the conversion failed, `out` then holds the input unchanged
+     */
+    static bool gb2312ToUtf8(const char* gb2312_buffer, size_t length, std::string& out);
     
     /**
      * Convert UTF-8 encoded string to GB2312
@@ -38,6 +47,15 @@ public:
      * @return true if valid UTF-8, false otherwise
      */
     static bool isValidUtf8(const std::string& str);
+    static bool isValidUtf8(const char* data, size_t length);
+
+    /**
+     * Length of the leading run of 7-bit ASCII bytes, vectorized
+     * @param data Input bytes
+     * @param length Length of input
+     * @return Index of the first byte >= 0x80, or length if there is none
+     */
+    static size_t asciiPrefixLength(const char* data, size_t length);
     
     /**
      * Auto-detect encoding and convert to UTF-8 if needed
@@ -45,6 +63,18 @@ public:
      * @return String guaranteed to be UTF-8
      */
     static std::string ensureUtf8(const std::string& input);
+    static std::string ensureUtf8(const char* input, size_t length);
+
+    /**
+     * Auto-detect encoding and write the UTF-8 text to a caller provided buffer.
+     * Pure ASCII and valid UTF-8 input is copied as is, anything else goes
+     * through the built-in codec for the message encoding (GBK, CP1251) or
+     * this thread's cached iconv converter.
+     * @param input Input bytes that might be GB2312 or UTF-8
+     * @param length Length of input
+     * @param out Receives the UTF-8 text (empty if it could not be converted), its storage is reused
+     */
+    static void ensureUtf8(const char* input, size_t length, std::string& out);
 
 private:
     /**
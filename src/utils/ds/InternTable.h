@@ -0,0 +1,120 @@
+//
+// Reference counted pool of immutable values, equal values share one copy
+//
+
+#ifndef BOTMASTERXL_INTERNTABLE_H
+#define BOTMASTERXL_INTERNTABLE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// intern() hands out a shared_ptr to the stored copy of a value equal to its
+// argument, creating that copy if no live one exists. The table only keeps
+// weak references: the copy is freed and forgotten as soon as its last holder
+// lets go, on whichever thread that happens. Safe to use from any thread, the
+// table state outlives the table object while copies are still referenced.
+template <typename T, typename Hash, typename Equal>
+class InternTable {
+public:
+    InternTable() : state(std::make_shared<State>()) {}
+    InternTable(const InternTable&) = delete;
+    InternTable& operator=(const InternTable&) = delete;
+
+    std::shared_ptr<const T> intern(const T& value) {
+        size_t hash = Hash()(value);
+        // Copies locked while probing are released after the mutex, dropping
+        // the last reference under it would deadlock in forget()
+        std::vector<std::shared_ptr<const T>> probed;
+        std::lock_guard<std::mutex> lock(state->mutex);
+
+        auto& bucket = state->buckets[hash];
+        for (const auto& entry : bucket) {
+            // A copy whose last holder is on its way out cannot be revived,
+            // it is skipped and a fresh one takes its place
+            if (auto existing = entry.ref.lock()) {
+                if (Equal()(*existing, value)) {
+                    return existing;
+                }
+                probed.push_back(std::move(existing));
+            }
+        }
+
+        std::weak_ptr<State> owner = state;
+        std::shared_ptr<const T> copy(new T(value), [owner, hash](const T* stored) {
+            if (auto table = owner.lock()) {
+                table->forget(hash, stored);
+            }
+            delete stored;
+        });
+        bucket.push_back({copy.get(), copy});
+        state->count++;
+        return copy;
+    }
+
+    // Number of distinct live values
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->count;
+    }
+
+    // Heap bytes of the live values, their control blocks and the table.
+    // extraBytes(value) adds memory a value owns beyond sizeof(T).
+    template <typename Fn>
+    size_t getMemoryUsage(Fn&& extraBytes) const {
+        std::vector<std::shared_ptr<const T>> probed;
+        std::lock_guard<std::mutex> lock(state->mutex);
+        // Control block: counters, vtable and the deleter with its captures
+        constexpr size_t CONTROL_BLOCK = 2 * sizeof(long) + sizeof(void*) + sizeof(std::weak_ptr<State>) + sizeof(size_t);
+        size_t bytes = state->buckets.bucket_count() * sizeof(void*);
+        for (const auto& bucket : state->buckets) {
+            bytes += sizeof(void*) + sizeof(bucket) + bucket.second.capacity() * sizeof(Entry);
+            for (const auto& entry : bucket.second) {
+                if (auto value = entry.ref.lock()) {
+                    bytes += sizeof(T) + CONTROL_BLOCK + extraBytes(*value);
+                    probed.push_back(std::move(value));
+                }
+            }
+        }
+        return bytes;
+    }
+    size_t getMemoryUsage() const {
+        return getMemoryUsage([](const T&) { return size_t(0); });
+    }
+
+private:
+    struct Entry {
+        const T* stored; // identifies the entry once the weak reference expired
+        std::weak_ptr<const T> ref;
+    };
+
+    struct State {
+        std::mutex mutex;
+        std::unordered_map<size_t, std::vector<Entry>> buckets;
+        size_t count = 0;
+
+        void forget(size_t hash, const T* stored) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = buckets.find(hash);
+            if (it == buckets.end()) return;
+
+            auto& bucket = it->second;
+            auto entry = std::find_if(bucket.begin(), bucket.end(), [stored](const Entry& e) { return e.stored == stored; });
+            if (entry == bucket.end()) return;
+
+            *entry = std::move(bucket.back());
+            bucket.pop_back();
+            count--;
+            if (bucket.empty()) {
+                buckets.erase(it);
+            }
+        }
+    };
+
+    std::shared_ptr<State> state;
+};
+
+#endif //BOTMASTERXL_INTERNTABLE_H
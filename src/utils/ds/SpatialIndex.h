@@ -0,0 +1,388 @@
+//
+// Sparse spatial index over records with an id and a position
+//
+
+#ifndef BOTMASTERXL_SPATIALINDEX_H
+#define BOTMASTERXL_SPATIALINDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "glm/vec3.hpp"
+#include "../RangeFilter.h"
+
+// Owns records of type T (anything with an `int id` and a `glm::vec3 position`)
+// in a dense vector and buckets them into square x/y cells kept in a hash map,
+// so only occupied cells cost memory. Insert, remove and lookup by id are O(1),
+// radius queries only visit the cells under the query and test them with
+// RangeFilter. Nothing is ever moved in place, replace a record by inserting
+// it again.
+template <typename T>
+class SpatialIndex {
+public:
+    SpatialIndex(size_t capacity, float cellSize) : capacity(capacity), cellSize(cellSize) {}
+
+    // Adds the record or replaces the one with the same id. False if full.
+    bool insert(const T& item);
+    bool remove(int id);
+    // Drops every record and hands the storage back, an unused index costs nothing
+    void clear();
+
+    const T* find(int id) const;
+    size_t size() const { return items.size(); }
+    bool empty() const { return items.empty(); }
+    size_t getCapacity() const { return capacity; }
+    const std::vector<T>& getItems() const { return items; }
+    // Heap bytes held by the index itself, including its copies of T but not
+    // whatever those point to
+    size_t getMemoryUsage() const;
+
+    // Calls fn(const T&) for every record within range of position (3D distance)
+    template <typename Fn>
+    void forEachInRange(const glm::vec3& position, float range, Fn&& fn) const;
+    size_t countInRange(const glm::vec3& position, float range) const;
+
+    // Up to k records within maxRange, nearest first
+    std::vector<const T*> nearest(const glm::vec3& position, size_t k, float maxRange) const;
+
+    // For every record of this index within range of position, calls
+    // fn(const T&, const U&) with each record of `other` within pairRange of
+    // it. Works cell by cell: the candidates of `other` are gathered once per
+    // cell of this index instead of once per record.
+    template <typename U, typename Fn>
+    void joinInRange(const glm::vec3& position, float range, const SpatialIndex<U>& other, float pairRange, Fn&& fn) const;
+
+private:
+    template <typename> friend class SpatialIndex;
+
+    using CellKey = uint64_t;
+    // Indices handed to RangeFilter are 16 bit
+    static constexpr size_t FILTER_CHUNK = 256;
+
+    struct Cell {
+        std::vector<uint32_t> slots; // indices into items
+        std::vector<float> x, y, z;
+    };
+
+    int columnOf(float coord) const {
+        float column = std::floor(coord / cellSize);
+        // NaN and coordinates far outside the map end up in the outermost columns
+        if (!(column >= -1e6f)) return -1000000;
+        if (column > 1e6f) return 1000000;
+        return static_cast<int>(column);
+    }
+    static CellKey keyOf(int cx, int cy) {
+        return (static_cast<CellKey>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+    }
+    CellKey keyOf(const glm::vec3& position) const { return keyOf(columnOf(position.x), columnOf(position.y)); }
+
+    void addToCell(uint32_t slot);
+    void removeFromCell(uint32_t slot);
+
+    // Calls fn(const Cell&) for every occupied cell overlapping the square around position
+    template <typename Fn>
+    void forEachCell(const glm::vec3& position, float range, Fn&& fn) const;
+
+    size_t capacity;
+    float cellSize;
+    std::vector<T> items;
+    std::vector<CellKey> cellOfSlot;
+    std::vector<uint32_t> indexInCell;
+    std::unordered_map<int, uint32_t> slotById;
+    std::unordered_map<CellKey, Cell> cells;
+};
+
+template <typename T>
+bool SpatialIndex<T>::insert(const T& item) {
+    auto it = slotById.find(item.id);
+    if (it != slotById.end()) {
+        uint32_t slot = it->second;
+        removeFromCell(slot);
+        items[slot] = item;
+        addToCell(slot);
+        return true;
+    }
+    if (items.size() >= capacity) {
+        return false;
+    }
+
+    uint32_t slot = static_cast<uint32_t>(items.size());
+    items.push_back(item);
+    cellOfSlot.push_back(0);
+    indexInCell.push_back(0);
+    slotById.emplace(item.id, slot);
+    addToCell(slot);
+    return true;
+}
+
+template <typename T>
+bool SpatialIndex<T>::remove(int id) {
+    auto it = slotById.find(id);
+    if (it == slotById.end()) {
+        return false;
+    }
+
+    uint32_t slot = it->second;
+    uint32_t last = static_cast<uint32_t>(items.size() - 1);
+    slotById.erase(it);
+    removeFromCell(slot);
+
+    // Move the last record into the hole and repoint its cell entry
+    if (slot != last) {
+        items[slot] = std::move(items[last]);
+        cellOfSlot[slot] = cellOfSlot[last];
+        indexInCell[slot] = indexInCell[last];
+        cells[cellOfSlot[slot]].slots[indexInCell[slot]] = slot;
+        slotById[items[slot].id] = slot;
+    }
+    items.pop_back();
+    cellOfSlot.pop_back();
+    indexInCell.pop_back();
+    return true;
+}
+
+template <typename T>
+void SpatialIndex<T>::clear() {
+    std::vector<T>().swap(items);
+    std::vector<CellKey>().swap(cellOfSlot);
+    std::vector<uint32_t>().swap(indexInCell);
+    std::unordered_map<int, uint32_t>().swap(slotById);
+    std::unordered_map<CellKey, Cell>().swap(cells);
+}
+
+template <typename T>
+size_t SpatialIndex<T>::getMemoryUsage() const {
+    // Hash map nodes are estimated as a next pointer plus the stored pair
+    size_t bytes = items.capacity() * sizeof(T)
+                 + cellOfSlot.capacity() * sizeof(CellKey)
+                 + indexInCell.capacity() * sizeof(uint32_t)
+                 + slotById.bucket_count() * sizeof(void*)
+                 + slotById.size() * (sizeof(void*) + sizeof(std::pair<const int, uint32_t>))
+                 + cells.bucket_count() * sizeof(void*)
+                 + cells.size() * (sizeof(void*) + sizeof(std::pair<const CellKey, Cell>));
+    for (const auto& entry : cells) {
+        const Cell& cell = entry.second;
+        bytes += cell.slots.capacity() * sizeof(uint32_t)
+               + (cell.x.capacity() + cell.y.capacity() + cell.z.capacity()) * sizeof(float);
+    }
+    return bytes;
+}
+
+template <typename T>
+const T* SpatialIndex<T>::find(int id) const {
+    auto it = slotById.find(id);
+    return it == slotById.end() ? nullptr : &items[it->second];
+}
+
+template <typename T>
+void SpatialIndex<T>::addToCell(uint32_t slot) {
+    const glm::vec3& position = items[slot].position;
+    CellKey key = keyOf(position);
+    Cell& cell = cells[key];
+    cellOfSlot[slot] = key;
+    indexInCell[slot] = static_cast<uint32_t>(cell.slots.size());
+    cell.slots.push_back(slot);
+    cell.x.push_back(position.x);
+    cell.y.push_back(position.y);
+    cell.z.push_back(position.z);
+}
+
+template <typename T>
+void SpatialIndex<T>::removeFromCell(uint32_t slot) {
+    auto it = cells.find(cellOfSlot[slot]);
+    Cell& cell = it->second;
+    uint32_t index = indexInCell[slot];
+    size_t last = cell.slots.size() - 1;
+    if (index != last) {
+        cell.slots[index] = cell.slots[last];
+        cell.x[index] = cell.x[last];
+        cell.y[index] = cell.y[last];
+        cell.z[index] = cell.z[last];
+        indexInCell[cell.slots[index]] = index;
+    }
+    cell.slots.pop_back();
+    cell.x.pop_back();
+    cell.y.pop_back();
+    cell.z.pop_back();
+    if (cell.slots.empty()) {
+        cells.erase(it);
+    }
+}
+
+template <typename T>
+template <typename Fn>
+void SpatialIndex<T>::forEachCell(const glm::vec3& position, float range, Fn&& fn) const {
+    if (cells.empty()) return;
+
+    int minX = columnOf(position.x - range), maxX = columnOf(position.x + range);
+    int minY = columnOf(position.y - range), maxY = columnOf(position.y + range);
+    // Walking the map is cheaper than probing more cells than it holds
+    if (static_cast<uint64_t>(maxX - minX + 1) * static_cast<uint64_t>(maxY - minY + 1) > cells.size()) {
+        for (const auto& entry : cells) {
+            int cx = static_cast<int>(static_cast<uint32_t>(entry.first >> 32));
+            int cy = static_cast<int>(static_cast<uint32_t>(entry.first));
+            if (cx >= minX && cx <= maxX && cy >= minY && cy <= maxY) {
+                fn(entry.second);
+            }
+        }
+        return;
+    }
+
+    for (int cy = minY; cy <= maxY; cy++) {
+        for (int cx = minX; cx <= maxX; cx++) {
+            auto it = cells.find(keyOf(cx, cy));
+            if (it != cells.end()) {
+                fn(it->second);
+            }
+        }
+    }
+}
+
+template <typename T>
+template <typename Fn>
+void SpatialIndex<T>::forEachInRange(const glm::vec3& position, float range, Fn&& fn) const {
+    float rangeSq = range * range;
+    uint16_t hits[FILTER_CHUNK];
+    forEachCell(position, range, [&](const Cell& cell) {
+        for (size_t offset = 0; offset < cell.slots.size(); offset += FILTER_CHUNK) {
+            size_t length = std::min(FILTER_CHUNK, cell.slots.size() - offset);
+            size_t found = RangeFilter::inRange(cell.x.data() + offset, cell.y.data() + offset, cell.z.data() + offset,
+                                                length, position.x, position.y, position.z, rangeSq, hits);
+            for (size_t i = 0; i < found; i++) {
+                fn(items[cell.slots[offset + hits[i]]]);
+            }
+        }
+    });
+}
+
+template <typename T>
+size_t SpatialIndex<T>::countInRange(const glm::vec3& position, float range) const {
+    float rangeSq = range * range;
+    size_t found = 0;
+    forEachCell(position, range, [&](const Cell& cell) {
+        found += RangeFilter::countInRange(cell.x.data(), cell.y.data(), cell.z.data(), cell.slots.size(),
+                                           position.x, position.y, position.z, rangeSq);
+    });
+    return found;
+}
+
+template <typename T>
+std::vector<const T*> SpatialIndex<T>::nearest(const glm::vec3& position, size_t k, float maxRange) const {
+    std::vector<const T*> result;
+    if (k == 0 || items.empty()) return result;
+
+    // Max heap on distance holding the best k candidates so far
+    std::vector<std::pair<float, uint32_t>> best;
+    best.reserve(k + 1);
+    float maxRangeSq = maxRange * maxRange;
+    auto consider = [&](const Cell& cell) {
+        for (size_t i = 0; i < cell.slots.size(); i++) {
+            float dx = cell.x[i] - position.x, dy = cell.y[i] - position.y, dz = cell.z[i] - position.z;
+            float distSq = dx * dx + dy * dy + dz * dz;
+            if (distSq > maxRangeSq || (best.size() == k && distSq >= best.front().first)) continue;
+            best.emplace_back(distSq, cell.slots[i]);
+            std::push_heap(best.begin(), best.end());
+            if (best.size() > k) {
+                std::pop_heap(best.begin(), best.end());
+                best.pop_back();
+            }
+        }
+    };
+
+    // Widen ring by ring while that probes fewer cells than the map holds,
+    // a sparse far away population is cheaper to scan directly
+    int centerX = columnOf(position.x), centerY = columnOf(position.y);
+    size_t visited = 0;
+    bool done = false;
+    for (int ring = 0; !done; ring++) {
+        uint64_t side = 2 * static_cast<uint64_t>(ring) + 1;
+        if (side * side > 4 * cells.size() + 9) {
+            best.clear();
+            for (const auto& entry : cells) {
+                consider(entry.second);
+            }
+            break;
+        }
+        for (int cy = centerY - ring; cy <= centerY + ring; cy++) {
+            bool edgeRow = cy == centerY - ring || cy == centerY + ring;
+            for (int cx = centerX - ring; cx <= centerX + ring; cx += (edgeRow ? 1 : 2 * ring)) {
+                auto it = cells.find(keyOf(cx, cy));
+                if (it != cells.end()) {
+                    consider(it->second);
+                    visited += it->second.slots.size();
+                }
+                if (ring == 0) break;
+            }
+        }
+
+        // Distance from the position to the nearest cell outside the rings so far
+        float bound = std::min({position.x - (centerX - ring) * cellSize, (centerX + ring + 1) * cellSize - position.x,
+                                position.y - (centerY - ring) * cellSize, (centerY + ring + 1) * cellSize - position.y});
+        done = visited == items.size() || bound > maxRange || (best.size() == k && best.front().first <= bound * bound);
+    }
+
+    std::sort_heap(best.begin(), best.end());
+    result.reserve(best.size());
+    for (const auto& candidate : best) {
+        result.push_back(&items[candidate.second]);
+    }
+    return result;
+}
+
+template <typename T>
+template <typename U, typename Fn>
+void SpatialIndex<T>::joinInRange(const glm::vec3& position, float range, const SpatialIndex<U>& other, float pairRange, Fn&& fn) const {
+    if (other.empty()) return;
+
+    float rangeSq = range * range;
+    float pairRangeSq = pairRange * pairRange;
+    std::vector<uint32_t> candidateSlots;
+    std::vector<float> cx, cy, cz;
+    std::vector<uint16_t> hits;
+
+    forEachCell(position, range, [&](const Cell& cell) {
+        // Candidates of `other` for the whole cell: its bounds widened by pairRange
+        float minX = *std::min_element(cell.x.begin(), cell.x.end());
+        float maxX = *std::max_element(cell.x.begin(), cell.x.end());
+        float minY = *std::min_element(cell.y.begin(), cell.y.end());
+        float maxY = *std::max_element(cell.y.begin(), cell.y.end());
+        glm::vec3 center((minX + maxX) * 0.5f, (minY + maxY) * 0.5f, 0.0f);
+        float halfExtent = std::max(maxX - minX, maxY - minY) * 0.5f + pairRange;
+
+        candidateSlots.clear();
+        cx.clear();
+        cy.clear();
+        cz.clear();
+        other.forEachCell(center, halfExtent, [&](const typename SpatialIndex<U>::Cell& otherCell) {
+            candidateSlots.insert(candidateSlots.end(), otherCell.slots.begin(), otherCell.slots.end());
+            cx.insert(cx.end(), otherCell.x.begin(), otherCell.x.end());
+            cy.insert(cy.end(), otherCell.y.begin(), otherCell.y.end());
+            cz.insert(cz.end(), otherCell.z.begin(), otherCell.z.end());
+        });
+        if (candidateSlots.empty()) return;
+
+        hits.resize(std::min(candidateSlots.size(), FILTER_CHUNK));
+        for (size_t i = 0; i < cell.slots.size(); i++) {
+            float dx = cell.x[i] - position.x, dy = cell.y[i] - position.y, dz = cell.z[i] - position.z;
+            if (dx * dx + dy * dy + dz * dz > rangeSq) continue;
+
+            const T& item = items[cell.slots[i]];
+            for (size_t offset = 0; offset < candidateSlots.size(); offset += FILTER_CHUNK) {
+                size_t length = std::min(FILTER_CHUNK, candidateSlots.size() - offset);
+                size_t found = RangeFilter::inRange(cx.data() + offset, cy.data() + offset, cz.data() + offset, length,
+                                                    cell.x[i], cell.y[i], cell.z[i], pairRangeSq, hits.data());
+                for (size_t h = 0; h < found; h++) {
+                    fn(item, other.items[candidateSlots[offset + hits[h]]]);
+                }
+            }
+        }
+    });
+}
+
+#endif //BOTMASTERXL_SPATIALINDEX_H
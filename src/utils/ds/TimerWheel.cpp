@@ -0,0 +1,122 @@
+//
+// Hierarchical timer wheel with 1 ms resolution
+//
+
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+TimerWheel::TimerWheel(uint64_t now) : current(now) {
+}
+
+void TimerWheel::schedule(TimerId id, uint64_t deadline) {
+    cancel(id);
+    insert(id, deadline);
+}
+
+void TimerWheel::cancel(TimerId id) {
+    auto it = timers.find(id);
+    if (it == timers.end()) {
+        return;
+    }
+    wheel[it->second.level][it->second.slot].erase(it->second.it);
+    timers.erase(it);
+}
+
+void TimerWheel::clear() {
+    for (auto& level : wheel) {
+        for (auto& slot : level) {
+            slot.clear();
+        }
+    }
+    timers.clear();
+}
+
+void TimerWheel::insert(TimerId id, uint64_t deadline) {
+    if (deadline <= current) {
+        deadline = current + 1;
+    }
+    uint64_t delta = std::min(deadline - current, MAX_SPAN);
+    deadline = current + delta;
+
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    int slot = static_cast<int>((deadline >> (SLOT_BITS * level)) & SLOT_MASK);
+
+    auto& list = wheel[level][slot];
+    list.push_back({id, deadline});
+    timers[id] = {level, slot, std::prev(list.end())};
+}
+
+void TimerWheel::cascade(int level) {
+    int slot = static_cast<int>((current >> (SLOT_BITS * level)) & SLOT_MASK);
+    Slot pending;
+    pending.swap(wheel[level][slot]);
+    for (auto& timer : pending) {
+        timers.erase(timer.id);
+        if (timer.deadline <= current) {
+            // Due exactly on this boundary, expired right after the cascade
+            auto& due = wheel[0][current & SLOT_MASK];
+            due.push_back(timer);
+            timers[timer.id] = {0, static_cast<int>(current & SLOT_MASK), std::prev(due.end())};
+        } else {
+            insert(timer.id, timer.deadline);
+        }
+    }
+}
+
+void TimerWheel::advance(uint64_t now, std::vector<TimerId>& expired) {
+    while (current < now) {
+        if (timers.empty()) {
+            current = now;
+            return;
+        }
+        current++;
+
+        // Higher levels first so their timers can still land in the lower
+        // slots that are cascaded at the same boundary
+        for (int level = LEVELS - 1; level > 0; level--) {
+            uint64_t mask = (uint64_t(1) << (SLOT_BITS * level)) - 1;
+            if ((current & mask) == 0) {
+                cascade(level);
+            }
+        }
+
+        auto& slot = wheel[0][current & SLOT_MASK];
+        for (auto& timer : slot) {
+            expired.push_back(timer.id);
+            timers.erase(timer.id);
+        }
+        slot.clear();
+    }
+}
+
+uint64_t TimerWheel::nextDeadline() const {
+    if (timers.empty()) {
+        return UINT64_MAX;
+    }
+
+    uint64_t best = UINT64_MAX;
+    for (uint64_t i = 1; i < SLOTS; i++) {
+        if (!wheel[0][(current + i) & SLOT_MASK].empty()) {
+            best = current + i;
+            break;
+        }
+    }
+
+    // Upper level timers are due no earlier than the boundary where their
+    // slot gets cascaded
+    for (int level = 1; level < LEVELS; level++) {
+        int shift = SLOT_BITS * level;
+        uint64_t base = current >> shift;
+        for (uint64_t j = 1; j <= SLOTS; j++) {
+            if (!wheel[level][(base + j) & SLOT_MASK].empty()) {
+                best = std::min(best, (base + j) << shift);
+                break;
+            }
+        }
+    }
+    return best;
+}
@@ -0,0 +1,69 @@
+//
+// Hierarchical timer wheel with 1 ms resolution
+//
+
+#ifndef BOTMASTERXL_TIMERWHEEL_H
+#define BOTMASTERXL_TIMERWHEEL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// Four levels of 64 slots: level 0 holds timers due within 64 ms at 1 ms
+// granularity, every further level covers 64 times the span of the previous
+// one (~4.6 hours in total). Timers on upper levels are cascaded down when the
+// wheel reaches their slot, so schedule/cancel are O(1) and advancing costs
+// O(elapsed ms) independent of the number of timers.
+class TimerWheel {
+public:
+    using TimerId = uint64_t;
+
+    explicit TimerWheel(uint64_t now);
+
+    // (Re)schedules a timer, deadlines in the past fire on the next advance()
+    void schedule(TimerId id, uint64_t deadline);
+    void cancel(TimerId id);
+    void clear();
+
+    // Moves the wheel to `now` and appends every expired timer to `expired`
+    void advance(uint64_t now, std::vector<TimerId>& expired);
+
+    // Lower bound of the earliest deadline (exact for timers on level 0),
+    // or UINT64_MAX if the wheel is empty
+    uint64_t nextDeadline() const;
+
+    size_t size() const { return timers.size(); }
+    bool empty() const { return timers.empty(); }
+    uint64_t getCurrent() const { return current; }
+
+private:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+    static constexpr uint64_t MAX_SPAN = (uint64_t(1) << (SLOT_BITS * LEVELS)) - 1;
+
+    struct stTimer {
+        TimerId id;
+        uint64_t deadline;
+    };
+    using Slot = std::list<stTimer>;
+
+    struct stLocation {
+        int level;
+        int slot;
+        Slot::iterator it;
+    };
+
+    std::array<std::array<Slot, SLOTS>, LEVELS> wheel;
+    std::unordered_map<TimerId, stLocation> timers;
+    uint64_t current;
+
+    void insert(TimerId id, uint64_t deadline);
+    void cascade(int level);
+};
+
+#endif //BOTMASTERXL_TIMERWHEEL_H
@@ -0,0 +1,107 @@
+//
+// Uniform 2D grid over world coordinates for radius and nearest queries
+//
+
+#include "UniformGrid.h"
+
+#include <cmath>
+
+UniformGrid::UniformGrid(float cellSize, float worldMin, float worldMax, size_t maxIds)
+    : cellSize(cellSize), worldMin(worldMin) {
+    dimension = std::max(1, static_cast<int>(std::ceil((worldMax - worldMin) / cellSize)));
+    cells.resize(static_cast<size_t>(dimension) * dimension);
+    entries.resize(maxIds);
+}
+
+int UniformGrid::columnOf(float coord) const {
+    float column = std::floor((coord - worldMin) / cellSize);
+    // Compare as float first, NaN and far away coordinates must not overflow the int
+    if (!(column >= 0.0f)) return 0;
+    if (column >= static_cast<float>(dimension - 1)) return dimension - 1;
+    return static_cast<int>(column);
+}
+
+uint32_t UniformGrid::cellOf(const glm::vec3& position) const {
+    return static_cast<uint32_t>(columnOf(position.y) * dimension + columnOf(position.x));
+}
+
+void UniformGrid::set(Id id, const glm::vec3& position) {
+    if (id >= entries.size()) return;
+
+    Entry& entry = entries[id];
+    uint32_t target = cellOf(position);
+    if (entry.cell == target) {
+        Cell& cell = cells[target];
+        cell.x[entry.index] = position.x;
+        cell.y[entry.index] = position.y;
+        cell.z[entry.index] = position.z;
+        return;
+    }
+
+    if (entry.cell == NO_CELL) {
+        count++;
+    } else {
+        removeFromCell(id);
+    }
+
+    Cell& cell = cells[target];
+    entry.cell = target;
+    entry.index = static_cast<uint32_t>(cell.ids.size());
+    cell.ids.push_back(id);
+    cell.x.push_back(position.x);
+    cell.y.push_back(position.y);
+    cell.z.push_back(position.z);
+}
+
+void UniformGrid::removeFromCell(Id id) {
+    Entry& entry = entries[id];
+    Cell& cell = cells[entry.cell];
+    size_t last = cell.ids.size() - 1;
+    if (entry.index != last) {
+        cell.ids[entry.index] = cell.ids[last];
+        cell.x[entry.index] = cell.x[last];
+        cell.y[entry.index] = cell.y[last];
+        cell.z[entry.index] = cell.z[last];
+        entries[cell.ids[entry.index]].index = entry.index;
+    }
+    cell.ids.pop_back();
+    cell.x.pop_back();
+    cell.y.pop_back();
+    cell.z.pop_back();
+    entry.cell = NO_CELL;
+}
+
+void UniformGrid::remove(Id id) {
+    if (!contains(id)) return;
+    removeFromCell(id);
+    count--;
+}
+
+void UniformGrid::clear() {
+    for (auto& cell : cells) {
+        cell.ids.clear();
+        cell.x.clear();
+        cell.y.clear();
+        cell.z.clear();
+    }
+    std::fill(entries.begin(), entries.end(), Entry{});
+    count = 0;
+}
+
+size_t UniformGrid::countInRange(const glm::vec3& position, float range) const {
+    if (count == 0) return 0;
+
+    int minX = columnOf(position.x - range), maxX = columnOf(position.x + range);
+    int minY = columnOf(position.y - range), maxY = columnOf(position.y + range);
+    float rangeSq = range * range;
+    size_t found = 0;
+
+    for (int cy = minY; cy <= maxY; cy++) {
+        for (int cx = minX; cx <= maxX; cx++) {
+            const Cell& cell = cells[cy * dimension + cx];
+            found += RangeFilter::countInRange(cell.x.data(), cell.y.data(), cell.z.data(), cell.ids.size(),
+                                               position.x, position.y, position.z, rangeSq);
+        }
+    }
+    return found;
+}
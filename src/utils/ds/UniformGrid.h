@@ -0,0 +1,155 @@
+//
+// Uniform 2D grid over world coordinates for radius and nearest queries
+//
+
+#ifndef BOTMASTERXL_UNIFORMGRID_H
+#define BOTMASTERXL_UNIFORMGRID_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "glm/vec3.hpp"
+#include "../RangeFilter.h"
+
+// Buckets ids by their x/y position into square cells covering
+// [worldMin, worldMax) on both axes. Positions outside the world are clamped
+// into the edge cells, so queries stay exact anywhere and only lose pruning
+// out there. Each cell keeps its positions column-wise for RangeFilter, moving
+// an id is O(1) and only touches memory when it crosses a cell border.
+class UniformGrid {
+public:
+    using Id = uint32_t;
+
+    UniformGrid(float cellSize, float worldMin, float worldMax, size_t maxIds);
+
+    // Inserts the id or moves it to the new position, ids >= maxIds are ignored
+    void set(Id id, const glm::vec3& position);
+    void remove(Id id);
+    void clear();
+
+    bool contains(Id id) const { return id < entries.size() && entries[id].cell != NO_CELL; }
+    size_t size() const { return count; }
+
+    // Calls fn(id) for every id within range of position (3D distance)
+    template <typename Fn>
+    void forEachInRange(const glm::vec3& position, float range, Fn&& fn) const;
+    size_t countInRange(const glm::vec3& position, float range) const;
+
+    // Appends up to k ids accepted by the filter, nearest first. The search
+    // widens ring by ring and stops once no unvisited cell can hold a closer id.
+    template <typename Filter>
+    void nearest(const glm::vec3& position, size_t k, float maxRange, Filter&& accept, std::vector<Id>& out) const;
+    void nearest(const glm::vec3& position, size_t k, float maxRange, std::vector<Id>& out) const {
+        nearest(position, k, maxRange, [](Id) { return true; }, out);
+    }
+
+private:
+    static constexpr uint32_t NO_CELL = std::numeric_limits<uint32_t>::max();
+    // Indices passed to RangeFilter are 16 bit, cells are filtered in chunks
+    static constexpr size_t FILTER_CHUNK = 256;
+
+    struct Cell {
+        std::vector<Id> ids;
+        std::vector<float> x, y, z;
+    };
+
+    struct Entry {
+        uint32_t cell = NO_CELL;
+        uint32_t index = 0; // position inside the cell
+    };
+
+    int columnOf(float coord) const;
+    uint32_t cellOf(const glm::vec3& position) const;
+    void removeFromCell(Id id);
+
+    float cellSize;
+    float worldMin;
+    int dimension;
+    size_t count = 0;
+    std::vector<Cell> cells;
+    std::vector<Entry> entries;
+};
+
+template <typename Fn>
+void UniformGrid::forEachInRange(const glm::vec3& position, float range, Fn&& fn) const {
+    if (count == 0) return;
+
+    int minX = columnOf(position.x - range), maxX = columnOf(position.x + range);
+    int minY = columnOf(position.y - range), maxY = columnOf(position.y + range);
+    float rangeSq = range * range;
+    uint16_t hits[FILTER_CHUNK];
+
+    for (int cy = minY; cy <= maxY; cy++) {
+        for (int cx = minX; cx <= maxX; cx++) {
+            const Cell& cell = cells[cy * dimension + cx];
+            for (size_t offset = 0; offset < cell.ids.size(); offset += FILTER_CHUNK) {
+                size_t length = std::min(FILTER_CHUNK, cell.ids.size() - offset);
+                size_t found = RangeFilter::inRange(cell.x.data() + offset, cell.y.data() + offset, cell.z.data() + offset,
+                                                    length, position.x, position.y, position.z, rangeSq, hits);
+                for (size_t i = 0; i < found; i++) {
+                    fn(cell.ids[offset + hits[i]]);
+                }
+            }
+        }
+    }
+}
+
+template <typename Filter>
+void UniformGrid::nearest(const glm::vec3& position, size_t k, float maxRange, Filter&& accept, std::vector<Id>& out) const {
+    if (count == 0 || k == 0) return;
+
+    // Max heap on distance holding the best k candidates so far
+    std::vector<std::pair<float, Id>> best;
+    best.reserve(k + 1);
+    float maxRangeSq = maxRange * maxRange;
+
+    int centerX = columnOf(position.x), centerY = columnOf(position.y);
+    auto visit = [&](int cx, int cy) {
+        const Cell& cell = cells[cy * dimension + cx];
+        for (size_t i = 0; i < cell.ids.size(); i++) {
+            float dx = cell.x[i] - position.x, dy = cell.y[i] - position.y, dz = cell.z[i] - position.z;
+            float distSq = dx * dx + dy * dy + dz * dz;
+            if (distSq > maxRangeSq || (best.size() == k && distSq >= best.front().first)) continue;
+            if (!accept(cell.ids[i])) continue;
+            best.emplace_back(distSq, cell.ids[i]);
+            std::push_heap(best.begin(), best.end());
+            if (best.size() > k) {
+                std::pop_heap(best.begin(), best.end());
+                best.pop_back();
+            }
+        }
+    };
+
+    for (int ring = 0; ; ring++) {
+        int minX = centerX - ring, maxX = centerX + ring;
+        int minY = centerY - ring, maxY = centerY + ring;
+        for (int cy = std::max(minY, 0); cy <= std::min(maxY, dimension - 1); cy++) {
+            bool edgeRow = cy == minY || cy == maxY;
+            for (int cx = std::max(minX, 0); cx <= std::min(maxX, dimension - 1); cx++) {
+                if (edgeRow || cx == minX || cx == maxX) visit(cx, cy);
+            }
+        }
+
+        // Distance from the position to the nearest unvisited cell. Sides at
+        // the world border hold nothing more, clamped ids live in edge cells.
+        float bound = std::numeric_limits<float>::infinity();
+        if (minX > 0) bound = std::min(bound, position.x - (worldMin + minX * cellSize));
+        if (maxX < dimension - 1) bound = std::min(bound, worldMin + (maxX + 1) * cellSize - position.x);
+        if (minY > 0) bound = std::min(bound, position.y - (worldMin + minY * cellSize));
+        if (maxY < dimension - 1) bound = std::min(bound, worldMin + (maxY + 1) * cellSize - position.y);
+
+        if (bound == std::numeric_limits<float>::infinity() || bound > maxRange) break;
+        if (best.size() == k && best.front().first <= bound * bound) break;
+    }
+
+    std::sort_heap(best.begin(), best.end());
+    for (const auto& candidate : best) {
+        out.push_back(candidate.second);
+    }
+}
+
+#endif //BOTMASTERXL_UNIFORMGRID_H
@@ -4,6 +4,76 @@
 
 #include "map_zones.h"
 #include <cmath>
+#include <map>
+#include <algorithm>
+
+namespace {
+    constexpr float MAP_MIN_X = -2997.469970f;
+    constexpr float MAP_MAX_X = 2997.060058f;
+    constexpr float MAP_MIN_Y = -2892.969970f;
+    constexpr float MAP_MAX_Y = 2993.870117f;
+
+    // Cells are widened by this much while the grid is built, so float rounding
+    // of the cell index at lookup time can never land a point in a cell whose
+    // precomputed answer does not hold for it
+    constexpr float GRID_CELL_MARGIN = 0.01f;
+
+    // Cell values below BOUNDARY_CELL are zone ids, INVALID_ZONE_CELL is outside
+    // every area. Boundary cells keep the index of a candidate list in the low bits.
+    constexpr uint16_t INVALID_ZONE_CELL = 0x7FFF;
+    constexpr uint16_t BOUNDARY_CELL = 0x8000;
+    // List 0 holds every area and behaves exactly like the linear walk, it backs
+    // boundary cells if the grid ever runs out of list indices
+    constexpr uint16_t LINEAR_LIST = 0;
+    constexpr size_t MAX_CANDIDATE_LISTS = BOUNDARY_CELL;
+}
+
+// Zone of every cell of a uniform grid over the map. Cells crossed by an area
+// edge (or by a step of the loop start index) point to the few areas that
+// can match inside them, highest table index first like the linear walk.
+struct MapZones::Grid {
+    struct CandidateList {
+        uint32_t begin;
+        uint32_t end;
+        // Set when the column spans a start index step, the walk then has to
+        // skip areas past GetMapZoneLoopStartIndex(x) itself
+        bool checkStartIndex;
+    };
+
+    int columns = 0;
+    int rows = 0;
+    std::vector<uint16_t> cells;
+    std::vector<CandidateList> lists;
+    std::vector<uint16_t> listAreas;
+    size_t boundaryCells = 0;
+
+    MapZone resolve(uint16_t cell, float x, float y) const {
+        if (!(cell & BOUNDARY_CELL)) {
+            return cell == INVALID_ZONE_CELL ? static_cast<MapZone>(INVALID_MAP_ZONE_ID) : static_cast<MapZone>(cell);
+        }
+
+        const auto& areaData = GetMapZoneAreaDataTable();
+        const CandidateList& list = lists[cell & ~BOUNDARY_CELL];
+        int startIndex = list.checkStartIndex ? GetMapZoneLoopStartIndex(x) : static_cast<int>(areaData.size());
+        for (uint32_t i = list.begin; i < list.end; i++) {
+            int index = listAreas[i];
+            if (index > startIndex) {
+                continue;
+            }
+            const auto& area = areaData[index];
+            if (x < area.maxX && (y >= area.minY && y < area.maxY)) {
+                return area.id;
+            }
+        }
+        return static_cast<MapZone>(INVALID_MAP_ZONE_ID);
+    }
+
+    uint16_t cellAt(float x, float y) const {
+        int column = std::min(static_cast<int>((x - MAP_MIN_X) * (1.0f / MAP_ZONE_GRID_CELL_SIZE)), columns - 1);
+        int row = std::min(static_cast<int>((y - MAP_MIN_Y) * (1.0f / MAP_ZONE_GRID_CELL_SIZE)), rows - 1);
+        return cells[static_cast<size_t>(row) * columns + column];
+    }
+};
 
 const std::vector<MapZoneData>& MapZones::GetMapZoneDataTable() {
     static const std::vector<MapZoneData> mapZoneData = {
@@ -620,9 +690,147 @@ MapZone MapZones::GetMapZoneAtPoint(float x, float y, float z) {
     return static_cast<MapZone>(INVALID_MAP_ZONE_ID);
 }
 
+bool MapZones::IsInsideMapBounds2D(float x, float y) {
+    return (x >= MAP_MIN_X && x < MAP_MAX_X) && (y >= MAP_MIN_Y && y < MAP_MAX_Y);
+}
+
+const MapZones::Grid& MapZones::GetMapZoneGrid() {
+    static const Grid grid = [] {
+        Grid g;
+        const auto& areaData = GetMapZoneAreaDataTable();
+        const int size = static_cast<int>(areaData.size());
+        const float lastMinX = areaData.back().minX;
+
+        g.columns = static_cast<int>(std::ceil((MAP_MAX_X - MAP_MIN_X) / MAP_ZONE_GRID_CELL_SIZE));
+        g.rows = static_cast<int>(std::ceil((MAP_MAX_Y - MAP_MIN_Y) / MAP_ZONE_GRID_CELL_SIZE));
+        g.cells.resize(static_cast<size_t>(g.columns) * g.rows);
+
+        g.lists.push_back({0, static_cast<uint32_t>(size), true});
+        for (int index = size - 1; index >= 0; index--) {
+            g.listAreas.push_back(static_cast<uint16_t>(index));
+        }
+        std::map<std::pair<bool, std::vector<uint16_t>>, uint16_t> listIndices;
+
+        std::vector<int> columnAreas;
+        std::vector<uint16_t> candidates;
+        for (int column = 0; column < g.columns; column++) {
+            float x0 = MAP_MIN_X + column * MAP_ZONE_GRID_CELL_SIZE - GRID_CELL_MARGIN;
+            float x1 = MAP_MIN_X + (column + 1) * MAP_ZONE_GRID_CELL_SIZE + GRID_CELL_MARGIN;
+
+            // The loop start index grows with x up to the last minX, where it drops
+            // back to the excluded areas. Areas up to lowStart are walked everywhere
+            // in the column, areas past highStart nowhere.
+            int lowStart = EXCLUDED_MAP_ZONE_AREA_COUNT - 1;
+            int highStart = size - 1;
+            if (x1 < lastMinX || x0 > lastMinX) {
+                lowStart = GetMapZoneLoopStartIndex(x0);
+                highStart = GetMapZoneLoopStartIndex(x1);
+            }
+
+            // Areas the walk can reach somewhere in this column. The excluded
+            // areas are tested without minX, exactly as the walk does.
+            columnAreas.clear();
+            for (int index = highStart; index >= 0; index--) {
+                const auto& area = areaData[index];
+                if (x0 < area.maxX && (index < EXCLUDED_MAP_ZONE_AREA_COUNT || area.minX < x1)) {
+                    columnAreas.push_back(index);
+                }
+            }
+
+            for (int row = 0; row < g.rows; row++) {
+                float y0 = MAP_MIN_Y + row * MAP_ZONE_GRID_CELL_SIZE - GRID_CELL_MARGIN;
+                float y1 = MAP_MIN_Y + (row + 1) * MAP_ZONE_GRID_CELL_SIZE + GRID_CELL_MARGIN;
+
+                // Stops at the first area that is walked and matches everywhere
+                // in the cell, nothing after it is ever reached
+                candidates.clear();
+                bool covered = false;
+                for (int index : columnAreas) {
+                    const auto& area = areaData[index];
+                    if (!(y0 < area.maxY && area.minY < y1)) {
+                        continue;
+                    }
+                    candidates.push_back(static_cast<uint16_t>(index));
+                    if (index <= lowStart && x1 <= area.maxX && area.minY <= y0 && y1 <= area.maxY &&
+                        (index < EXCLUDED_MAP_ZONE_AREA_COUNT || area.minX <= x0)) {
+                        covered = true;
+                        break;
+                    }
+                }
+
+                uint16_t& cell = g.cells[static_cast<size_t>(row) * g.columns + column];
+                if (candidates.empty()) {
+                    cell = INVALID_ZONE_CELL;
+                    continue;
+                }
+                if (covered && candidates.size() == 1) {
+                    cell = static_cast<uint16_t>(areaData[candidates.front()].id);
+                    continue;
+                }
+
+                g.boundaryCells++;
+                bool checkStartIndex = lowStart != highStart;
+                auto key = std::make_pair(checkStartIndex, candidates);
+                auto it = listIndices.find(key);
+                if (it == listIndices.end()) {
+                    if (g.lists.size() >= MAX_CANDIDATE_LISTS) {
+                        cell = BOUNDARY_CELL | LINEAR_LIST;
+                        continue;
+                    }
+                    uint32_t begin = static_cast<uint32_t>(g.listAreas.size());
+                    g.listAreas.insert(g.listAreas.end(), candidates.begin(), candidates.end());
+                    g.lists.push_back({begin, static_cast<uint32_t>(g.listAreas.size()), checkStartIndex});
+                    it = listIndices.emplace(std::move(key), static_cast<uint16_t>(g.lists.size() - 1)).first;
+                }
+                cell = BOUNDARY_CELL | it->second;
+            }
+        }
+        return g;
+    }();
+    return grid;
+}
+
 MapZone MapZones::GetMapZoneAtPoint2D(float x, float y) {
-    if (!(x >= -2997.469970f && x < 2997.060058f) || 
-        !(y >= -2892.969970f && y < 2993.870117f)) {
+    if (!IsInsideMapBounds2D(x, y)) {
+        return static_cast<MapZone>(INVALID_MAP_ZONE_ID);
+    }
+
+    const Grid& grid = GetMapZoneGrid();
+    return grid.resolve(grid.cellAt(x, y), x, y);
+}
+
+void MapZones::GetMapZonesAtPoints2D(const glm::vec3* positions, size_t count, MapZone* zones) {
+    const Grid& grid = GetMapZoneGrid();
+    for (size_t i = 0; i < count; i++) {
+        float x = positions[i].x;
+        float y = positions[i].y;
+        zones[i] = IsInsideMapBounds2D(x, y) ? grid.resolve(grid.cellAt(x, y), x, y)
+                                             : static_cast<MapZone>(INVALID_MAP_ZONE_ID);
+    }
+}
+
+std::vector<MapZone> MapZones::GetMapZonesAtPoints2D(const std::vector<glm::vec3>& positions) {
+    std::vector<MapZone> zones(positions.size());
+    GetMapZonesAtPoints2D(positions.data(), positions.size(), zones.data());
+    return zones;
+}
+
+size_t MapZones::GetMapZoneGridCellCount() {
+    return GetMapZoneGrid().cells.size();
+}
+
+size_t MapZones::GetMapZoneGridBoundaryCellCount() {
+    return GetMapZoneGrid().boundaryCells;
+}
+
+size_t MapZones::GetMapZoneGridMemoryUsage() {
+    const Grid& grid = GetMapZoneGrid();
+    return sizeof(Grid) + grid.cells.capacity() * sizeof(uint16_t) +
+           grid.lists.capacity() * sizeof(Grid::CandidateList) + grid.listAreas.capacity() * sizeof(uint16_t);
+}
+
+MapZone MapZones::GetMapZoneAtPoint2DLinear(float x, float y) {
+    if (!IsInsideMapBounds2D(x, y)) {
         return static_cast<MapZone>(INVALID_MAP_ZONE_ID);
     }
 
@@ -648,7 +856,7 @@ bool MapZones::IsValidMapZone(MapZone id) {
     return zoneId >= 0 && zoneId < GetMapZoneCount();
 }
 
-std::string MapZones::GetMapZoneName(MapZone id) {
+std::string_view MapZones::GetMapZoneName(MapZone id) {
     if (!IsValidMapZone(id)) {
         return {};
     }
@@ -1,13 +1,18 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
+#include <cstddef>
+#include <glm/vec3.hpp>
 
 constexpr int MAX_MAP_ZONE_NAME = 27;
 constexpr int INVALID_MAP_ZONE_ID = -1;
 constexpr int EXCLUDED_MAP_ZONE_AREA_COUNT = 9;
 constexpr int MAX_MAP_ZONE_AREAS = 13;
+// Edge length of a cell of the precomputed 2D zone grid, in metres
+constexpr float MAP_ZONE_GRID_CELL_SIZE = 10.0f;
 
 enum class MapZone : int {
     ZONE_BAYSIDE_MARINA = 0,
@@ -181,7 +186,7 @@ enum class MapZone : int {
 };
 
 struct MapZoneData {
-    std::string name;
+    std::string_view name;
     int soundId;
     int areaCount;
 };
@@ -195,17 +200,33 @@ struct MapZoneAreaData {
 class MapZones {
 public:
     static MapZone GetMapZoneAtPoint(float x, float y, float z);
+    // O(1) lookup through the precomputed grid, same result as the linear walk
     static MapZone GetMapZoneAtPoint2D(float x, float y);
+    // Resolves zones[i] for positions[i], x and y only
+    static void GetMapZonesAtPoints2D(const glm::vec3* positions, size_t count, MapZone* zones);
+    static std::vector<MapZone> GetMapZonesAtPoints2D(const std::vector<glm::vec3>& positions);
+    // Reference implementation walking the area table, kept for verification
+    static MapZone GetMapZoneAtPoint2DLinear(float x, float y);
     static int GetMapZoneCount();
     static bool IsValidMapZone(MapZone id);
-    static std::string GetMapZoneName(MapZone id);
+    // Points into the static zone table, empty for invalid zones
+    static std::string_view GetMapZoneName(MapZone id);
     static bool GetMapZoneSoundID(MapZone id, int& soundId);
     static bool GetMapZoneAreaCount(MapZone id, int& count);
     static int GetMapZoneAreaPos(MapZone id, float& minX, float& minY, float& minZ, 
                                 float& maxX, float& maxY, float& maxZ, int start = 0);
 
+    // Grid layout, for diagnostics
+    static size_t GetMapZoneGridCellCount();
+    static size_t GetMapZoneGridBoundaryCellCount();
+    static size_t GetMapZoneGridMemoryUsage();
+
 private:
+    struct Grid;
+
     static int GetMapZoneLoopStartIndex(float x);
+    static bool IsInsideMapBounds2D(float x, float y);
+    static const Grid& GetMapZoneGrid();
     static const std::vector<MapZoneData>& GetMapZoneDataTable();
     static const std::vector<MapZoneAreaData>& GetMapZoneAreaDataTable();
 };
\ No newline at end of file